@@ -0,0 +1,412 @@
+// Microbenchmark of the packet codec: the table driven encoding/decoding ("packet-codec.c") is compared with the
+// unrolled code used before (reproduced below as reference), the results must be identical.
+// The process is pinned to the cpu it starts on, the cases are warmed up then timed in interleaved trials; each case
+// reports the median of the trials and their spread (first and third quartiles, min and max), a difference smaller
+// than the spread of the two cases is noise.
+// Build: "make bench" under the "linux" folder.
+
+#if defined(__linux__)
+    #define _GNU_SOURCE     // sched_setaffinity
+#endif
+#include "../packet-codec.h"
+#include "../timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__)
+    #include <sched.h>
+#endif
+
+#define NUM_PACKETS 256
+#define ITERATIONS 1000
+#define WARMUP 5
+#define TRIALS 41
+
+// Decoding of a packet as done before the codec (sensors part of "handleRxPacket"), with the records accessed
+// through the context; the ack byte of slot 2 for accX is fixed (it was reading byte 33 instead of 44).
+struct referenceCtx {
+    struct robotRx *rx;
+};
+
+__attribute__((noinline)) static void referenceDecodePacket(struct referenceCtx *ctx, unsigned int packetId, const char *rxBuf) {
+    switch((int)((unsigned char)rxBuf[0])) {
+        case 3:
+            ctx->rx[packetId*4+0].proxValue[0] = (((signed int)rxBuf[2]<<8)|(unsigned char)rxBuf[1]);
+            ctx->rx[packetId*4+0].proxValue[1] = ((signed int)rxBuf[4]<<8)|(unsigned char)rxBuf[3];
+            ctx->rx[packetId*4+0].proxValue[2] = ((signed int)rxBuf[6]<<8)|(unsigned char)rxBuf[5];
+            ctx->rx[packetId*4+0].proxValue[3] = ((signed int)rxBuf[8]<<8)|(unsigned char)rxBuf[7];
+            ctx->rx[packetId*4+0].proxValue[5] = ((signed int)rxBuf[10]<<8)|(unsigned char)rxBuf[9];
+            ctx->rx[packetId*4+0].proxValue[6] = ((signed int)rxBuf[12]<<8)|(unsigned char)rxBuf[11];
+            ctx->rx[packetId*4+0].proxValue[7] = ((signed int)rxBuf[14]<<8)|(unsigned char)rxBuf[13];
+            ctx->rx[packetId*4+0].flagsRX = (unsigned char)rxBuf[15];
+            break;
+
+        case 4:
+            ctx->rx[packetId*4+0].proxValue[4] = ((signed int)rxBuf[2]<<8)|(unsigned char)rxBuf[1];
+            ctx->rx[packetId*4+0].groundValue[0] = ((signed int)rxBuf[4]<<8)|(unsigned char)rxBuf[3];
+            ctx->rx[packetId*4+0].groundValue[1] = ((signed int)rxBuf[6]<<8)|(unsigned char)rxBuf[5];
+            ctx->rx[packetId*4+0].groundValue[2] = ((signed int)rxBuf[8]<<8)|(unsigned char)rxBuf[7];
+            ctx->rx[packetId*4+0].groundValue[3] = ((signed int)rxBuf[10]<<8)|(unsigned char)rxBuf[9];
+            ctx->rx[packetId*4+0].accX = ((signed int)rxBuf[12]<<8)|(unsigned char)rxBuf[11];
+            ctx->rx[packetId*4+0].accY = ((signed int)rxBuf[14]<<8)|(unsigned char)rxBuf[13];
+            ctx->rx[packetId*4+0].tvRemote = (unsigned char)rxBuf[15];
+            break;
+
+        case 5:
+            ctx->rx[packetId*4+0].proxAmbientValue[0] = ((signed int)rxBuf[2]<<8)|(unsigned char)rxBuf[1];
+            ctx->rx[packetId*4+0].proxAmbientValue[1] = ((signed int)rxBuf[4]<<8)|(unsigned char)rxBuf[3];
+            ctx->rx[packetId*4+0].proxAmbientValue[2] = ((signed int)rxBuf[6]<<8)|(unsigned char)rxBuf[5];
+            ctx->rx[packetId*4+0].proxAmbientValue[3] = ((signed int)rxBuf[8]<<8)|(unsigned char)rxBuf[7];
+            ctx->rx[packetId*4+0].proxAmbientValue[5] = ((signed int)rxBuf[10]<<8)|(unsigned char)rxBuf[9];
+            ctx->rx[packetId*4+0].proxAmbientValue[6] = ((signed int)rxBuf[12]<<8)|(unsigned char)rxBuf[11];
+            ctx->rx[packetId*4+0].proxAmbientValue[7] = ((signed int)rxBuf[14]<<8)|(unsigned char)rxBuf[13];
+            ctx->rx[packetId*4+0].selector = (unsigned char)rxBuf[15];
+            break;
+
+        case 6:
+            ctx->rx[packetId*4+0].proxAmbientValue[4] = ((signed int)rxBuf[2]<<8)|(unsigned char)rxBuf[1];
+            ctx->rx[packetId*4+0].groundAmbientValue[0] = ((signed int)rxBuf[4]<<8)|(unsigned char)rxBuf[3];
+            ctx->rx[packetId*4+0].groundAmbientValue[1] = ((signed int)rxBuf[6]<<8)|(unsigned char)rxBuf[5];
+            ctx->rx[packetId*4+0].groundAmbientValue[2] = ((signed int)rxBuf[8]<<8)|(unsigned char)rxBuf[7];
+            ctx->rx[packetId*4+0].groundAmbientValue[3] = ((signed int)rxBuf[10]<<8)|(unsigned char)rxBuf[9];
+            ctx->rx[packetId*4+0].accZ = ((signed int)rxBuf[12]<<8)|(unsigned char)rxBuf[11];
+            ctx->rx[packetId*4+0].batteryAdc = ((signed int)rxBuf[14]<<8)|(unsigned char)rxBuf[13];
+            ctx->rx[packetId*4+0].heading = ((unsigned char)rxBuf[15])<<1;
+            break;
+
+        case 7:
+            ctx->rx[packetId*4+0].leftMotSteps = ((signed long)((unsigned char)rxBuf[4]<<24)| ((unsigned char)rxBuf[3]<<16)| ((unsigned char)rxBuf[2]<<8)|((unsigned char)rxBuf[1]));
+            ctx->rx[packetId*4+0].rightMotSteps = ((signed long)((unsigned char)rxBuf[8]<<24)| ((unsigned char)rxBuf[7]<<16)| ((unsigned char)rxBuf[6]<<8)|((unsigned char)rxBuf[5]));
+            ctx->rx[packetId*4+0].robTheta = ((((signed int)rxBuf[10]<<8)|(unsigned char)rxBuf[9])/10);//%360;
+            ctx->rx[packetId*4+0].robXPos = ((signed int)rxBuf[12]<<8)|(unsigned char)rxBuf[11];
+            ctx->rx[packetId*4+0].robYPos = ((signed int)rxBuf[14]<<8)|(unsigned char)rxBuf[13];
+            ctx->rx[packetId*4+0].gyroZ = (signed char)rxBuf[15]*64;
+            break;
+    }
+
+    switch((int)((unsigned char)rxBuf[16])) {
+        case 3:
+            ctx->rx[packetId*4+1].proxValue[0] = (((signed int)rxBuf[18]<<8)|(unsigned char)rxBuf[17]);
+            ctx->rx[packetId*4+1].proxValue[1] = ((signed int)rxBuf[20]<<8)|(unsigned char)rxBuf[19];
+            ctx->rx[packetId*4+1].proxValue[2] = ((signed int)rxBuf[22]<<8)|(unsigned char)rxBuf[21];
+            ctx->rx[packetId*4+1].proxValue[3] = ((signed int)rxBuf[24]<<8)|(unsigned char)rxBuf[23];
+            ctx->rx[packetId*4+1].proxValue[5] = ((signed int)rxBuf[26]<<8)|(unsigned char)rxBuf[25];
+            ctx->rx[packetId*4+1].proxValue[6] = ((signed int)rxBuf[28]<<8)|(unsigned char)rxBuf[27];
+            ctx->rx[packetId*4+1].proxValue[7] = ((signed int)rxBuf[30]<<8)|(unsigned char)rxBuf[29];
+            ctx->rx[packetId*4+1].flagsRX = (unsigned char)rxBuf[31];
+            break;
+
+        case 4:
+            ctx->rx[packetId*4+1].proxValue[4] = ((signed int)rxBuf[18]<<8)|(unsigned char)rxBuf[17];
+            ctx->rx[packetId*4+1].groundValue[0] = ((signed int)rxBuf[20]<<8)|(unsigned char)rxBuf[19];
+            ctx->rx[packetId*4+1].groundValue[1] = ((signed int)rxBuf[22]<<8)|(unsigned char)rxBuf[21];
+            ctx->rx[packetId*4+1].groundValue[2] = ((signed int)rxBuf[24]<<8)|(unsigned char)rxBuf[23];
+            ctx->rx[packetId*4+1].groundValue[3] = ((signed int)rxBuf[26]<<8)|(unsigned char)rxBuf[25];
+            ctx->rx[packetId*4+1].accX = ((signed int)rxBuf[28]<<8)|(unsigned char)rxBuf[27];
+            ctx->rx[packetId*4+1].accY = ((signed int)rxBuf[30]<<8)|(unsigned char)rxBuf[29];
+            ctx->rx[packetId*4+1].tvRemote = (unsigned char)rxBuf[31];
+            break;
+
+        case 5:
+            ctx->rx[packetId*4+1].proxAmbientValue[0] = ((signed int)rxBuf[18]<<8)|(unsigned char)rxBuf[17];
+            ctx->rx[packetId*4+1].proxAmbientValue[1] = ((signed int)rxBuf[20]<<8)|(unsigned char)rxBuf[19];
+            ctx->rx[packetId*4+1].proxAmbientValue[2] = ((signed int)rxBuf[22]<<8)|(unsigned char)rxBuf[21];
+            ctx->rx[packetId*4+1].proxAmbientValue[3] = ((signed int)rxBuf[24]<<8)|(unsigned char)rxBuf[23];
+            ctx->rx[packetId*4+1].proxAmbientValue[5] = ((signed int)rxBuf[26]<<8)|(unsigned char)rxBuf[25];
+            ctx->rx[packetId*4+1].proxAmbientValue[6] = ((signed int)rxBuf[28]<<8)|(unsigned char)rxBuf[27];
+            ctx->rx[packetId*4+1].proxAmbientValue[7] = ((signed int)rxBuf[30]<<8)|(unsigned char)rxBuf[29];
+            ctx->rx[packetId*4+1].selector = (unsigned char)rxBuf[31];
+            break;
+
+        case 6:
+            ctx->rx[packetId*4+1].proxAmbientValue[4] = ((signed int)rxBuf[18]<<8)|(unsigned char)rxBuf[17];
+            ctx->rx[packetId*4+1].groundAmbientValue[0] = ((signed int)rxBuf[20]<<8)|(unsigned char)rxBuf[19];
+            ctx->rx[packetId*4+1].groundAmbientValue[1] = ((signed int)rxBuf[22]<<8)|(unsigned char)rxBuf[21];
+            ctx->rx[packetId*4+1].groundAmbientValue[2] = ((signed int)rxBuf[24]<<8)|(unsigned char)rxBuf[23];
+            ctx->rx[packetId*4+1].groundAmbientValue[3] = ((signed int)rxBuf[26]<<8)|(unsigned char)rxBuf[25];
+            ctx->rx[packetId*4+1].accZ = ((signed int)rxBuf[28]<<8)|(unsigned char)rxBuf[27];
+            ctx->rx[packetId*4+1].batteryAdc = ((signed int)rxBuf[30]<<8)|(unsigned char)rxBuf[29];
+            ctx->rx[packetId*4+1].heading = ((unsigned char)rxBuf[31])<<1;
+            break;
+
+        case 7:
+            ctx->rx[packetId*4+1].leftMotSteps = ((signed long)((unsigned char)rxBuf[20]<<24)| ((unsigned char)rxBuf[19]<<16)| ((unsigned char)rxBuf[18]<<8)|((unsigned char)rxBuf[17]));
+            ctx->rx[packetId*4+1].rightMotSteps = ((signed long)((unsigned char)rxBuf[24]<<24)| ((unsigned char)rxBuf[23]<<16)| ((unsigned char)rxBuf[22]<<8)|((unsigned char)rxBuf[21]));
+            ctx->rx[packetId*4+1].robTheta = ((((signed int)rxBuf[26]<<8)|(unsigned char)rxBuf[25])/10);//%360;
+            ctx->rx[packetId*4+1].robXPos = ((signed int)rxBuf[28]<<8)|(unsigned char)rxBuf[27];
+            ctx->rx[packetId*4+1].robYPos = ((signed int)rxBuf[30]<<8)|(unsigned char)rxBuf[29];
+            ctx->rx[packetId*4+1].gyroZ = (signed char)rxBuf[31]*64;
+            break;
+    }
+
+    switch((int)((unsigned char)rxBuf[32])) {
+        case 3:
+            ctx->rx[packetId*4+2].proxValue[0] = (((signed int)rxBuf[34]<<8)|(unsigned char)rxBuf[33]);
+            ctx->rx[packetId*4+2].proxValue[1] = ((signed int)rxBuf[36]<<8)|(unsigned char)rxBuf[35];
+            ctx->rx[packetId*4+2].proxValue[2] = ((signed int)rxBuf[38]<<8)|(unsigned char)rxBuf[37];
+            ctx->rx[packetId*4+2].proxValue[3] = ((signed int)rxBuf[40]<<8)|(unsigned char)rxBuf[39];
+            ctx->rx[packetId*4+2].proxValue[5] = ((signed int)rxBuf[42]<<8)|(unsigned char)rxBuf[41];
+            ctx->rx[packetId*4+2].proxValue[6] = ((signed int)rxBuf[44]<<8)|(unsigned char)rxBuf[43];
+            ctx->rx[packetId*4+2].proxValue[7] = ((signed int)rxBuf[46]<<8)|(unsigned char)rxBuf[45];
+            ctx->rx[packetId*4+2].flagsRX = (unsigned char)rxBuf[47];
+            break;
+
+        case 4:
+            ctx->rx[packetId*4+2].proxValue[4] = ((signed int)rxBuf[34]<<8)|(unsigned char)rxBuf[33];
+            ctx->rx[packetId*4+2].groundValue[0] = ((signed int)rxBuf[36]<<8)|(unsigned char)rxBuf[35];
+            ctx->rx[packetId*4+2].groundValue[1] = ((signed int)rxBuf[38]<<8)|(unsigned char)rxBuf[37];
+            ctx->rx[packetId*4+2].groundValue[2] = ((signed int)rxBuf[40]<<8)|(unsigned char)rxBuf[39];
+            ctx->rx[packetId*4+2].groundValue[3] = ((signed int)rxBuf[42]<<8)|(unsigned char)rxBuf[41];
+            ctx->rx[packetId*4+2].accX = ((signed int)rxBuf[44]<<8)|(unsigned char)rxBuf[43];
+            ctx->rx[packetId*4+2].accY = ((signed int)rxBuf[46]<<8)|(unsigned char)rxBuf[45];
+            ctx->rx[packetId*4+2].tvRemote = (unsigned char)rxBuf[47];
+            break;
+
+        case 5:
+            ctx->rx[packetId*4+2].proxAmbientValue[0] = ((signed int)rxBuf[34]<<8)|(unsigned char)rxBuf[33];
+            ctx->rx[packetId*4+2].proxAmbientValue[1] = ((signed int)rxBuf[36]<<8)|(unsigned char)rxBuf[35];
+            ctx->rx[packetId*4+2].proxAmbientValue[2] = ((signed int)rxBuf[38]<<8)|(unsigned char)rxBuf[37];
+            ctx->rx[packetId*4+2].proxAmbientValue[3] = ((signed int)rxBuf[40]<<8)|(unsigned char)rxBuf[39];
+            ctx->rx[packetId*4+2].proxAmbientValue[5] = ((signed int)rxBuf[42]<<8)|(unsigned char)rxBuf[41];
+            ctx->rx[packetId*4+2].proxAmbientValue[6] = ((signed int)rxBuf[44]<<8)|(unsigned char)rxBuf[43];
+            ctx->rx[packetId*4+2].proxAmbientValue[7] = ((signed int)rxBuf[46]<<8)|(unsigned char)rxBuf[45];
+            ctx->rx[packetId*4+2].selector = (unsigned char)rxBuf[47];
+            break;
+
+        case 6:
+            ctx->rx[packetId*4+2].proxAmbientValue[4] = ((signed int)rxBuf[34]<<8)|(unsigned char)rxBuf[33];
+            ctx->rx[packetId*4+2].groundAmbientValue[0] = ((signed int)rxBuf[36]<<8)|(unsigned char)rxBuf[35];
+            ctx->rx[packetId*4+2].groundAmbientValue[1] = ((signed int)rxBuf[38]<<8)|(unsigned char)rxBuf[37];
+            ctx->rx[packetId*4+2].groundAmbientValue[2] = ((signed int)rxBuf[40]<<8)|(unsigned char)rxBuf[39];
+            ctx->rx[packetId*4+2].groundAmbientValue[3] = ((signed int)rxBuf[42]<<8)|(unsigned char)rxBuf[41];
+            ctx->rx[packetId*4+2].accZ = ((signed int)rxBuf[44]<<8)|(unsigned char)rxBuf[43];
+            ctx->rx[packetId*4+2].batteryAdc = ((signed int)rxBuf[46]<<8)|(unsigned char)rxBuf[45];
+            ctx->rx[packetId*4+2].heading = ((unsigned char)rxBuf[47])<<1;
+            break;
+
+        case 7:
+            ctx->rx[packetId*4+2].leftMotSteps = ((signed long)((unsigned char)rxBuf[36]<<24)| ((unsigned char)rxBuf[35]<<16)| ((unsigned char)rxBuf[34]<<8)|((unsigned char)rxBuf[33]));
+            ctx->rx[packetId*4+2].rightMotSteps = ((signed long)((unsigned char)rxBuf[40]<<24)| ((unsigned char)rxBuf[39]<<16)| ((unsigned char)rxBuf[38]<<8)|((unsigned char)rxBuf[37]));
+            ctx->rx[packetId*4+2].robTheta = ((((signed int)rxBuf[42]<<8)|(unsigned char)rxBuf[41])/10);//%360;
+            ctx->rx[packetId*4+2].robXPos = ((signed int)rxBuf[44]<<8)|(unsigned char)rxBuf[43];
+            ctx->rx[packetId*4+2].robYPos = ((signed int)rxBuf[46]<<8)|(unsigned char)rxBuf[45];
+            ctx->rx[packetId*4+2].gyroZ = (signed char)rxBuf[47]*64;
+            break;
+    }
+
+    switch((int)((unsigned char)rxBuf[48])) {
+        case 3:
+            ctx->rx[packetId*4+3].proxValue[0] = (((signed int)rxBuf[50]<<8)|(unsigned char)rxBuf[49]);
+            ctx->rx[packetId*4+3].proxValue[1] = ((signed int)rxBuf[52]<<8)|(unsigned char)rxBuf[51];
+            ctx->rx[packetId*4+3].proxValue[2] = ((signed int)rxBuf[54]<<8)|(unsigned char)rxBuf[53];
+            ctx->rx[packetId*4+3].proxValue[3] = ((signed int)rxBuf[56]<<8)|(unsigned char)rxBuf[55];
+            ctx->rx[packetId*4+3].proxValue[5] = ((signed int)rxBuf[58]<<8)|(unsigned char)rxBuf[57];
+            ctx->rx[packetId*4+3].proxValue[6] = ((signed int)rxBuf[60]<<8)|(unsigned char)rxBuf[59];
+            ctx->rx[packetId*4+3].proxValue[7] = ((signed int)rxBuf[62]<<8)|(unsigned char)rxBuf[61];
+            ctx->rx[packetId*4+3].flagsRX = (unsigned char)rxBuf[63];
+            break;
+
+        case 4:
+            ctx->rx[packetId*4+3].proxValue[4] = ((signed int)rxBuf[50]<<8)|(unsigned char)rxBuf[49];
+            ctx->rx[packetId*4+3].groundValue[0] = ((signed int)rxBuf[52]<<8)|(unsigned char)rxBuf[51];
+            ctx->rx[packetId*4+3].groundValue[1] = ((signed int)rxBuf[54]<<8)|(unsigned char)rxBuf[53];
+            ctx->rx[packetId*4+3].groundValue[2] = ((signed int)rxBuf[56]<<8)|(unsigned char)rxBuf[55];
+            ctx->rx[packetId*4+3].groundValue[3] = ((signed int)rxBuf[58]<<8)|(unsigned char)rxBuf[57];
+            ctx->rx[packetId*4+3].accX = ((signed int)rxBuf[60]<<8)|(unsigned char)rxBuf[59];
+            ctx->rx[packetId*4+3].accY = ((signed int)rxBuf[62]<<8)|(unsigned char)rxBuf[61];
+            ctx->rx[packetId*4+3].tvRemote = (unsigned char)rxBuf[63];
+            break;
+
+        case 5:
+            ctx->rx[packetId*4+3].proxAmbientValue[0] = ((signed int)rxBuf[50]<<8)|(unsigned char)rxBuf[49];
+            ctx->rx[packetId*4+3].proxAmbientValue[1] = ((signed int)rxBuf[52]<<8)|(unsigned char)rxBuf[51];
+            ctx->rx[packetId*4+3].proxAmbientValue[2] = ((signed int)rxBuf[54]<<8)|(unsigned char)rxBuf[53];
+            ctx->rx[packetId*4+3].proxAmbientValue[3] = ((signed int)rxBuf[56]<<8)|(unsigned char)rxBuf[55];
+            ctx->rx[packetId*4+3].proxAmbientValue[5] = ((signed int)rxBuf[58]<<8)|(unsigned char)rxBuf[57];
+            ctx->rx[packetId*4+3].proxAmbientValue[6] = ((signed int)rxBuf[60]<<8)|(unsigned char)rxBuf[59];
+            ctx->rx[packetId*4+3].proxAmbientValue[7] = ((signed int)rxBuf[62]<<8)|(unsigned char)rxBuf[61];
+            ctx->rx[packetId*4+3].selector = (unsigned char)rxBuf[63];
+            break;
+
+        case 6:
+            ctx->rx[packetId*4+3].proxAmbientValue[4] = ((signed int)rxBuf[50]<<8)|(unsigned char)rxBuf[49];
+            ctx->rx[packetId*4+3].groundAmbientValue[0] = ((signed int)rxBuf[52]<<8)|(unsigned char)rxBuf[51];
+            ctx->rx[packetId*4+3].groundAmbientValue[1] = ((signed int)rxBuf[54]<<8)|(unsigned char)rxBuf[53];
+            ctx->rx[packetId*4+3].groundAmbientValue[2] = ((signed int)rxBuf[56]<<8)|(unsigned char)rxBuf[55];
+            ctx->rx[packetId*4+3].groundAmbientValue[3] = ((signed int)rxBuf[58]<<8)|(unsigned char)rxBuf[57];
+            ctx->rx[packetId*4+3].accZ = ((signed int)rxBuf[60]<<8)|(unsigned char)rxBuf[59];
+            ctx->rx[packetId*4+3].batteryAdc = ((signed int)rxBuf[62]<<8)|(unsigned char)rxBuf[61];
+            ctx->rx[packetId*4+3].heading = ((unsigned char)rxBuf[63])<<1;
+            break;
+
+        case 7:
+            ctx->rx[packetId*4+3].leftMotSteps = ((signed long)((unsigned char)rxBuf[52]<<24)| ((unsigned char)rxBuf[51]<<16)| ((unsigned char)rxBuf[50]<<8)|((unsigned char)rxBuf[49]));
+            ctx->rx[packetId*4+3].rightMotSteps = ((signed long)((unsigned char)rxBuf[56]<<24)| ((unsigned char)rxBuf[55]<<16)| ((unsigned char)rxBuf[54]<<8)|((unsigned char)rxBuf[53]));
+            ctx->rx[packetId*4+3].robTheta = ((((signed int)rxBuf[58]<<8)|(unsigned char)rxBuf[57])/10);//%360;
+            ctx->rx[packetId*4+3].robXPos = ((signed int)rxBuf[60]<<8)|(unsigned char)rxBuf[59];
+            ctx->rx[packetId*4+3].robYPos = ((signed int)rxBuf[62]<<8)|(unsigned char)rxBuf[61];
+            ctx->rx[packetId*4+3].gyroZ = (signed char)rxBuf[63]*64;
+            break;
+    }
+}
+
+static char referenceSpeed(char value) {
+    if(value >= 0) {
+        return (value|0x80);
+    } else {
+        return ((-value)&0x7F);
+    }
+}
+
+__attribute__((noinline)) static void referenceEncodePacket(char *txBuf, struct robotTx *const *robots, unsigned char payloadId) {
+    int i = 0;
+    for(i=0; i<4; i++) {
+        if(robots[i]->sleepEnabledFlag == 1) {
+            txBuf[(i*15)+1] = 0x00;
+            txBuf[(i*15)+2] = 0x00;
+            txBuf[(i*15)+3] = 0x00;
+            txBuf[(i*15)+4] = robots[i]->flagsTX[0];
+            txBuf[(i*15)+5] = 0x00;
+            txBuf[(i*15)+6] = 0x00;
+            txBuf[(i*15)+7] = 0x00;
+            txBuf[(i*15)+8] = 0x00;
+        } else {
+            txBuf[(i*15)+1] = robots[i]->redLed;
+            txBuf[(i*15)+2] = robots[i]->blueLed;
+            txBuf[(i*15)+3] = robots[i]->greenLed;
+            txBuf[(i*15)+4] = robots[i]->flagsTX[0];
+            txBuf[(i*15)+5] = referenceSpeed(robots[i]->rightSpeed);
+            txBuf[(i*15)+6] = referenceSpeed(robots[i]->leftSpeed);
+            txBuf[(i*15)+7] = robots[i]->smallLeds;
+            txBuf[(i*15)+8] = robots[i]->flagsTX[1];
+        }
+        txBuf[(i*15)+9] = payloadId;
+        txBuf[(i*15)+14] = (robots[i]->robotAddress>>8)&0xFF;
+        txBuf[(i*15)+15] = robots[i]->robotAddress&0xFF;
+    }
+}
+
+static char rxPackets[NUM_PACKETS][64];
+static struct robotRx robotsRef[4], robotsCodec[4];
+static struct referenceCtx refCtx = { robotsRef };
+static struct robotTx robotsTx[NUM_PACKETS][4];
+static struct robotRx *rxCodec[4];
+static struct robotTx *txPtr[NUM_PACKETS][4];
+static unsigned int checksum = 0;
+
+enum benchCase { DECODE_REFERENCE, DECODE_CODEC, ENCODE_REFERENCE, ENCODE_CODEC, NUM_CASES };
+
+static const char *caseName[NUM_CASES] = {"decode (reference)", "decode (codec)", "encode (reference)", "encode (codec)"};
+
+static unsigned long long runCase(enum benchCase c) {
+    unsigned long long start = getTimeUs();
+    char txBuf[64] = {0};
+    int k = 0, i = 0;
+
+    for(k=0; k<ITERATIONS; k++) {
+        for(i=0; i<NUM_PACKETS; i++) {
+            switch(c) {
+                case DECODE_REFERENCE: referenceDecodePacket(&refCtx, 0, rxPackets[i]); break;
+                case DECODE_CODEC: codecDecodeRx(rxPackets[i], rxCodec, 4); break;
+                case ENCODE_REFERENCE: referenceEncodePacket(txBuf, txPtr[i], (unsigned char)i); break;
+                case ENCODE_CODEC: codecEncodeTx(txBuf, txPtr[i], 4, (unsigned char)i); break;
+                default: break;
+            }
+        }
+        checksum += robotsRef[k&3].proxValue[0] + robotsCodec[k&3].proxValue[0] + (unsigned char)txBuf[k&63];
+    }
+    return getTimeUs()-start;
+}
+
+// Run on a single cpu: the migrations and the frequency of another core would add to the noise. Not supported on
+// Mac OS X (no cpu affinity), the spread shows it.
+static int pinCpu(void) {
+#if defined(_WIN32) || defined(_WIN64)
+    return (SetThreadAffinityMask(GetCurrentThread(), 1) != 0) ? 0 : -1;
+#elif defined(__linux__)
+    cpu_set_t set;
+    int cpu = sched_getcpu();
+    CPU_ZERO(&set);
+    CPU_SET((cpu >= 0) ? cpu : 0, &set);
+    return sched_setaffinity(0, sizeof(set), &set);
+#else
+    return -1;
+#endif
+}
+
+static int compareTimes(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(void) {
+    char txRef[64] = {0}, txCodec[64] = {0};
+    static double times[NUM_CASES][TRIALS];
+    double median[NUM_CASES];
+    int i = 0, j = 0, mismatch = 0, pinned = (pinCpu() == 0);
+
+    srand(1);
+    for(i=0; i<NUM_PACKETS; i++) {
+        for(j=0; j<64; j++) {
+            rxPackets[i][j] = (char)(rand()&0xFF);
+        }
+        for(j=0; j<4; j++) {
+            rxPackets[i][j*16] = 3 + (i+j)%5;  // each robot cycles through the ack ids
+            robotsTx[i][j].robotAddress = rand()&0xFFFF;
+            robotsTx[i][j].leftSpeed = (char)(rand()&0xFF);
+            robotsTx[i][j].rightSpeed = (char)(rand()&0xFF);
+            robotsTx[i][j].redLed = rand()%101;
+            robotsTx[i][j].greenLed = rand()%101;
+            robotsTx[i][j].blueLed = rand()%101;
+            robotsTx[i][j].flagsTX[0] = rand()&0xFF;
+            robotsTx[i][j].flagsTX[1] = rand()&0xFF;
+            robotsTx[i][j].smallLeds = rand()&0xFF;
+            robotsTx[i][j].sleepEnabledFlag = (rand()%8 == 0);
+            txPtr[i][j] = &robotsTx[i][j];
+        }
+    }
+    for(j=0; j<4; j++) {
+        rxCodec[j] = &robotsCodec[j];
+    }
+
+    // correctness: every packet is decoded and encoded by both versions, the results must be the same
+    for(i=0; i<NUM_PACKETS; i++) {
+        referenceDecodePacket(&refCtx, 0, rxPackets[i]);
+        codecDecodeRx(rxPackets[i], rxCodec, 4);
+        referenceEncodePacket(txRef, txPtr[i], (unsigned char)i);
+        codecEncodeTx(txCodec, txPtr[i], 4, (unsigned char)i);
+        if(memcmp(robotsRef, robotsCodec, sizeof(robotsRef))!=0 || memcmp(txRef, txCodec, sizeof(txRef))!=0) {
+            mismatch++;
+        }
+    }
+
+    // warm up the caches, the branch predictors and the cpu frequency, then interleave the cases so that a slower
+    // period of the machine affects all of them
+    for(i=0; i<WARMUP; i++) {
+        for(j=0; j<NUM_CASES; j++) {
+            runCase((enum benchCase)j);
+        }
+    }
+    for(i=0; i<TRIALS; i++) {
+        for(j=0; j<NUM_CASES; j++) {
+            times[j][i] = runCase((enum benchCase)j)*1000.0/((double)NUM_PACKETS*ITERATIONS);
+        }
+    }
+
+    printf("packets: %d x %d, %d trials after %d warm-up, cpu %s\n", NUM_PACKETS, ITERATIONS, TRIALS, WARMUP, pinned ? "pinned" : "not pinned");
+    printf("%-20s %8s %8s %8s %8s %8s  (ns/packet)\n", "", "median", "q1", "q3", "min", "max");
+    for(j=0; j<NUM_CASES; j++) {
+        qsort(times[j], TRIALS, sizeof(double), compareTimes);
+        median[j] = times[j][TRIALS/2];
+        printf("%-20s %8.1f %8.1f %8.1f %8.1f %8.1f\n", caseName[j], median[j], times[j][TRIALS/4], times[j][3*TRIALS/4],
+               times[j][0], times[j][TRIALS-1]);
+    }
+    printf("codec/reference (medians): decode %.2f, encode %.2f\n", median[DECODE_CODEC]/median[DECODE_REFERENCE],
+           median[ENCODE_CODEC]/median[ENCODE_REFERENCE]);
+    printf("mismatches: %d (checksum %u)\n", mismatch, checksum);
+
+    return (mismatch == 0) ? 0 : 1;
+}
@@ -0,0 +1,343 @@
+// Benchmarks of the hot paths of the library, run against the emulated base-station ("mock-basestation.h"):
+// - latency of the setters/getters (and of the address lookup) with 4, 32 and 100 robots
+// - commands of the whole swarm: a frame published vs "setCompletePacketForAll"
+// - encoding/decoding of the packets
+// - contention between a thread calling the setters and the communication thread
+// - exchanges per second with the base-station, blocking and pipelined transfers
+// The results are printed one per line as "benchmark,robots,value,unit" (CSV with header) so that they can be
+// compared between two builds; the progress is printed on stderr.
+// Build: "make bench" under the "linux" folder.
+
+#include "../elisa3-lib.h"
+#include "../packet-codec.h"
+#include "../mock-basestation.h"
+#include "../timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include "pthread.h"
+#endif
+
+#define CALLS 1000000
+#define PACKETS 256
+#define TRIALS 5
+#define RUN_US 1000000      // duration of the threaded benchmarks
+#define FIRST_ADDRESS 3000
+
+// Not part of the api, see "elisa3-lib.c".
+int getIdFromAddress(elisa3_ctx *ctx, int address);
+
+enum callCase { CALL_ID_FROM_ADDRESS, CALL_GET_PROXIMITY, CALL_GET_SENSORS, CALL_SET_LEFT_SPEED, CALL_SET_RED, NUM_CALLS };
+
+static const char *callName[NUM_CALLS] = {"getIdFromAddress", "getProximity", "getSensors", "setLeftSpeed", "setRed"};
+
+static const int robotCounts[] = {4, 32, 100};
+#define NUM_ROBOT_COUNTS (int)(sizeof(robotCounts)/sizeof(robotCounts[0]))
+
+static volatile unsigned long sink = 0;     // results of the getters, so that the calls aren't optimized out
+static volatile int hammerRunning = 0;
+static unsigned long hammerCalls = 0;
+
+static void report(const char *name, int robots, double value, const char *unit) {
+    printf("%s,%d,%.3f,%s\n", name, robots, value, unit);
+    fflush(stdout);
+}
+
+static elisa3_ctx *startRobots(int numRobots) {
+    int addr[100];
+    int i = 0;
+    for(i=0; i<numRobots; i++) {
+        addr[i] = FIRST_ADDRESS+i;
+    }
+    return elisa3_startCommunication(addr, numRobots, 0, 1);
+}
+
+// The robots accessed go round the whole list, the last one is the worst case of a linear lookup.
+static unsigned long long runCalls(elisa3_ctx *ctx, enum callCase c, int numRobots) {
+    robotSensors sensors;
+    unsigned long long start = getTimeUs();
+    unsigned long acc = 0;
+    int i = 0, addr = 0;
+
+    for(i=0; i<CALLS; i++) {
+        addr = FIRST_ADDRESS + (i%numRobots);
+        switch(c) {
+            case CALL_ID_FROM_ADDRESS: acc += getIdFromAddress(ctx, addr); break;
+            case CALL_GET_PROXIMITY: acc += elisa3_getProximity(ctx, addr, i&7); break;
+            case CALL_GET_SENSORS: elisa3_getSensors(ctx, addr, &sensors); acc += sensors.proximity[0]; break;
+            case CALL_SET_LEFT_SPEED: elisa3_setLeftSpeed(ctx, addr, (char)(i&0x3F)); break;
+            case CALL_SET_RED: elisa3_setRed(ctx, addr, (unsigned char)(i%101)); break;
+            default: break;
+        }
+    }
+    sink += acc;
+    return getTimeUs()-start;
+}
+
+static void benchCalls() {
+    elisa3_ctx *ctx = NULL;
+    unsigned long long elapsed = 0, best[NUM_CALLS];
+    int n = 0, i = 0, c = 0;
+
+    for(n=0; n<NUM_ROBOT_COUNTS; n++) {
+        fprintf(stderr, "calls latency, %d robots\n", robotCounts[n]);
+        ctx = startRobots(robotCounts[n]);
+        if(ctx == NULL) {
+            fprintf(stderr, "cannot start the communication\n");
+            continue;
+        }
+        elisa3_stopTransferData(ctx);   // only the cost of the calls, see "benchContention" for the comm thread
+        for(i=0; i<TRIALS; i++) {
+            for(c=0; c<NUM_CALLS; c++) {
+                elapsed = runCalls(ctx, (enum callCase)c, robotCounts[n]);
+                if(i==0 || elapsed<best[c]) {
+                    best[c] = elapsed;
+                }
+            }
+        }
+        for(c=0; c<NUM_CALLS; c++) {
+            report(callName[c], robotCounts[n], best[c]*1000.0/CALLS, "ns/call");
+        }
+        elisa3_stopCommunication(ctx);
+    }
+}
+
+// Commands of all the robots, "FRAMES" times: one frame published or the parallel arrays copied under the lock.
+#define FRAMES 100000
+static unsigned long long runFrames(elisa3_ctx *ctx, int numRobots, int packed) {
+    static int addr[100];
+    static char red[100], green[100], blue[100], flags[100][2], left[100], right[100], leds[100];
+    robotCommand *frame = NULL;
+    unsigned long long start = 0;
+    int i = 0, j = 0;
+
+    for(j=0; j<numRobots; j++) {
+        addr[j] = FIRST_ADDRESS+j;
+    }
+    start = getTimeUs();
+    for(i=0; i<FRAMES; i++) {
+        if(packed) {
+            frame = elisa3_getCommandFrame(ctx, numRobots);
+            for(j=0; j<numRobots; j++) {
+                frame[j].left = frame[j].right = (signed char)(i&0x3F);
+                frame[j].red = frame[j].green = frame[j].blue = (unsigned char)(i%101);
+                frame[j].flags[0] = frame[j].flags[1] = 0;
+                frame[j].leds = (unsigned char)i;
+            }
+            elisa3_publishCommandFrame(ctx);
+        } else {
+            for(j=0; j<numRobots; j++) {
+                left[j] = right[j] = (char)(i&0x3F);
+                red[j] = green[j] = blue[j] = (char)(i%101);
+                flags[j][0] = flags[j][1] = 0;
+                leds[j] = (char)i;
+            }
+            elisa3_setCompletePacketForAll(ctx, addr, red, green, blue, flags, left, right, leds);
+        }
+    }
+    return getTimeUs()-start;
+}
+
+static void benchFrames() {
+    elisa3_ctx *ctx = NULL;
+    unsigned long long elapsed = 0, best[2];
+    int n = 0, i = 0, packed = 0;
+
+    for(n=0; n<NUM_ROBOT_COUNTS; n++) {
+        fprintf(stderr, "swarm commands, %d robots\n", robotCounts[n]);
+        ctx = startRobots(robotCounts[n]);
+        if(ctx == NULL) {
+            fprintf(stderr, "cannot start the communication\n");
+            continue;
+        }
+        for(i=0; i<TRIALS; i++) {
+            for(packed=0; packed<2; packed++) {
+                elapsed = runFrames(ctx, robotCounts[n], packed);
+                if(i==0 || elapsed<best[packed]) {
+                    best[packed] = elapsed;
+                }
+            }
+        }
+        report("setCompletePacketForAll", robotCounts[n], best[0]*1000.0/FRAMES, "ns/frame");
+        report("publishCommandFrame", robotCounts[n], best[1]*1000.0/FRAMES, "ns/frame");
+        elisa3_stopCommunication(ctx);
+    }
+}
+
+static void benchCodec() {
+    static char rxPackets[PACKETS][64];
+    static struct robotTx robotsTx[4];
+    static struct robotRx robotsRx[4];
+    struct robotTx *txPtr[4];
+    struct robotRx *rxPtr[4];
+    char txBuf[64] = {0};
+    unsigned long long start = 0, encodeBest = 0, decodeBest = 0, elapsed = 0;
+    int i = 0, j = 0, k = 0;
+
+    fprintf(stderr, "packets encoding/decoding\n");
+    srand(1);
+    for(i=0; i<PACKETS; i++) {
+        for(j=0; j<64; j++) {
+            rxPackets[i][j] = (char)(rand()&0xFF);
+        }
+        for(j=0; j<4; j++) {
+            rxPackets[i][j*16] = 3 + (i+j)%5;  // each robot cycles through the ack ids
+        }
+    }
+    for(j=0; j<4; j++) {
+        robotsTx[j].robotAddress = FIRST_ADDRESS+j;
+        robotsTx[j].leftSpeed = (char)(rand()&0xFF);
+        robotsTx[j].rightSpeed = (char)(rand()&0xFF);
+        txPtr[j] = &robotsTx[j];
+        rxPtr[j] = &robotsRx[j];
+    }
+    for(i=0; i<TRIALS; i++) {
+        start = getTimeUs();
+        for(k=0; k<CALLS/PACKETS; k++) {
+            for(j=0; j<PACKETS; j++) {
+                codecEncodeTx(txBuf, txPtr, 4, (unsigned char)j);
+            }
+            sink += (unsigned char)txBuf[k&63];
+        }
+        elapsed = getTimeUs()-start;
+        if(i==0 || elapsed<encodeBest) {
+            encodeBest = elapsed;
+        }
+        start = getTimeUs();
+        for(k=0; k<CALLS/PACKETS; k++) {
+            for(j=0; j<PACKETS; j++) {
+                codecDecodeRx(rxPackets[j], rxPtr, 4);
+            }
+            sink += robotsRx[k&3].proxValue[0];
+        }
+        elapsed = getTimeUs()-start;
+        if(i==0 || elapsed<decodeBest) {
+            decodeBest = elapsed;
+        }
+    }
+    report("encode", 4, encodeBest*1000.0/((CALLS/PACKETS)*PACKETS), "ns/packet");
+    report("decode", 4, decodeBest*1000.0/((CALLS/PACKETS)*PACKETS), "ns/packet");
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI hammerSetters(void *arg) {
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static void *hammerSetters(void *arg) {
+#endif
+    elisa3_ctx *ctx = (elisa3_ctx*)arg;
+    unsigned long calls = 0;
+    while(hammerRunning) {
+        elisa3_setLeftSpeed(ctx, FIRST_ADDRESS + (calls&3), (char)(calls&0x3F));
+        elisa3_setRightSpeed(ctx, FIRST_ADDRESS + (calls&3), (char)(calls&0x3F));
+        calls += 2;
+    }
+    hammerCalls = calls;
+    return 0;
+}
+
+// Exchanges of the communication thread at full rate (transfer period of 1 us) during RUN_US, with or without a
+// thread calling the setters at the same time; return the exchanges per second, "settersNs" gets the cost of a setter.
+static double runContention(int numRobots, int withSetters, double *settersNs) {
+    elisa3_ctx *ctx = startRobots(numRobots);
+    unsigned long exchanges = 0;
+    unsigned long long start = 0, elapsed = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE thread = NULL;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_t thread;
+#endif
+
+    if(ctx == NULL) {
+        return 0;
+    }
+    elisa3_setTransferPeriod(ctx, 1);
+    hammerCalls = 0;
+    hammerRunning = 1;
+    start = getTimeUs();
+    exchanges = mock_get_exchanges(0);
+    if(withSetters) {
+#if defined(_WIN32) || defined(_WIN64)
+        thread = CreateThread(NULL, 0, hammerSetters, ctx, 0, NULL);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        pthread_create(&thread, NULL, hammerSetters, ctx);
+#endif
+    }
+    sleepUntilUs(start+RUN_US);
+    hammerRunning = 0;
+    if(withSetters) {
+#if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        pthread_join(thread, NULL);
+#endif
+    }
+    elapsed = getTimeUs()-start;
+    exchanges = mock_get_exchanges(0)-exchanges;
+    elisa3_stopCommunication(ctx);
+    if(settersNs != NULL) {
+        *settersNs = (hammerCalls > 0) ? elapsed*1000.0/hammerCalls : 0;
+    }
+    return exchanges*1000000.0/elapsed;
+}
+
+static void benchContention() {
+    double alone = 0, contended = 0, settersNs = 0;
+    fprintf(stderr, "contention setters/communication thread\n");
+    alone = runContention(4, 0, NULL);
+    contended = runContention(4, 1, &settersNs);
+    report("exchanges_idle_app", 4, alone, "exchanges/s");
+    report("exchanges_with_setters", 4, contended, "exchanges/s");
+    report("setter_with_comm", 4, settersNs, "ns/call");
+}
+
+// Exchanges per second with the emulated base-station answering immediately, all the robots cycling in the slots.
+static double runExchanges(int numRobots, unsigned int asyncDepth) {
+    elisa3_ctx *ctx = startRobots(numRobots);
+    unsigned long exchanges = 0;
+    unsigned long long start = 0, elapsed = 0;
+
+    if(ctx == NULL) {
+        return 0;
+    }
+    elisa3_setTransferPeriod(ctx, 1);
+    elisa3_setAsyncTransfer(ctx, asyncDepth);
+    sleepUntilUs(getTimeUs()+RUN_US/10);    // let the thread switch the transfer mode
+    start = getTimeUs();
+    exchanges = mock_get_exchanges(0);
+    sleepUntilUs(start+RUN_US);
+    elapsed = getTimeUs()-start;
+    exchanges = mock_get_exchanges(0)-exchanges;
+    elisa3_stopCommunication(ctx);
+    return exchanges*1000000.0/elapsed;
+}
+
+static void benchExchanges() {
+    int n = 0;
+    for(n=0; n<NUM_ROBOT_COUNTS; n++) {
+        fprintf(stderr, "exchanges, %d robots\n", robotCounts[n]);
+        report("exchanges_blocking", robotCounts[n], runExchanges(robotCounts[n], 0), "exchanges/s");
+        report("exchanges_async4", robotCounts[n], runExchanges(robotCounts[n], 4), "exchanges/s");
+    }
+}
+
+int main(void) {
+    usb_set_transport(&mockTransport);
+    mock_set_base_stations(1);
+
+    printf("benchmark,robots,value,unit\n");
+    benchCalls();
+    benchFrames();
+    benchCodec();
+    benchContention();
+    benchExchanges();
+    return 0;
+}
@@ -1,7 +1,15 @@
 
 #include "elisa3-lib.h"
+#include "timing.h"
+#include "packet-codec.h"
+#include "flight-recorder.h"
+#include "shared-export.h"
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
 #if defined(_WIN32) || defined(_WIN64)
     #include "windows.h"
+    #include <malloc.h>
 #endif
 
 #if defined(__linux__) || defined(__APPLE__)
@@ -37,6 +45,9 @@
 #define PACKETS_SIZE 64
 #define OVERHEAD_SIZE (2*NUM_ROBOTS+1)
 #define UNUSED_BYTES 3
+#define NO_ROBOT -1
+#define MAX_ADDRESS 0xFFFF
+#define MAX_ROBOTS MAX_ADDRESS     // the robot index+1 is stored in 16 bits in the address table
 
 // The usb buffer between the pc and the base-station is 64 bytes.
 // Each packet exchanged with the bast-station must contain as the
@@ -75,56 +86,249 @@
 // - address: 2 bytes per robot
 
 
-// robots
-int robotAddress[100];
-char leftSpeed[100];
-char rightSpeed[100];
-char redLed[100], greenLed[100], blueLed[100];
-unsigned int proxValue[100][8];
-unsigned int proxAmbientValue[100][8];
-unsigned int groundValue[100][4];
-unsigned int groundAmbientValue[100][4];
-unsigned int batteryAdc[100];
-unsigned int batteryPercent[100];
-signed int accX[100], accY[100], accZ[100];
-unsigned char selector[100];
-unsigned char tvRemote[100];
-unsigned char flagsRX[100];
-unsigned char flagsTX[100][2];
-unsigned char smallLeds[100];
-signed long int leftMotSteps[100], rightMotSteps[100];
-signed int robTheta[100], robXPos[100], robYPos[100];
-unsigned char sleepEnabledFlag[100];
-unsigned int heading[100];
-signed int gyroZ[100];
+#define DEFAULT_TRANSFER_PERIOD_US 4000
+#define ADAPTIVE_MIN_PERIOD_US 250      // adaptive pacing: bounds of the period...
+#define ADAPTIVE_MAX_PERIOD_US 50000
+#define ADAPTIVE_MARGIN 8               // ...kept 1/8 above the time the exchanges take
+#define ADAPTIVE_PROBE 64               // reduction (1/64 of the period) at each exchange succeeded
+#define LIVENESS_FAILURES 20            // consecutive failed exchanges after which a robot is unreachable...
+#define PROBE_MIN_US 50000              // ...and only probed, the interval between two probes doubles at each failure
+#define PROBE_MAX_US 2000000
+#define MAX_SUBSCRIPTIONS 64
+#define COMMAND_QUEUE_SIZE 1024     // power of 2
+#define STATS_SECONDS 10            // RF statistics: buckets of 1 second for the last 10 seconds...
+#define STATS_TENS 6                // ...and of 10 seconds for the last minute
+
+#define TX_COMMANDS_SIZE offsetof(struct robotTx, calibrationSent)   // part of the TX record sent to the robot
+#define FRAME_PUBLISHED 1   // low bit of "publishedFrame": the frame wasn't yet taken by the communication threads
+
+// The layout of the shared-memory export doesn't depend on the library constants (see "shared-export.h").
+typedef char exportLayoutCheck[(EXPORT_MAX_LINKS==USB_MAX_DEVICES && EXPORT_PACKET_TYPES==RX_PACKET_TYPES && EXPORT_LATENCY_BUCKETS==LATENCY_BUCKETS) ? 1 : -1];
+
+struct elisa3_ctx;
+
+// Timed commands of a robot (see "applyDueCommands"): single producer (the user) / single consumer (the communication
+// thread of the robot) queue, the indexes only grow (wrapping) and each side writes its own cache line.
+struct commandQueue {
+    unsigned int head __attribute__((aligned(64)));     // next command written (user)
+    unsigned int clearTo;                               // the commands before this index are dropped (user)
+    unsigned int tail __attribute__((aligned(64)));     // next command applied (communication thread)
+    timedCommand commands[COMMAND_QUEUE_SIZE] __attribute__((aligned(64)));
+};
+
+// Scheduling state of a robot (see "scheduleSlots"), used by the communication thread of its link.
+struct robotSched {
+    struct robotTx lastSent;            // commands of the last packet sent to the robot
+    unsigned long long pendingSince;    // time the commands were found changed, 0 if they weren't
+    unsigned long long lastTxTime;
+    unsigned long long lastRxTime;
+    unsigned long updatePeriodUs;       // set by the user with "mutexTx" locked
+    struct commandQueue *commands;      // allocated at the first command queued, freed with the robots table
+    unsigned long long unackedSince;    // first change of the commands not yet acknowledged, 0 if none
+    unsigned int unackedSeq;            // first packet that carried it
+    unsigned int failures;              // consecutive failed exchanges, the robot is unreachable from LIVENESS_FAILURES
+    unsigned int probesFailed;          // failed exchanges since the robot is unreachable
+    unsigned long long probeTime;       // unreachable robot: time of the next probe
+};
+
+// RF outcomes of the exchanges with a robot, counted per second and per 10 seconds (each bucket is tagged with its
+// time so that the old buckets are recycled on the fly). Written by the communication thread of the robot inside the
+// sequence lock of its sensors data ("rxSeq"), read without locks.
+struct robotStats {
+    unsigned int secondTag[STATS_SECONDS];
+    unsigned int tenTag[STATS_TENS];
+    unsigned short second[STATS_SECONDS][RF_OUTCOMES];
+    unsigned short ten[STATS_TENS][RF_OUTCOMES];
+};
+
+// Commands of the whole swarm (see "getCommandFrame"). Three frames rotate without locks: the one filled by the user
+// ("userFrame"), the one published ("publishedFrame", a single pointer exchanged by both sides) and the one applied by
+// the communication threads ("appliedFrame", with "mutexTx" locked); each frame belongs to one side at a time.
+struct commandFrame {
+    int numRobots;
+    int capacity;
+    robotCommand commands[];
+};
+
+// Robots of a packet, in slot order, and its sequence number and time of transfer; the content and the outcome are
+// kept for the flight recorder.
+struct packetInfo {
+    int robots[NUM_ROBOTS];
+    int address[NUM_ROBOTS];
+    unsigned int seq;
+    int usbError;
+    unsigned long long txTime;
+    char tx[PACKETS_SIZE];
+    struct robotTx sent[NUM_ROBOTS];    // commands encoded, the robots "lastSent" once the packet is sent (see "txPacketSent")
+};
+
+// Subscription to the sensors data of a robot (see "notifySubscribers"), delivered either to a callback or to a ring.
+struct subscription {
+    unsigned char active;
+    int robotAddr;
+    unsigned int packetTypes;
+    sensorsCallback callback;
+    void *userData;
+    sensorsRing *ring;
+};
+
+// Single producer / single consumer queue: the communication threads push one at a time ("mutexSubs" locked), the
+// consumer pops without locking. The two indexes are on different cache lines and only grow (wrapping), the
+// events are published by the release store of "head".
+struct sensorsRing {
+    unsigned int head __attribute__((aligned(64)));     // next event written (producer)
+    unsigned long lost;
+    unsigned int tail __attribute__((aligned(64)));     // next event read (consumer)
+    unsigned int mask;
+    sensorsEvent events[] __attribute__((aligned(64)));
+};
 
 // Communication
-char RX_buffer[64]={0};         // Last packet received from base station
-char TX_buffer[64]={0};         // Next packet to send to base station
+// One link (with its own communication thread) for each base-station of the context; the groups of 4 robots
+// are spread among the links: group "g" is handled by link "g % numLinks". Each packet is then filled with the
+// robots of the link chosen by the slots scheduler.
+struct commLink {
+    struct elisa3_ctx *ctx;
+    int index;                  // link index in the context
+    int device;                 // base-station index (see "usb_num_devices")
+    char RX_buffer[64];         // Last packet received from base station
+    char TX_buffer[64];         // Next packet to send to base station
+    int txSlots[NUM_ROBOTS];    // robots of the last packet sent
+    int rxSlots[NUM_ROBOTS];    // robots of the packet currently decoded (NO_ROBOT when none), they differ from "txSlots" when the exchanges are pipelined
+    struct packetInfo inFlight[USB_MAX_ASYNC_DEPTH+1];  // queued exchanges, indexed by the exchange tag
+    int nextTag;
+    unsigned int packetSeq;
+    unsigned int usbLatency[LATENCY_BUCKETS];   // histograms written by the link thread only, read without locks
+    unsigned long usbErrors;    // exchanges failed (send or receive error)
+    unsigned long long usbErrorReportTime;  // last usb error printed (see "linkUsbError")
+    unsigned long periodUs;     // period of the exchanges of this base-station (see "setAdaptiveTransfer")
+    unsigned long long transferAvgUs;   // average time spent in the transfer functions
+    unsigned int ackLatency[LATENCY_BUCKETS];
+    unsigned long long usbLatencyMax, ackLatencyMax;
+    slotCandidate *candidates;  // scheduler input, grown with the robots list
+    int *candidateIds;
+    int candidateCapacity;
+    unsigned char payloadId;    // This is needed to differentiate the content of all packets sent to the robots, otherwise in case the payload is the same the packet isn't received by the robot.
 #if defined(_WIN32) || defined(_WIN64)
-DWORD commThreadId;
-HANDLE commThread;
-HANDLE mutexTx;
-HANDLE mutexRx;
-HANDLE mutexThread;
+    DWORD commThreadId;
+    HANDLE commThread;
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-pthread_t commThread;
-pthread_mutex_t mutexTx;
-pthread_mutex_t mutexRx;
-pthread_mutex_t mutexThread;
+    pthread_t commThread;
 #endif
-double numOfErrors[100], numOfPackets=0, errorPercentage[100];
-unsigned char lastMessageSentFlag[100];
-unsigned char calibrationSent[100];
-unsigned char calibrateOdomSent[100];
-unsigned char stopTransmissionFlag = 0;
-unsigned int currNumRobots = 0;
-unsigned int currPacketId = 0;
-unsigned char usbCommOpenedFlag = 0;
-unsigned char payloadId = 0; // This is needed to differentiate the content of all packets sent to the robots, otherwise in case the payload is the same the packet isn't received by the robot.
+} __attribute__((aligned(64)));     // each link is written by its own thread
+
+// The whole state of a swarm, nothing is shared between two contexts except the usb devices list.
+// The context is aligned (and allocated) on a cache line boundary so that two swarms never share a cache line.
+struct elisa3_ctx {
+    // robots: the records point into "robotArena" (see "growRobotTable"), "robotCapacity" records each
+    void *robotArena;
+    void *retiredArenas;    // previous arenas, readers could still be using them, freed with the context
+    unsigned int robotCapacity;
+    struct robotTx *tx;
+    struct robotRx *rx;
+    struct robotSched *sched;
+    struct robotStats *stats;
+    struct robotTable *table;       // header of "robotArena", for the calls that don't lock (see "lookupRobot")
+    unsigned int tableWriters;      // setters writing in the table (see "beginTxUpdate")
+    unsigned char tableGrowing;
+#if defined(_WIN32) || defined(_WIN64)
+    SRWLOCK mutexTable;             // zero is the initial state of both (SRWLOCK_INIT, CONDITION_VARIABLE_INIT)
+    CONDITION_VARIABLE tableEvent;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_t mutexTable;     // valid for the whole life of the context, the table can grow before the start
+    pthread_cond_t tableEvent;      // signaled (with "mutexTable") when the last writer ends or the table is replaced
+#endif
+    unsigned short addressToId[MAX_ADDRESS+1];  // robot index+1 of each address, 0 if the address isn't in the list
+    int numMappedRobots;
+
+    // Communication
+    struct commLink links[USB_MAX_DEVICES];
+    int numLinks;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE mutexTx;
+    CRITICAL_SECTION mutexRx;       // a critical section, it is used with the condition variable
+    HANDLE mutexThread;
+    CONDITION_VARIABLE rxEvent;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_t mutexTx;
+    pthread_mutex_t mutexRx;
+    pthread_mutex_t mutexThread;
+    pthread_cond_t rxEvent;         // signaled (with "mutexRx") when a robot acknowledges its current message
+#endif
+    unsigned int rxWaiters;         // threads waiting on "rxEvent"
+    struct flightRecorder *recorder;    // NULL when not recording, changed with "mutexRx" locked
+    struct sharedExport *sharedExport;  // NULL when not exporting, changed and written with "mutexRx" locked
+
+    // Subscriptions, modified and notified with "mutexSubs" locked (recursive: a callback can change them)
+    struct subscription subs[MAX_SUBSCRIPTIONS];
+    int subsEnd;                    // the subscriptions in use are below this index
+    int numSubscriptions;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE mutexSubs;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_t mutexSubs;
+#endif
+    unsigned int swarmRxSeq;
+    unsigned char stopTransmissionFlag;
+    unsigned int currNumRobots;
+    unsigned int rosterEpoch;       // incremented at each change of the robots list
+    struct commandFrame *userFrame;
+    unsigned long publishedFrame;   // frame pointer | FRAME_PUBLISHED
+    struct commandFrame *appliedFrame;
+    unsigned int asyncDepthRequested;
+    unsigned char adaptiveTransfer;
+    slotScheduler scheduler;        // NULL for "schedulePriority"
+    void *schedulerData;
+    unsigned char commThreadRunning;
+    unsigned char usbCommOpenedFlag;
+    unsigned long transferPeriodUs;
+    unsigned long jitterLastUs, jitterMaxUs;
+    double jitterSumUs, jitterSamples;
+} __attribute__((aligned(64)));
+
+// Context used by the original api (functions without the "elisa3_" prefix).
+elisa3_ctx defaultCtx = {
+    .transferPeriodUs = DEFAULT_TRANSFER_PERIOD_US,
+#if defined(__linux__) || defined(__APPLE__)
+    .mutexTable = PTHREAD_MUTEX_INITIALIZER,
+    .tableEvent = PTHREAD_COND_INITIALIZER
+#endif
+};
+
+#define ARENA_ALIGN 64  // the records arrays start on their own cache line
+#define ARENA_HEADER ARENA_ALIGN    // holds the "robotTable" of the arena
+
+// Records of the robots of an arena, at its start. The getters and the setters (see "beginTxUpdate") load the
+// table once, after the robot index (see "lookupRobot"), and use it for the whole call: the index is within the
+// table and a table is never freed before the context, at worst it is a table just replaced by a bigger one.
+struct robotTable {
+    void *retired;              // previous arena, the retired arenas are linked through their first bytes
+    unsigned int capacity;
+    struct robotTx *tx;
+    struct robotRx *rx;
+    struct robotSched *sched;
+    struct robotStats *stats;
+};
+
+// Base-stations in use by each context; a base-station can be driven by only one context at a time.
+elisa3_ctx *baseStationOwner[USB_MAX_DEVICES];
+
+// Context of the communication thread running, NULL in the other threads: the waits for the robots can't be called from
+// the callbacks (see "waitMessagesSent").
+static __thread elisa3_ctx *commThreadCtx = NULL;
 
 // functions declaration
+void commLoop(struct commLink *link);
+void completeExchangeAsync(struct commLink *link);
+void freeRobotTable(elisa3_ctx *ctx);
+int growRobotTable(elisa3_ctx *ctx, unsigned int numRobots);
+void resetSentFlag(elisa3_ctx *ctx, struct robotTable *table, int id);
+void initMutexTable(elisa3_ctx *ctx);
+void destroyMutexTable(elisa3_ctx *ctx);
 #if defined(_WIN32) || defined(_WIN64)
 DWORD WINAPI CommThread( LPVOID lpParameter);
 #endif
@@ -132,14 +336,6 @@ DWORD WINAPI CommThread( LPVOID lpParameter);
 void *CommThread(void *arg);
 #endif
 
-char speed(char value) {
-    if(value >= 0) {
-        return (value|0x80);
-    } else {
-        return ((-value)&0x7F);
-    }
-}
-
 int computeVerticalAngle(signed int x, signed int y) {
 
     int currentAngle = 0;
@@ -154,188 +350,767 @@ int computeVerticalAngle(signed int x, signed int y) {
 
 }
 
-int getIdFromAddress(int address) {
+int getIdFromAddress(elisa3_ctx *ctx, int address) {
+    int id=0;
+    if(address<0 || address>MAX_ADDRESS) {
+        return -1;
+    }
+    id = (int)__atomic_load_n(&ctx->addressToId[address], __ATOMIC_ACQUIRE) - 1;
+    if(id >= (int)ctx->currNumRobots) {   // robot not yet (or no more) part of the list
+        return -1;
+    }
+    return id;
+}
+
+struct robotTable *loadTable(elisa3_ctx *ctx) {
+    return __atomic_load_n(&ctx->table, __ATOMIC_ACQUIRE);
+}
+
+// Index of a robot and the table to use for it during the whole call (see "robotTable"): the table is loaded after
+// the index, thus it is at least the one the index was published with.
+int lookupRobot(elisa3_ctx *ctx, int address, struct robotTable **table) {
+    int id = getIdFromAddress(ctx, address);
+    *table = loadTable(ctx);
+    return id;
+}
+
+// The address to index table is modified only with "mutexTx" locked, each entry is updated with a single
+// store thus a concurrent lookup gets either the old or the new index of the robot, never a wrong one. The entries
+// are stored with release semantic after the robots table grown for them is published (see "growRobotTable").
+// When the same address is present more than once in the list the lowest index is used (as a linear search).
+void unmapAddress(elisa3_ctx *ctx, int robotIndex) {
     int i=0;
-    for(i=0; i<currNumRobots; i++) {
-        if(address == robotAddress[i]) {
-            return i;
+    int address = ctx->tx[robotIndex].robotAddress;
+    if(address<0 || address>MAX_ADDRESS || ctx->addressToId[address]!=robotIndex+1) {
+        return;
+    }
+    for(i=0; i<ctx->numMappedRobots; i++) {
+        if(i!=robotIndex && ctx->tx[i].robotAddress==address) {
+            break;
         }
     }
-    return -1;
+    __atomic_store_n(&ctx->addressToId[address], (i<ctx->numMappedRobots)?(unsigned short)(i+1):0, __ATOMIC_RELEASE);
 }
 
-void startCommunication(int *robotAddr, int numRobots) {
-    if(usbCommOpenedFlag==1) {
+void mapAddress(elisa3_ctx *ctx, int robotIndex, int robotAddr) {
+    unsigned short currId = 0;
+    ctx->tx[robotIndex].robotAddress = robotAddr;
+    if(robotAddr<0 || robotAddr>MAX_ADDRESS) {
         return;
     }
-    openCommunication();
-    TX_buffer[0]=0x27;
-    for(int i=0; i<100; i++) {
-        errorPercentage[i] = 100.0;
+    currId = ctx->addressToId[robotAddr];
+    if(currId==0 || currId>robotIndex+1) {
+        __atomic_store_n(&ctx->addressToId[robotAddr], (unsigned short)(robotIndex+1), __ATOMIC_RELEASE);
+    }
+}
+
+void setAddressEntry(elisa3_ctx *ctx, int robotIndex, int robotAddr) {
+    if(ctx->tx[robotIndex].robotAddress == robotAddr) {
+        return;
+    }
+    unmapAddress(ctx, robotIndex);
+    mapAddress(ctx, robotIndex, robotAddr);
+}
+
+void setAddressTable(elisa3_ctx *ctx, int *robotAddr, int numRobots) {
+    int i=0, id=0, address=0;
+    // new entries first (from the last so that the lowest index wins), then the addresses no more in the list
+    // are removed: the robots present in both lists are always found during the update
+    for(i=numRobots-1; i>=0; i--) {
+        address = robotAddr[i];
+        if(address>=0 && address<=MAX_ADDRESS) {
+            __atomic_store_n(&ctx->addressToId[address], (unsigned short)(i+1), __ATOMIC_RELEASE);
+        }
+    }
+    for(i=0; i<ctx->numMappedRobots; i++) {
+        address = ctx->tx[i].robotAddress;
+        if(address<0 || address>MAX_ADDRESS) {
+            continue;
+        }
+        id = (int)ctx->addressToId[address]-1;
+        if(id<0 || id>=numRobots || robotAddr[id]!=address) {
+            __atomic_store_n(&ctx->addressToId[address], 0, __ATOMIC_RELEASE);
+        }
+    }
+    for(i=0; i<numRobots; i++) {
+        ctx->tx[i].robotAddress = robotAddr[i];
+    }
+    ctx->numMappedRobots = numRobots;
+}
+
+void *alignedAlloc(size_t size) {
+    void *ptr = NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    ptr = _aligned_malloc(size, ARENA_ALIGN);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    if(posix_memalign(&ptr, ARENA_ALIGN, size) != 0) {
+        ptr = NULL;
+    }
+#endif
+    return ptr;
+}
+
+void alignedFree(void *ptr) {
+#if defined(_WIN32) || defined(_WIN64)
+    _aligned_free(ptr);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    free(ptr);
+#endif
+}
+
+// Return 0 if the communication is started (or already running), -1 otherwise.
+int startContext(elisa3_ctx *ctx, int *robotAddr, int numRobots, int firstBaseStation, int numBaseStations) {
+    int i = 0;
+    elisa3_ctx *owner = NULL;
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_condattr_t condAttr;
+    pthread_mutexattr_t mutexAttr;
+#endif
+    if(ctx->usbCommOpenedFlag==1) {
+        return 0;
     }
+    // the communication threads always need a whole packet of robots
+    if(growRobotTable(ctx, (numRobots>0 && numRobots<=MAX_ROBOTS) ? numRobots : 4) < 0) {
+        fprintf(stderr, "Cannot allocate the robots table\n");
+        return -1;
+    }
+
+    openCommunication();
+    // use the base-stations requested that aren't already driven by another context (all the free ones from "firstBaseStation" when "numBaseStations" is 0)
+    if(firstBaseStation < 0) {
+        firstBaseStation = 0;
+    }
+    if(numBaseStations <= 0 || firstBaseStation+numBaseStations > usb_num_devices()) {
+        numBaseStations = usb_num_devices()-firstBaseStation;
+    }
+    ctx->numLinks = 0;
+    for(i=firstBaseStation; i<firstBaseStation+numBaseStations; i++) {
+        owner = NULL;   // claimed atomically, the contexts can be started from different threads
+        if(__atomic_compare_exchange_n(&baseStationOwner[i], &owner, ctx, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            ctx->links[ctx->numLinks++].device = i;
+        }
+    }
+    if(ctx->numLinks < 1) {     // every exchange would fail
+        fprintf(stderr, "No base-station available\n");
+        closeCommunication();
+        return -1;
+    }
+    for(i=0; i<ctx->numLinks; i++) {
+        ctx->links[i].ctx = ctx;
+        ctx->links[i].index = i;
+        ctx->links[i].TX_buffer[0] = CODEC_TX_CMD_ROBOTS;
+        memset(ctx->links[i].txSlots, NO_ROBOT, sizeof(ctx->links[i].txSlots));
+        memset(ctx->links[i].rxSlots, NO_ROBOT, sizeof(ctx->links[i].rxSlots));
+        ctx->links[i].nextTag = 0;
+        ctx->links[i].packetSeq = 0;
+        ctx->links[i].payloadId = 0;
+        ctx->links[i].usbErrorReportTime = 0;
+    }
+    ctx->commThreadRunning = 1;
 
 #if defined(_WIN32) || defined(_WIN64)
-    commThread = CreateThread(NULL, 0, CommThread, NULL, 0, &commThreadId);
-    mutexTx = CreateMutex(NULL, FALSE, NULL);
-    mutexRx = CreateMutex(NULL, FALSE, NULL);
-    mutexThread = CreateMutex(NULL, FALSE, NULL);
+    ctx->mutexTx = CreateMutex(NULL, FALSE, NULL);
+    InitializeCriticalSection(&ctx->mutexRx);
+    ctx->mutexThread = CreateMutex(NULL, FALSE, NULL);
+    ctx->mutexSubs = CreateMutex(NULL, FALSE, NULL);
+    InitializeConditionVariable(&ctx->rxEvent);
+    for(i=0; i<ctx->numLinks; i++) {
+        ctx->links[i].commThread = CreateThread(NULL, 0, CommThread, &ctx->links[i], 0, &ctx->links[i].commThreadId);
+    }
 #endif
 
 #if defined(__linux__) || defined(__APPLE__)
-    if(pthread_create(&commThread, NULL, CommThread, NULL)) {
-        fprintf(stderr, "Error creating thread\n");
+    if (pthread_mutex_init(&ctx->mutexTx, NULL) != 0) {
+        printf("\n mutex init failed\n");
     }
-    if (pthread_mutex_init(&mutexTx, NULL) != 0) {
+    if (pthread_mutex_init(&ctx->mutexRx, NULL) != 0) {
         printf("\n mutex init failed\n");
     }
-    if (pthread_mutex_init(&mutexRx, NULL) != 0) {
+    if (pthread_mutex_init(&ctx->mutexThread, NULL) != 0) {
         printf("\n mutex init failed\n");
     }
-    if (pthread_mutex_init(&mutexThread, NULL) != 0) {
+    pthread_mutexattr_init(&mutexAttr);
+    pthread_mutexattr_settype(&mutexAttr, PTHREAD_MUTEX_RECURSIVE);
+    if (pthread_mutex_init(&ctx->mutexSubs, &mutexAttr) != 0) {
         printf("\n mutex init failed\n");
     }
+    pthread_mutexattr_destroy(&mutexAttr);
+    pthread_condattr_init(&condAttr);
+#if defined(__linux__)
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);  // same clock as "getTimeUs"
+#endif
+    if (pthread_cond_init(&ctx->rxEvent, &condAttr) != 0) {
+        printf("\n condition init failed\n");
+    }
+    pthread_condattr_destroy(&condAttr);
+    for(i=0; i<ctx->numLinks; i++) {
+        if(pthread_create(&ctx->links[i].commThread, NULL, CommThread, &ctx->links[i])) {
+            fprintf(stderr, "Error creating thread\n");
+        }
+    }
 #endif
 
-    setRobotAddresses(robotAddr, numRobots);
+    elisa3_setRobotAddresses(ctx, robotAddr, numRobots);
+    // the first data of the robots are awaited only here, the later changes of the list don't block
+    elisa3_waitForUpdateGroup(ctx, robotAddr, numRobots, 100000, NULL);
 
-    usbCommOpenedFlag = 1;
+    ctx->usbCommOpenedFlag = 1;
+    return 0;
 
 }
 
-void stopCommunication() {
+void stopContext(elisa3_ctx *ctx) {
+    int i = 0;
+    if(ctx->usbCommOpenedFlag==0) {
+        return;
+    }
+
+    // the thread exits at the end of the current exchange (it could be in the middle of an usb transfer)
+    ctx->commThreadRunning = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+    for(i=0; i<ctx->numLinks; i++) {
+        WaitForSingleObject(ctx->links[i].commThread, INFINITE);
+        CloseHandle(ctx->links[i].commThread);
+    }
+    CloseHandle(ctx->mutexTx);
+    DeleteCriticalSection(&ctx->mutexRx);
+    CloseHandle(ctx->mutexThread);
+    CloseHandle(ctx->mutexSubs);
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+    for(i=0; i<ctx->numLinks; i++) {
+        pthread_join(ctx->links[i].commThread, NULL);
+    }
+	pthread_mutex_destroy(&ctx->mutexTx);
+	pthread_mutex_destroy(&ctx->mutexRx);
+	pthread_mutex_destroy(&ctx->mutexThread);
+	pthread_mutex_destroy(&ctx->mutexSubs);
+	pthread_cond_destroy(&ctx->rxEvent);
+#endif
+
+    for(i=0; i<ctx->numLinks; i++) {
+        free(ctx->links[i].candidates);
+        free(ctx->links[i].candidateIds);
+        ctx->links[i].candidates = NULL;
+        ctx->links[i].candidateIds = NULL;
+        ctx->links[i].candidateCapacity = 0;
+    }
+
+    for(i=0; i<ctx->numLinks; i++) {
+        __atomic_store_n(&baseStationOwner[ctx->links[i].device], NULL, __ATOMIC_RELEASE);
+    }
+
     closeCommunication();
 
+    ctx->usbCommOpenedFlag = 0;
+
+}
+
+elisa3_ctx* elisa3_startCommunication(int *robotAddr, int numRobots, int firstBaseStation, int numBaseStations) {
+    elisa3_ctx *ctx = alignedAlloc(sizeof(elisa3_ctx));
+    if(ctx == NULL) {
+        return NULL;
+    }
+    memset(ctx, 0, sizeof(elisa3_ctx));
+    ctx->transferPeriodUs = DEFAULT_TRANSFER_PERIOD_US;
+    initMutexTable(ctx);
+    if(startContext(ctx, robotAddr, numRobots, firstBaseStation, numBaseStations) < 0) {
+        freeRobotTable(ctx);
+        destroyMutexTable(ctx);
+        alignedFree(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void elisa3_stopCommunication(elisa3_ctx *ctx) {
+    int i = 0;
+    if(ctx == NULL) {
+        return;
+    }
+    stopContext(ctx);
+    recorderClose(ctx->recorder);
+    exportClose(ctx->sharedExport);
+    for(i=0; i<ctx->subsEnd; i++) {    // queues not unsubscribed
+        if(ctx->subs[i].active && ctx->subs[i].ring != NULL) {
+            alignedFree(ctx->subs[i].ring);
+        }
+    }
+    freeRobotTable(ctx);
+    free(ctx->userFrame);
+    free((struct commandFrame*)(ctx->publishedFrame & ~(unsigned long)FRAME_PUBLISHED));
+    free(ctx->appliedFrame);
+    destroyMutexTable(ctx);
+    alignedFree(ctx);
+}
+
+void setMutexTx(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(ctx->mutexTx, INFINITE);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&ctx->mutexTx);
+#endif
+}
+
+void freeMutexTx(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseMutex(ctx->mutexTx);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&ctx->mutexTx);
+#endif
+}
+
+void setMutexRx(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    EnterCriticalSection(&ctx->mutexRx);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&ctx->mutexRx);
+#endif
+}
+
+void freeMutexRx(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    LeaveCriticalSection(&ctx->mutexRx);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&ctx->mutexRx);
+#endif
+}
+
+// Sleep until "rxEvent" is signaled or "us" elapsed, to be called with "mutexRx" locked (it is released meanwhile).
+void waitRxEvent(elisa3_ctx *ctx, unsigned long long us) {
+#if defined(_WIN32) || defined(_WIN64)
+    SleepConditionVariableCS(&ctx->rxEvent, &ctx->mutexRx, (DWORD)((us+999)/1000));
+#endif
+#if defined(__linux__)
+    struct timespec ts;
+    unsigned long long deadline = getTimeUs()+us;
+    ts.tv_sec = deadline/1000000;
+    ts.tv_nsec = (deadline%1000000)*1000;
+    pthread_cond_timedwait(&ctx->rxEvent, &ctx->mutexRx, &ts);
+#endif
+#if defined(__APPLE__)
+    struct timespec ts;
+    ts.tv_sec = us/1000000;
+    ts.tv_nsec = (us%1000000)*1000;
+    pthread_cond_timedwait_relative_np(&ctx->rxEvent, &ctx->mutexRx, &ts);
+#endif
+}
+
+void signalRxEvent(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    TerminateThread(commThread, 0);
-    CloseHandle(commThread);
-    CloseHandle(mutexTx);
-    CloseHandle(mutexRx);
-    CloseHandle(mutexThread);
+    WakeAllConditionVariable(&ctx->rxEvent);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_cond_broadcast(&ctx->rxEvent);
+#endif
+}
+
+void setMutexThread(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(ctx->mutexThread, INFINITE);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&ctx->mutexThread);
 #endif
+}
 
+void freeMutexThread(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseMutex(ctx->mutexThread);
+#endif
 #if defined(__linux__) || defined(__APPLE__)
-	pthread_cancel(commThread);
-	pthread_mutex_destroy(&mutexTx);
-	pthread_mutex_destroy(&mutexRx);
-	pthread_mutex_destroy(&mutexThread);
+    pthread_mutex_unlock(&ctx->mutexThread);
 #endif
+}
 
-    usbCommOpenedFlag = 0;
+// "mutexTable" and "tableEvent" are created with the context (statically for "defaultCtx"), not by "startContext":
+// the table grows before the communication is started.
+void initMutexTable(elisa3_ctx *ctx) {
+#if defined(_WIN32) || defined(_WIN64)
+    InitializeSRWLock(&ctx->mutexTable);
+    InitializeConditionVariable(&ctx->tableEvent);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    if (pthread_mutex_init(&ctx->mutexTable, NULL) != 0) {
+        printf("\n mutex init failed\n");
+    }
+    if (pthread_cond_init(&ctx->tableEvent, NULL) != 0) {
+        printf("\n condition init failed\n");
+    }
+#endif
+}
 
+void destroyMutexTable(elisa3_ctx *ctx) {
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_destroy(&ctx->mutexTable);
+    pthread_cond_destroy(&ctx->tableEvent);
+#endif
 }
 
-void setMutexTx() {
+void setMutexTable(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexTx, INFINITE);
+    AcquireSRWLockExclusive(&ctx->mutexTable);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexTx);
+    pthread_mutex_lock(&ctx->mutexTable);
 #endif
 }
 
-void freeMutexTx() {
+void freeMutexTable(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexTx);
+    ReleaseSRWLockExclusive(&ctx->mutexTable);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexTx);
+    pthread_mutex_unlock(&ctx->mutexTable);
 #endif
 }
 
-void setMutexRx() {
+// Sleep until "tableEvent" is signaled, to be called with "mutexTable" locked (it is released meanwhile).
+void waitTableEvent(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexRx, INFINITE);
+    SleepConditionVariableSRW(&ctx->tableEvent, &ctx->mutexTable, INFINITE, 0);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexRx);
+    pthread_cond_wait(&ctx->tableEvent, &ctx->mutexTable);
 #endif
 }
 
-void freeMutexRx() {
+void signalTableEvent(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexRx);
+    WakeAllConditionVariable(&ctx->tableEvent);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexRx);
+    pthread_cond_broadcast(&ctx->tableEvent);
 #endif
 }
 
-void setMutexThread() {
+void setMutexSubs(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexThread, INFINITE);
+    WaitForSingleObject(ctx->mutexSubs, INFINITE);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexThread);
+    pthread_mutex_lock(&ctx->mutexSubs);
 #endif
 }
 
-void freeMutexThread() {
+void freeMutexSubs(elisa3_ctx *ctx) {
 #if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexThread);
+    ReleaseMutex(ctx->mutexSubs);
 #endif
 #if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexThread);
+    pthread_mutex_unlock(&ctx->mutexSubs);
 #endif
 }
 
-unsigned char checkConcurrency(int id) {
-    int packetId = currPacketId;
-    if(id>=(packetId*4+0) && id<=(packetId*4+3)) {    // the current robot data could be accessed concurrently so beware!
-        return 1;
-    } else {
+// Make room for "numRobots" robots (rounded up to whole packets of 4 robots, the last packet is always sent complete).
+// The records are copied to a new arena, bigger by at least half of the current one so that a swarm growing a bit at a
+// time isn't copied at each change, and published while the communication threads are locked out. Readers could still
+// be using the previous arena: it is kept until the context is freed and its sequence counters are changed so that a
+// read started on it is retried.
+int growRobotTable(elisa3_ctx *ctx, unsigned int numRobots) {
+    unsigned int capacity = 0, oldCapacity = ctx->robotCapacity, j = 0;
+    char *arena = NULL, *oldArena = ctx->robotArena;
+    struct robotTx *tx = NULL;
+    struct robotRx *rx = NULL;
+    struct robotSched *sched = NULL;
+    struct robotStats *stats = NULL;
+    struct robotTable *table = NULL;
+
+    numRobots = (numRobots+3)/4*4;
+    if(numRobots <= oldCapacity) {
         return 0;
     }
+    capacity = oldCapacity + oldCapacity/2;
+    if(capacity < numRobots) {
+        capacity = numRobots;
+    }
+    capacity = (capacity+3)/4*4;
+    arena = alignedAlloc(ARENA_HEADER + capacity*(sizeof(struct robotTx) + sizeof(struct robotRx) + sizeof(struct robotSched) + sizeof(struct robotStats)));
+    if(arena == NULL) {
+        return -1;
+    }
+    tx = (struct robotTx*)(arena + ARENA_HEADER);
+    rx = (struct robotRx*)(arena + ARENA_HEADER + capacity*sizeof(struct robotTx));    // 4 TX records per line, capacity is a multiple of 4
+    sched = (struct robotSched*)(rx + capacity);
+    stats = (struct robotStats*)(sched + capacity);
+    memset(tx, 0, capacity*sizeof(struct robotTx));
+    memset(rx, 0, capacity*sizeof(struct robotRx));
+    memset(sched, 0, capacity*sizeof(struct robotSched));
+    memset(stats, 0, capacity*sizeof(struct robotStats));
+    table = (struct robotTable*)arena;
+    table->retired = NULL;
+    table->capacity = capacity;
+    table->tx = tx;
+    table->rx = rx;
+    table->sched = sched;
+    table->stats = stats;
+
+    // the setters that start now wait for the new table (see "beginTxUpdate"), those already writing are waited
+    setMutexTable(ctx);
+    __atomic_store_n(&ctx->tableGrowing, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&ctx->tableWriters, __ATOMIC_SEQ_CST) != 0) {
+        waitTableEvent(ctx);
+    }
+    freeMutexTable(ctx);
+    if(ctx->commThreadRunning) {
+        setMutexTx(ctx);
+        setMutexRx(ctx);
+        setMutexThread(ctx);
+    }
+
+    if(oldArena != NULL) {
+        memcpy(tx, ctx->tx, oldCapacity*sizeof(struct robotTx));
+        memcpy(rx, ctx->rx, oldCapacity*sizeof(struct robotRx));
+        memcpy(sched, ctx->sched, oldCapacity*sizeof(struct robotSched));
+        memcpy(stats, ctx->stats, oldCapacity*sizeof(struct robotStats));
+    }
+    for(j=0; j<oldCapacity; j++) {
+        __atomic_store_n(&ctx->rx[j].rxSeq, ctx->rx[j].rxSeq+2, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ctx->tx, tx, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->rx, rx, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->sched, sched, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->stats, stats, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->table, table, __ATOMIC_RELEASE);     // before the address entries of the new robots
+    if(oldArena != NULL) {
+        ((struct robotTable*)oldArena)->retired = ctx->retiredArenas;
+        ctx->retiredArenas = oldArena;
+    }
+    ctx->robotArena = arena;
+    ctx->robotCapacity = capacity;
+
+    if(ctx->commThreadRunning) {
+        freeMutexThread(ctx);
+        freeMutexRx(ctx);
+        freeMutexTx(ctx);
+    }
+    setMutexTable(ctx);
+    __atomic_store_n(&ctx->tableGrowing, 0, __ATOMIC_SEQ_CST);
+    signalTableEvent(ctx);
+    freeMutexTable(ctx);
+    return 0;
 }
 
-void setLeftSpeed(int robotAddr, char value) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
-    if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
+void freeRobotTable(elisa3_ctx *ctx) {
+    void *arena = NULL;
+    unsigned int i = 0;
+    for(i=0; i<ctx->robotCapacity; i++) {  // the retired arenas hold copies of the same pointers
+        if(ctx->sched[i].commands != NULL) {
+            alignedFree(ctx->sched[i].commands);
         }
-        leftSpeed[id] = value;
-        if(enableMut) {
-            freeMutexTx();
+    }
+    while(ctx->retiredArenas != NULL) {
+        arena = ctx->retiredArenas;
+        ctx->retiredArenas = ((struct robotTable*)arena)->retired;
+        alignedFree(arena);
+    }
+    if(ctx->robotArena != NULL) {
+        alignedFree(ctx->robotArena);
+        ctx->robotArena = NULL;
+    }
+    ctx->tx = NULL;
+    ctx->rx = NULL;
+    ctx->sched = NULL;
+    ctx->stats = NULL;
+    ctx->table = NULL;
+    ctx->robotCapacity = 0;
+}
+
+unsigned char checkConcurrency(elisa3_ctx *ctx, int id) {
+    int i = 0, j = 0;
+    for(i=0; i<ctx->numLinks; i++) {
+        for(j=0; j<NUM_ROBOTS; j++) {
+            if(id==ctx->links[i].txSlots[j] || id==ctx->links[i].rxSlots[j]) {    // the current robot data could be accessed concurrently so beware!
+                return 1;
+            }
         }
     }
+    return 0;
 }
 
-void setRightSpeed(int robotAddr, char value) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
-    if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
+// Setters of a robot: they are counted in "tableWriters" while they write, "growRobotTable" waits for them before
+// copying the records and those starting meanwhile wait for the new table, thus no write is lost in a table being
+// replaced. Both sides sleep on "tableEvent", "mutexTable" is taken only while the table grows. "mutexTx" is locked
+// only when the communication threads could be using the robot (see "checkConcurrency"). Return the table to write.
+struct robotTable *beginTxUpdate(elisa3_ctx *ctx, int id, unsigned char *locked) {
+    while(1) {
+        __atomic_add_fetch(&ctx->tableWriters, 1, __ATOMIC_SEQ_CST);
+        if(!__atomic_load_n(&ctx->tableGrowing, __ATOMIC_SEQ_CST)) {
+            break;
         }
-        rightSpeed[id] = value;
-        if(enableMut) {
-            freeMutexTx();
+        setMutexTable(ctx);
+        if(__atomic_sub_fetch(&ctx->tableWriters, 1, __ATOMIC_SEQ_CST) == 0) {
+            signalTableEvent(ctx);
+        }
+        while(__atomic_load_n(&ctx->tableGrowing, __ATOMIC_SEQ_CST)) {
+            waitTableEvent(ctx);
         }
+        freeMutexTable(ctx);
     }
+    *locked = checkConcurrency(ctx, id);
+    if(*locked) {
+        setMutexTx(ctx);
+    }
+    return loadTable(ctx);
 }
 
-void setLeftSpeedForAll(char *value) {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        leftSpeed[i] = value[i];
+void endTxUpdate(elisa3_ctx *ctx, unsigned char locked) {
+    if(locked) {
+        freeMutexTx(ctx);
+    }
+    if(__atomic_sub_fetch(&ctx->tableWriters, 1, __ATOMIC_SEQ_CST)==0 && __atomic_load_n(&ctx->tableGrowing, __ATOMIC_SEQ_CST)) {
+        setMutexTable(ctx);     // the table waits for the last writer
+        signalTableEvent(ctx);
+        freeMutexTable(ctx);
     }
-    freeMutexTx();
 }
 
-void setRightSpeedForAll(char *value) {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        rightSpeed[i] = value[i];
+// The sensors data are published with a sequence lock: the communication thread (writer) makes the counter odd
+// before modifying the data of a packet and even again when done; readers copy the data and retry if the
+// counter changed meanwhile, thus they never lock and never delay the communication thread.
+// "mutexRx" is still used between writers and for the "lastMessageSentFlag" state machine.
+void beginRxUpdate(elisa3_ctx *ctx, const int *slots) {
+    int i=0;
+    __atomic_store_n(&ctx->swarmRxSeq, ctx->swarmRxSeq+1, __ATOMIC_RELAXED);
+    for(i=0; i<NUM_ROBOTS; i++) {
+        __atomic_store_n(&ctx->rx[slots[i]].rxSeq, ctx->rx[slots[i]].rxSeq+1, __ATOMIC_RELAXED);
     }
-    freeMutexTx();
+    __atomic_thread_fence(__ATOMIC_RELEASE);
 }
 
-void setRed(int robotAddr, unsigned char value) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void endRxUpdate(elisa3_ctx *ctx, const int *slots) {
+    int i=0;
+    for(i=0; i<NUM_ROBOTS; i++) {
+        __atomic_store_n(&ctx->rx[slots[i]].rxSeq, ctx->rx[slots[i]].rxSeq+1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&ctx->swarmRxSeq, ctx->swarmRxSeq+1, __ATOMIC_RELEASE);
+}
+
+unsigned int seqReadBegin(unsigned int *seq) {
+    unsigned int val = 0;
+    while((val=__atomic_load_n(seq, __ATOMIC_ACQUIRE)) & 1);   // update in progress, it lasts few microseconds
+    return val;
+}
+
+unsigned char seqReadRetry(unsigned int *seq, unsigned int val) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return (__atomic_load_n(seq, __ATOMIC_RELAXED) != val);
+}
+
+unsigned int rxReadBegin(struct robotTable *table, int id) {
+    return seqReadBegin(&table->rx[id].rxSeq);
+}
+
+unsigned char rxReadRetry(struct robotTable *table, int id, unsigned int seq) {
+    return seqReadRetry(&table->rx[id].rxSeq, seq);
+}
+
+unsigned int swarmReadBegin(elisa3_ctx *ctx) {
+    return seqReadBegin(&ctx->swarmRxSeq);
+}
+
+unsigned char swarmReadRetry(elisa3_ctx *ctx, unsigned int seq) {
+    return seqReadRetry(&ctx->swarmRxSeq, seq);
+}
+
+// Robots of the list and the table holding them, for the getters of the whole swarm: the size of the list is stored
+// (release) after the table grown for it, thus the table loaded after it holds all the robots.
+unsigned int swarmTable(elisa3_ctx *ctx, struct robotTable **table) {
+    unsigned int numRobots = __atomic_load_n(&ctx->currNumRobots, __ATOMIC_ACQUIRE);
+    *table = loadTable(ctx);
+    return numRobots;
+}
+
+void markRxUpdate(elisa3_ctx *ctx, int id, unsigned char packetType, unsigned long long rxTime) {
+    if(packetType>=3 && packetType<(3+RX_PACKET_TYPES)) {     // ids 3..7
+        ctx->rx[id].rxUpdateTime[packetType-3] = rxTime;
+        ctx->rx[id].rxUpdateCount[packetType-3]++;
+    }
+}
+
+void copySensors(struct robotTable *table, int id, robotSensors *sensors) {
+    const struct robotRx *robot = &table->rx[id];
+    int i=0;
+    for(i=0; i<RX_PACKET_TYPES; i++) {
+        sensors->updateTime[i] = robot->rxUpdateTime[i];
+        sensors->updateCount[i] = robot->rxUpdateCount[i];
+    }
+    for(i=0; i<8; i++) {
+        sensors->proximity[i] = robot->proxValue[i];
+        sensors->proximityAmbient[i] = robot->proxAmbientValue[i];
+    }
+    for(i=0; i<4; i++) {
+        sensors->ground[i] = robot->groundValue[i];
+        sensors->groundAmbient[i] = robot->groundAmbientValue[i];
+    }
+    sensors->batteryAdc = robot->batteryAdc;
+    sensors->accX = robot->accX;
+    sensors->accY = robot->accY;
+    sensors->accZ = robot->accZ;
+    sensors->gyroZ = robot->gyroZ;
+    sensors->selector = robot->selector;
+    sensors->tvRemoteCommand = robot->tvRemote;
+    sensors->flagRX = robot->flagsRX;
+    sensors->leftMotSteps = robot->leftMotSteps;
+    sensors->rightMotSteps = robot->rightMotSteps;
+    sensors->odomTheta = robot->robTheta;
+    sensors->odomXpos = robot->robXPos;
+    sensors->odomYpos = robot->robYPos;
+    sensors->heading = robot->heading;
+}
+
+void elisa3_setLeftSpeed(elisa3_ctx *ctx, int robotAddr, char value) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
+    if(id>=0) {
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].leftSpeed = value;
+        endTxUpdate(ctx, enableMut);
+    }
+}
+
+void elisa3_setRightSpeed(elisa3_ctx *ctx, int robotAddr, char value) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
+    if(id>=0) {
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].rightSpeed = value;
+        endTxUpdate(ctx, enableMut);
+    }
+}
+
+void elisa3_setLeftSpeedForAll(elisa3_ctx *ctx, char *value) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].leftSpeed = value[i];
+    }
+    freeMutexTx(ctx);
+}
+
+void elisa3_setRightSpeedForAll(elisa3_ctx *ctx, char *value) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].rightSpeed = value[i];
+    }
+    freeMutexTx(ctx);
+}
+
+void elisa3_setRed(elisa3_ctx *ctx, int robotAddr, unsigned char value) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
         if(value < 0) {
             value = 0;
@@ -343,19 +1118,16 @@ void setRed(int robotAddr, unsigned char value) {
         if(value > 100) {
             value = 100;
         }
-        if(enableMut) {
-            setMutexTx();
-        }
-        redLed[id] = value;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].redLed = value;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void setGreen(int robotAddr, unsigned char value) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_setGreen(elisa3_ctx *ctx, int robotAddr, unsigned char value) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
         if(value < 0) {
             value = 0;
@@ -363,19 +1135,16 @@ void setGreen(int robotAddr, unsigned char value) {
         if(value > 100) {
             value = 100;
         }
-        if(enableMut) {
-            setMutexTx();
-        }
-        greenLed[id] = value;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].greenLed = value;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void setBlue(int robotAddr, unsigned char value) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_setBlue(elisa3_ctx *ctx, int robotAddr, unsigned char value) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
         if(value < 0) {
             value = 0;
@@ -383,921 +1152,997 @@ void setBlue(int robotAddr, unsigned char value) {
         if(value > 100) {
             value = 100;
         }
-        if(enableMut) {
-            setMutexTx();
-        }
-        blueLed[id] = value;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].blueLed = value;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void setRedForAll(unsigned char *value) {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        if(value[i] < 0) {
-            value[i] = 0;
-        }
-        if(value[i] > 100) {
-            value[i] = 100;
-        }
-        redLed[i] = value[i];
+void elisa3_setRedForAll(elisa3_ctx *ctx, unsigned char *value) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].redLed = (value[i] > 100) ? 100 : value[i];  // the caller's array isn't modified
     }
-    freeMutexTx();
+    freeMutexTx(ctx);
 }
 
-void setGreenForAll(unsigned char *value) {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        if(value[i] < 0) {
-            value[i] = 0;
-        }
-        if(value[i] > 100) {
-            value[i] = 100;
-        }
-        greenLed[i] = value[i];
+void elisa3_setGreenForAll(elisa3_ctx *ctx, unsigned char *value) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].greenLed = (value[i] > 100) ? 100 : value[i];  // the caller's array isn't modified
     }
-    freeMutexTx();
+    freeMutexTx(ctx);
 }
 
-void setBlueForAll(unsigned char *value) {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        if(value[i] < 0) {
-            value[i] = 0;
-        }
-        if(value[i] > 100) {
-            value[i] = 100;
-        }
-        blueLed[i] = value[i];
+void elisa3_setBlueForAll(elisa3_ctx *ctx, unsigned char *value) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].blueLed = (value[i] > 100) ? 100 : value[i];  // the caller's array isn't modified
     }
-    freeMutexTx();
+    freeMutexTx(ctx);
 }
 
-void turnOnFrontIRs(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOnFrontIRs(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        FRONT_IR_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        FRONT_IR_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOffFrontIRs(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOffFrontIRs(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        FRONT_IR_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        FRONT_IR_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOnBackIR(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOnBackIR(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        BACK_IR_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        BACK_IR_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOffBackIR(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOffBackIR(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        BACK_IR_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        BACK_IR_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOnAllIRs(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOnAllIRs(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        ALL_IR_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        ALL_IR_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOffAllIRs(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOffAllIRs(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        ALL_IR_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        ALL_IR_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void enableTVRemote(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_enableTVRemote(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        TV_REMOTE_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        TV_REMOTE_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void disableTVRemote(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_disableTVRemote(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        TV_REMOTE_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        TV_REMOTE_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void enableSleep(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_enableSleep(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        SLEEP_ON(flagsTX[id][0]);
-        sleepEnabledFlag[id] = 1;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        SLEEP_ON(table->tx[id].flagsTX[0]);
+        table->tx[id].sleepEnabledFlag = 1;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void disableSleep(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_disableSleep(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        SLEEP_OFF(flagsTX[id][0]);
-        sleepEnabledFlag[id] = 0;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        SLEEP_OFF(table->tx[id].flagsTX[0]);
+        table->tx[id].sleepEnabledFlag = 0;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void enableObstacleAvoidance(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_enableObstacleAvoidance(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        OBSTACLE_AVOID_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        OBSTACLE_AVOID_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void disableObstacleAvoidance(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_disableObstacleAvoidance(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        OBSTACLE_AVOID_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        OBSTACLE_AVOID_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void enableCliffAvoidance(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_enableCliffAvoidance(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        CLIFF_AVOID_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        CLIFF_AVOID_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void disableCliffAvoidance(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_disableCliffAvoidance(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        CLIFF_AVOID_OFF(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
-    }
-}
+        table = beginTxUpdate(ctx, id, &enableMut);
+        CLIFF_AVOID_OFF(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
+    }
+}
+
+void resetRobotData(elisa3_ctx *ctx, int robotIndex) {
+    ctx->tx[robotIndex].redLed = 0;
+    ctx->tx[robotIndex].blueLed = 0;
+    ctx->tx[robotIndex].greenLed = 0;
+    ctx->tx[robotIndex].flagsTX[0] = 0;
+    ctx->tx[robotIndex].rightSpeed = 0;
+    ctx->tx[robotIndex].leftSpeed = 0;
+    ctx->tx[robotIndex].smallLeds = 0;
+    ctx->tx[robotIndex].flagsTX[1] = 0;
+    ctx->sched[robotIndex].updatePeriodUs = 0;
+    ctx->sched[robotIndex].pendingSince = 0;    // the pacing history belongs to the previous robot
+    ctx->sched[robotIndex].lastTxTime = 0;
+    ctx->sched[robotIndex].lastRxTime = 0;
+    ctx->sched[robotIndex].unackedSince = 0;
+    ctx->sched[robotIndex].failures = 0;
+    ctx->sched[robotIndex].probesFailed = 0;
+    ctx->sched[robotIndex].probeTime = 0;
+    if(ctx->sched[robotIndex].commands != NULL) {
+        __atomic_store_n(&ctx->sched[robotIndex].commands->clearTo, ctx->sched[robotIndex].commands->head, __ATOMIC_RELEASE);
+    }
+}
+
+// Clear the sensors data and the RF statistics of a robot replaced in the list (with "mutexRx" locked), so that the data
+// of the previous robot are never returned; "dataEpoch" stays 0 until a packet of the new robot is received.
+void clearRobotRx(elisa3_ctx *ctx, int robotIndex) {
+    struct robotRx *robot = &ctx->rx[robotIndex];
+    __atomic_store_n(&ctx->swarmRxSeq, ctx->swarmRxSeq+1, __ATOMIC_RELAXED);
+    __atomic_store_n(&robot->rxSeq, robot->rxSeq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memset((char*)robot+sizeof(robot->rxSeq), 0, sizeof(struct robotRx)-sizeof(robot->rxSeq));
+    memset(&ctx->stats[robotIndex], 0, sizeof(struct robotStats));
+    __atomic_store_n(&robot->rxSeq, robot->rxSeq+1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ctx->swarmRxSeq, ctx->swarmRxSeq+1, __ATOMIC_RELEASE);
+}
+
+// Shared-memory export (see "shared-export.h"), written with "mutexRx" locked: the robots are exported after each
+// decoding of their slots, the links after each exchange and the whole swarm when the list changes.
+void exportRobotState(elisa3_ctx *ctx, int id) {
+    const struct robotRx *rx = &ctx->rx[id];
+    struct exportRobot robot;
+    int i = 0;
 
-void resetRobotData(int robotIndex) {
-    redLed[robotIndex] = 0;
-    blueLed[robotIndex] = 0;
-    greenLed[robotIndex] = 0;
-    flagsTX[robotIndex][0] = 0;
-    rightSpeed[robotIndex] = 0;
-    leftSpeed[robotIndex] = 0;
-    smallLeds[robotIndex] = 0;
-    flagsTX[robotIndex][1] = 0;
+    memset(&robot, 0, sizeof(robot));
+    robot.address = ctx->tx[id].robotAddress;
+    robot.leftMotSteps = rx->leftMotSteps;
+    robot.rightMotSteps = rx->rightMotSteps;
+    for(i=0; i<RX_PACKET_TYPES; i++) {
+        robot.rxUpdateTime[i] = rx->rxUpdateTime[i];
+        robot.rxUpdateCount[i] = rx->rxUpdateCount[i];
+    }
+    robot.numOfErrors = rx->numOfErrors;
+    robot.dataEpoch = rx->dataEpoch;
+    robot.failures = ctx->sched[id].failures;
+    robot.unreachable = (robot.failures >= LIVENESS_FAILURES) ? ROBOT_UNREACHABLE : ROBOT_ALIVE;
+    memcpy(robot.proxValue, rx->proxValue, sizeof(robot.proxValue));
+    memcpy(robot.proxAmbientValue, rx->proxAmbientValue, sizeof(robot.proxAmbientValue));
+    memcpy(robot.groundValue, rx->groundValue, sizeof(robot.groundValue));
+    memcpy(robot.groundAmbientValue, rx->groundAmbientValue, sizeof(robot.groundAmbientValue));
+    robot.accX = rx->accX;
+    robot.accY = rx->accY;
+    robot.accZ = rx->accZ;
+    robot.batteryAdc = rx->batteryAdc;
+    robot.robTheta = rx->robTheta;
+    robot.robXPos = rx->robXPos;
+    robot.robYPos = rx->robYPos;
+    robot.heading = rx->heading;
+    robot.gyroZ = rx->gyroZ;
+    robot.selector = rx->selector;
+    robot.tvRemote = rx->tvRemote;
+    robot.flagsRX = rx->flagsRX;
+    robot.lastMessageSentFlag = rx->lastMessageSentFlag;
+    exportWriteRobot(ctx->sharedExport, (unsigned int)id, &robot);
+}
+
+void exportLinkState(struct commLink *link, unsigned long long rxTime) {
+    struct exportLink state;
+
+    memset(&state, 0, sizeof(state));
+    state.device = link->device;
+    state.exchanges = link->packetSeq;
+    state.usbErrors = link->usbErrors;
+    state.periodUs = link->periodUs;
+    state.transferAvgUs = link->transferAvgUs;
+    state.usbLatencyMax = link->usbLatencyMax;
+    state.ackLatencyMax = link->ackLatencyMax;
+    state.lastExchangeTime = rxTime;
+    memcpy(state.usbLatency, link->usbLatency, sizeof(state.usbLatency));
+    memcpy(state.ackLatency, link->ackLatency, sizeof(state.ackLatency));
+    exportWriteLink(link->ctx->sharedExport, (unsigned int)link->index, &state);
+}
+
+void exportSwarm(elisa3_ctx *ctx) {
+    int i = 0;
+    for(i=0; i<(int)ctx->currNumRobots; i++) {
+        exportRobotState(ctx, i);
+    }
+    exportWriteRoster(ctx->sharedExport, ctx->currNumRobots, ctx->rosterEpoch, (unsigned int)ctx->numLinks);
 }
 
-void setRobotAddress(int robotIndex, int robotAddr) {
-    unsigned char enableMut=0;
-    if(robotIndex>=0 && robotIndex<=(currNumRobots-1)) {    // the index must be within the robots list size
-        enableMut = checkConcurrency(robotIndex);
-        if(enableMut) {
-            setMutexTx();
-        }
-        robotAddress[robotIndex] = robotAddr;
-        resetRobotData(robotIndex);
-        if(enableMut) {
-            freeMutexTx();
+// The robots list is switched with "mutexTx" and "mutexRx" locked, that is between two packets (a packet is built
+// with "mutexTx" locked) and between two decodings, without waiting for the robots: each change starts a new roster
+// epoch and the sensors of the robots replaced are valid again once they answer (see "getDataEpoch"). The answers
+// to the packets built before the switch are dropped for the robots replaced (see "handleRxPacket").
+void elisa3_setRobotAddress(elisa3_ctx *ctx, int robotIndex, int robotAddr) {
+    setMutexTx(ctx);
+    setMutexRx(ctx);
+    if(robotIndex>=0 && robotIndex<(int)ctx->currNumRobots && ctx->tx[robotIndex].robotAddress!=robotAddr) {    // the index must be within the robots list size
+        resetRobotData(ctx, robotIndex);
+        clearRobotRx(ctx, robotIndex);
+        setAddressEntry(ctx, robotIndex, robotAddr);
+        __atomic_store_n(&ctx->rosterEpoch, ctx->rosterEpoch+1, __ATOMIC_RELEASE);
+        if(ctx->sharedExport != NULL) {
+            exportSwarm(ctx);
         }
-        waitForUpdate(robotAddr, 100000);   // wait for the data of the current robot are received (otherwise old data of the previous robot would be sent to the user)
     }
+    freeMutexRx(ctx);
+    freeMutexTx(ctx);
 }
 
-void setRobotAddresses(int *robotAddr, int numRobots) {
+void elisa3_setRobotAddresses(elisa3_ctx *ctx, int *robotAddr, int numRobots) {
     int i = 0;
-    setMutexTx();
-    for(i=0; i<numRobots; i++) {
-        robotAddress[i] = robotAddr[i];
-        resetRobotData(i);
+    if(numRobots<0 || numRobots>MAX_ROBOTS || (numRobots>0 && robotAddr==NULL)) {
+        return;
+    }
+    if(growRobotTable(ctx, numRobots) < 0) {
+        fprintf(stderr, "Cannot allocate the robots table\n");
+        return;
     }
-    freeMutexTx();
-    for(i=0; i<numRobots; i+=4) {   // wait for correct data (data from current robots and not previous ones) received from all the robots
-        waitForUpdate(robotAddress[i], 100000);
+    setMutexTx(ctx);
+    setMutexRx(ctx);
+    for(i=0; i<numRobots; i++) {    // the robots kept at the same index keep their commands and sensors
+        if(i>=(int)ctx->currNumRobots || ctx->tx[i].robotAddress!=robotAddr[i]) {
+            resetRobotData(ctx, i);
+            clearRobotRx(ctx, i);
+        }
+    }
+    setAddressTable(ctx, robotAddr, numRobots);
+    __atomic_store_n(&ctx->currNumRobots, (unsigned int)numRobots, __ATOMIC_RELEASE);   // after the table (see "swarmTable")
+    __atomic_store_n(&ctx->rosterEpoch, ctx->rosterEpoch+1, __ATOMIC_RELEASE);
+    if(ctx->sharedExport != NULL) {
+        exportSwarm(ctx);
     }
-    waitForUpdate(robotAddress[numRobots-1], 100000); // if numRobots is a multiple of 8 then this call is useless...don't care
-    currNumRobots = numRobots;
+    freeMutexRx(ctx);
+    freeMutexTx(ctx);
 }
 
-unsigned int getProximity(int robotAddr, int proxId) {
+unsigned int elisa3_getRosterEpoch(elisa3_ctx *ctx) {
+    return __atomic_load_n(&ctx->rosterEpoch, __ATOMIC_ACQUIRE);
+}
+
+unsigned int elisa3_getDataEpoch(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0, epoch = 0;
+    if(id < 0) {
+        return 0;
+    }
+    do {
+        seq = rxReadBegin(table, id);
+        epoch = table->rx[id].dataEpoch;
+    } while(rxReadRetry(table, id, seq));
+    return epoch;
+}
+
+unsigned int elisa3_getProximity(elisa3_ctx *ctx, int robotAddr, int proxId) {
     unsigned int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = proxValue[id][proxId];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].proxValue[proxId];
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned int getProximityAmbient(int robotAddr, int proxId) {
+unsigned int elisa3_getProximityAmbient(elisa3_ctx *ctx, int robotAddr, int proxId) {
     unsigned int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = proxAmbientValue[id][proxId];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].proxAmbientValue[proxId];
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned int getGround(int robotAddr, int groundId) {
+unsigned int elisa3_getGround(elisa3_ctx *ctx, int robotAddr, int groundId) {
     unsigned int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = groundValue[id][groundId];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].groundValue[groundId];
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned int getGroundAmbient(int robotAddr, int groundId) {
+unsigned int elisa3_getGroundAmbient(elisa3_ctx *ctx, int robotAddr, int groundId) {
     unsigned int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = groundAmbientValue[id][groundId];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].groundAmbientValue[groundId];
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-void getAllProximity(int robotAddr, unsigned int* proxArr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_getAllProximity(elisa3_ctx *ctx, int robotAddr, unsigned int* proxArr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     int i = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        for(i=0; i<8; i++) {
-            proxArr[i] = proxValue[id][i];
-        }
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            for(i=0; i<8; i++) {
+                proxArr[i] = table->rx[id].proxValue[i];
+            }
+        } while(rxReadRetry(table, id, seq));
     }
 }
 
-void getAllProximityAmbient(int robotAddr, unsigned int* proxArr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_getAllProximityAmbient(elisa3_ctx *ctx, int robotAddr, unsigned int* proxArr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     int i = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        for(i=0; i<8; i++) {
-            proxArr[i] = proxAmbientValue[id][i];
-        }
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            for(i=0; i<8; i++) {
+                proxArr[i] = table->rx[id].proxAmbientValue[i];
+            }
+        } while(rxReadRetry(table, id, seq));
     }
 }
 
-void getAllGround(int robotAddr, unsigned int* groundArr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_getAllGround(elisa3_ctx *ctx, int robotAddr, unsigned int* groundArr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     int i = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        for(i=0; i<4; i++) {
-            groundArr[i] = groundValue[id][i];
-        }
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            for(i=0; i<4; i++) {
+                groundArr[i] = table->rx[id].groundValue[i];
+            }
+        } while(rxReadRetry(table, id, seq));
     }
 }
 
-void getAllGroundAmbient(int robotAddr, unsigned int* groundArr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_getAllGroundAmbient(elisa3_ctx *ctx, int robotAddr, unsigned int* groundArr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     int i = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        for(i=0; i<4; i++) {
-            groundArr[i] = groundAmbientValue[id][i];
+        do {
+            seq = rxReadBegin(table, id);
+            for(i=0; i<4; i++) {
+                groundArr[i] = table->rx[id].groundAmbientValue[i];
+            }
+        } while(rxReadRetry(table, id, seq));
+    }
+}
+
+void elisa3_getAllProximityFromAll(elisa3_ctx *ctx, unsigned int proxArr[][8]) {
+    unsigned int i = 0, j = 0;
+    unsigned int seq = 0, numRobots = 0;
+    struct robotTable *table = NULL;
+    do {
+        seq = swarmReadBegin(ctx);
+        numRobots = swarmTable(ctx, &table);
+        for(i=0; i<numRobots; i++) {
+            for(j=0; j<8; j++) {
+                proxArr[i][j] = table->rx[i].proxValue[j];
+            }
         }
-        if(enableMut) {
-            freeMutexRx();
+    } while(swarmReadRetry(ctx, seq));
+}
+
+void elisa3_getAllProximityAmbientFromAll(elisa3_ctx *ctx, unsigned int proxArr[][8]) {
+    unsigned int i = 0, j = 0;
+    unsigned int seq = 0, numRobots = 0;
+    struct robotTable *table = NULL;
+    do {
+        seq = swarmReadBegin(ctx);
+        numRobots = swarmTable(ctx, &table);
+        for(i=0; i<numRobots; i++) {
+            for(j=0; j<8; j++) {
+                proxArr[i][j] = table->rx[i].proxAmbientValue[j];
+            }
         }
-    }
+    } while(swarmReadRetry(ctx, seq));
 }
 
-void getAllProximityFromAll(unsigned int proxArr[][8]) {
-    int i = 0, j = 0;
-    setMutexRx();
-    for(i=0; i<currNumRobots; i++) {
-        for(j=0; j<8; j++) {
-            proxArr[i][j] = proxValue[i][j];
+void elisa3_getAllGroundFromAll(elisa3_ctx *ctx, unsigned int groundArr[][4]) {
+    unsigned int i = 0, j = 0;
+    unsigned int seq = 0, numRobots = 0;
+    struct robotTable *table = NULL;
+    do {
+        seq = swarmReadBegin(ctx);
+        numRobots = swarmTable(ctx, &table);
+        for(i=0; i<numRobots; i++) {
+            for(j=0; j<4; j++) {
+                groundArr[i][j] = table->rx[i].groundValue[j];
+            }
         }
-    }
-    freeMutexRx();    
+    } while(swarmReadRetry(ctx, seq));
 }
 
-void getAllProximityAmbientFromAll(unsigned int proxArr[][8]) {
-    int i = 0, j = 0;
-    setMutexRx();
-    for(i=0; i<currNumRobots; i++) {
-        for(j=0; j<8; j++) {
-            proxArr[i][j] = proxAmbientValue[i][j];
+void elisa3_getAllGroundAmbientFromAll(elisa3_ctx *ctx, unsigned int groundArr[][4]) {
+    unsigned int i = 0, j = 0;
+    unsigned int seq = 0, numRobots = 0;
+    struct robotTable *table = NULL;
+    do {
+        seq = swarmReadBegin(ctx);
+        numRobots = swarmTable(ctx, &table);
+        for(i=0; i<numRobots; i++) {
+            for(j=0; j<4; j++) {
+                groundArr[i][j] = table->rx[i].groundAmbientValue[j];
+            }
         }
+    } while(swarmReadRetry(ctx, seq));
+}
+
+void elisa3_getSensors(elisa3_ctx *ctx, int robotAddr, robotSensors *sensors) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
+    if(id>=0) {
+        do {
+            seq = rxReadBegin(table, id);
+            copySensors(table, id, sensors);
+        } while(rxReadRetry(table, id, seq));
+    }
+}
+
+void elisa3_getSensorsFromAll(elisa3_ctx *ctx, robotSensors *sensors) {
+    unsigned int i = 0;
+    unsigned int seq = 0, numRobots = 0;
+    struct robotTable *table = NULL;
+    do {
+        seq = swarmReadBegin(ctx);
+        numRobots = swarmTable(ctx, &table);
+        for(i=0; i<numRobots; i++) {
+            copySensors(table, i, &sensors[i]);
+        }
+    } while(swarmReadRetry(ctx, seq));
+}
+
+unsigned long long elisa3_getUpdateTime(elisa3_ctx *ctx, int robotAddr, int packetType) {
+    unsigned long long tempVal=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
+    if(id>=0 && packetType>=0 && packetType<RX_PACKET_TYPES) {
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].rxUpdateTime[packetType];
+        } while(rxReadRetry(table, id, seq));
+        return tempVal;
     }
-    freeMutexRx();
+    return 0;
 }
 
-void getAllGroundFromAll(unsigned int groundArr[][4]) {
-    int i = 0, j = 0;
-    setMutexRx();
-    for(i=0; i<currNumRobots; i++) {
-        for(j=0; j<4; j++) {
-            groundArr[i][j] = groundValue[i][j];
-        }
+unsigned int elisa3_getUpdateCount(elisa3_ctx *ctx, int robotAddr, int packetType) {
+    unsigned int tempVal=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
+    if(id>=0 && packetType>=0 && packetType<RX_PACKET_TYPES) {
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].rxUpdateCount[packetType];
+        } while(rxReadRetry(table, id, seq));
+        return tempVal;
     }
-    freeMutexRx();
+    return 0;
 }
 
-void getAllGroundAmbientFromAll(unsigned int groundArr[][4]) {
-    int i = 0, j = 0;
-    setMutexRx();
-    for(i=0; i<currNumRobots; i++) {
-        for(j=0; j<4; j++) {
-            groundArr[i][j] = groundAmbientValue[i][j];
-        }
+unsigned long long elisa3_getUpdateAge(elisa3_ctx *ctx, int robotAddr, int packetType) {
+    unsigned long long updateTime = elisa3_getUpdateTime(ctx, robotAddr, packetType);
+    if(updateTime == 0) {
+        return (unsigned long long)-1;
     }
-    freeMutexRx();
+    return getTimeUs()-updateTime;
 }
 
-unsigned int getBatteryAdc(int robotAddr) {
+unsigned int elisa3_getBatteryAdc(elisa3_ctx *ctx, int robotAddr) {
     unsigned int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = batteryAdc[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].batteryAdc;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned int getBatteryPercent(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
+unsigned int elisa3_getBatteryPercent(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
     unsigned int tempVal=0;
-    unsigned char enableMut = checkConcurrency(id);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        if(batteryAdc[id] >= 934) {           // 934 is the measured adc value when the battery is charged
-            batteryPercent[id] = 100;
-        } else if(batteryAdc[id] <= 780) {    // 780 is the measrued adc value when the battery is discharged
-            batteryPercent[id] = 0;
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].batteryAdc;
+        } while(rxReadRetry(table, id, seq));
+        if(tempVal >= 934) {           // 934 is the measured adc value when the battery is charged
+            return 100;
+        } else if(tempVal <= 780) {    // 780 is the measrued adc value when the battery is discharged
+            return 0;
         } else {
-            batteryPercent[id] = (unsigned int)((float)(((float)batteryAdc[id]-780.0)/(934.0-780.0))*100.0);
+            return (unsigned int)((float)(((float)tempVal-780.0)/(934.0-780.0))*100.0);
         }
-        tempVal = batteryPercent[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
-        return tempVal;
     }
     return -1;
 }
 
-signed int getAccX(int robotAddr) {
+signed int elisa3_getAccX(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = accX[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].accX;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed int getAccY(int robotAddr) {
+signed int elisa3_getAccY(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = accY[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].accY;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed int getAccZ(int robotAddr) {
+signed int elisa3_getAccZ(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = accZ[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].accZ;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned char getSelector(int robotAddr) {
+unsigned char elisa3_getSelector(elisa3_ctx *ctx, int robotAddr) {
     unsigned char tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = selector[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].selector;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned char getTVRemoteCommand(int robotAddr) {
+unsigned char elisa3_getTVRemoteCommand(elisa3_ctx *ctx, int robotAddr) {
     unsigned char tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = tvRemote[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].tvRemote;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed int getOdomTheta(int robotAddr) {
+signed int elisa3_getOdomTheta(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = robTheta[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].robTheta;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed int getOdomXpos(int robotAddr) {
+signed int elisa3_getOdomXpos(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = robXPos[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].robXPos;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed int getOdomYpos(int robotAddr) {
+signed int elisa3_getOdomYpos(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = robYPos[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].robYPos;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-void setSmallLed(int robotAddr, int ledId, int state) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_setSmallLed(elisa3_ctx *ctx, int robotAddr, int ledId, int state) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
         if(state==0) {
-            smallLeds[id] &= ~(1<<ledId);
+            table->tx[id].smallLeds &= ~(1<<ledId);
         } else {
-            smallLeds[id] |= (1<<ledId);
-        }
-        if(enableMut) {
-            freeMutexTx();
+            table->tx[id].smallLeds |= (1<<ledId);
         }
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOffSmallLeds(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOffSmallLeds(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        smallLeds[id] = 0;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].smallLeds = 0;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void turnOnSmallLeds(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_turnOnSmallLeds(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        smallLeds[id] = 0xFF;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].smallLeds = 0xFF;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-int getVerticalAngle(int robotAddr) {
-    int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+int elisa3_getVerticalAngle(elisa3_ctx *ctx, int robotAddr) {
+    signed int x=0, y=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = computeVerticalAngle(accX[id], accY[id]);
-        if(enableMut) {
-            freeMutexRx();
-        }
-        return tempVal;
+        do {
+            seq = rxReadBegin(table, id);
+            x = table->rx[id].accX;
+            y = table->rx[id].accY;
+        } while(rxReadRetry(table, id, seq));
+        return computeVerticalAngle(x, y);
     }
     return -1;
 }
 
-void calibrateSensors(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_calibrateSensors(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        calibrationSent[id] = 0;
-        CALIBRATION_ON(flagsTX[id][0]);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].calibrationSent = 0;
+        CALIBRATION_ON(table->tx[id].flagsTX[0]);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-void calibrateSensorsForAll() {
-    int i = 0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        calibrationSent[i] = 0;
-        CALIBRATION_ON(flagsTX[i][0]);
+void elisa3_calibrateSensorsForAll(elisa3_ctx *ctx) {
+    unsigned int i = 0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].calibrationSent = 0;
+        CALIBRATION_ON(ctx->tx[i].flagsTX[0]);
     }
-    freeMutexTx();
+    freeMutexTx(ctx);
 }
 
-void startOdometryCalibration(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_startOdometryCalibration(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-		calibrateOdomSent[id] = 0;
-        flagsTX[id][1] |= (1<<0);
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+		table->tx[id].calibrateOdomSent = 0;
+        table->tx[id].flagsTX[1] |= (1<<0);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-unsigned char robotIsCharging(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+unsigned char elisa3_robotIsCharging(elisa3_ctx *ctx, int robotAddr) {
+    unsigned char tempVal=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        if((flagsRX[id]&0x01) == 0x01) {
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].flagsRX;
+        } while(rxReadRetry(table, id, seq));
+        if((tempVal&0x01) == 0x01) {
             return 1;
         } else {
             return 0;
         }
-        if(enableMut) {
-            freeMutexRx();
-        }
     }
     return 0;
 }
 
-unsigned char robotIsCharged(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+unsigned char elisa3_robotIsCharged(elisa3_ctx *ctx, int robotAddr) {
+    unsigned char tempVal=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        if((flagsRX[id]&0x04) == 0x04) {
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].flagsRX;
+        } while(rxReadRetry(table, id, seq));
+        if((tempVal&0x04) == 0x04) {
             return 1;
         } else {
             return 0;
         }
-        if(enableMut) {
-            freeMutexRx();
-        }
     }
     return 0;
 }
 
-unsigned char buttonIsPressed(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+unsigned char elisa3_buttonIsPressed(elisa3_ctx *ctx, int robotAddr) {
+    unsigned char tempVal=0;
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        if((flagsRX[id]&0x02) == 0x02) {
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].flagsRX;
+        } while(rxReadRetry(table, id, seq));
+        if((tempVal&0x02) == 0x02) {
             return 1;
         } else {
             return 0;
         }
-        if(enableMut) {
-            freeMutexRx();
-        }
     }
     return 0;
 }
 
-void resetFlagTX(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_resetFlagTX(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        flagsTX[id][0] = 0;
-        flagsTX[id][1] = 0;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].flagsTX[0] = 0;
+        table->tx[id].flagsTX[1] = 0;
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-unsigned char getFlagTX(int robotAddr, int flagInd) {
-    int id = getIdFromAddress(robotAddr);
+unsigned char elisa3_getFlagTX(elisa3_ctx *ctx, int robotAddr, int flagInd) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
     if(id>=0) {
-        return flagsTX[id][flagInd];
+        return table->tx[id].flagsTX[flagInd];
     }
     return -1;
 }
 
-unsigned char getFlagRX(int robotAddr) {
+unsigned char elisa3_getFlagRX(elisa3_ctx *ctx, int robotAddr) {
     unsigned char tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = flagsRX[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].flagsRX;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed long int getLeftMotSteps(int robotAddr) {
+signed long int elisa3_getLeftMotSteps(elisa3_ctx *ctx, int robotAddr) {
     signed long int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = leftMotSteps[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].leftMotSteps;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-signed long int getRightMotSteps(int robotAddr) {
+signed long int elisa3_getRightMotSteps(elisa3_ctx *ctx, int robotAddr) {
     signed long int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = rightMotSteps[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].rightMotSteps;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-void resetMessageIsSentFlag(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_resetMessageIsSentFlag(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        lastMessageSentFlag[id] = 0;
-        if(enableMut) {
-            freeMutexRx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        setMutexRx(ctx);    // the packets in flight could be decoded meanwhile
+        resetSentFlag(ctx, table, id);
+        freeMutexRx(ctx);
+        endTxUpdate(ctx, enableMut);
     }
 }
 
-unsigned char messageIsSent(int robotAddr) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+unsigned char elisa3_messageIsSent(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned char enableMut = checkConcurrency(ctx, id);
     if(id>=0) {
         if(enableMut) {
-            setMutexRx();
+            setMutexRx(ctx);
         }
-        if(lastMessageSentFlag[id]==3) {
+        if(table->rx[id].lastMessageSentFlag==3) {
             if(enableMut) {
-                freeMutexRx();
+                freeMutexRx(ctx);
             }
             return 1;
         } else {
             if(enableMut) {
-                freeMutexRx();
+                freeMutexRx(ctx);
             }
             return 0;
         }
@@ -1305,771 +2150,1669 @@ unsigned char messageIsSent(int robotAddr) {
     return -1;
 }
 
-double getRFQuality(int robotAddr) {
-    double tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    if(id>=0) {
-        setMutexThread();
-        tempVal = 100.0-errorPercentage[id];
-        freeMutexThread();
-        return tempVal;
+double elisa3_getRFQuality(elisa3_ctx *ctx, int robotAddr) {
+    unsigned int counts[RF_OUTCOMES];
+    unsigned int total = 0;
+    int k = 0;
+    if(elisa3_getRFStats(ctx, robotAddr, RF_WINDOW_10S, counts) < 0) {
+        return -1;
     }
-    return -1;
+    for(k=0; k<RF_OUTCOMES; k++) {
+        total += counts[k];
+    }
+    if(total == 0) {    // never heard (or not exchanged with) in the window
+        return 0;
+    }
+    return 100.0*counts[RF_DATA]/total;
 }
 
-void stopTransferData() {
-    stopTransmissionFlag = 1;
+void elisa3_stopTransferData(elisa3_ctx *ctx) {
+    ctx->stopTransmissionFlag = 1;
 }
 
-void resumeTransferData() {
-    stopTransmissionFlag = 0;
+void elisa3_resumeTransferData(elisa3_ctx *ctx) {
+    ctx->stopTransmissionFlag = 0;
 }
 
-void setCompletePacket(int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds) {
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+void elisa3_setCompletePacket(elisa3_ctx *ctx, int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    unsigned char enableMut = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexTx();
-        }
-        redLed[id] = red;
-        blueLed[id] = blue;
-        greenLed[id] = green;
-        flagsTX[id][0] = flags[0];
-        flagsTX[id][1] = flags[1];
-        leftSpeed[id] = left;
-        rightSpeed[id] = right;
-        smallLeds[id] = leds;
-        if(enableMut) {
-            freeMutexTx();
-        }
+        table = beginTxUpdate(ctx, id, &enableMut);
+        table->tx[id].redLed = red;
+        table->tx[id].blueLed = blue;
+        table->tx[id].greenLed = green;
+        table->tx[id].flagsTX[0] = flags[0];
+        table->tx[id].flagsTX[1] = flags[1];
+        table->tx[id].leftSpeed = left;
+        table->tx[id].rightSpeed = right;
+        table->tx[id].smallLeds = leds;
+        endTxUpdate(ctx, enableMut);
+    }
+}
+
+void elisa3_setCompletePacketForAll(elisa3_ctx *ctx, int *robotAddr, char *red, char *green, char *blue, char flags[][2], char *left, char *right, char *leds) {
+    unsigned int i=0;
+    setMutexTx(ctx);
+    for(i=0; i<ctx->currNumRobots; i++) {
+        ctx->tx[i].redLed = red[i];
+        ctx->tx[i].blueLed = blue[i];
+        ctx->tx[i].greenLed = green[i];
+        ctx->tx[i].flagsTX[0] = flags[i][0];
+        ctx->tx[i].flagsTX[1] = flags[i][1];
+        ctx->tx[i].leftSpeed = left[i];
+        ctx->tx[i].rightSpeed = right[i];
+        ctx->tx[i].smallLeds = leds[i];
+        setAddressEntry(ctx, i, robotAddr[i]);
+    }
+    freeMutexTx(ctx);
+}
+
+robotCommand *elisa3_getCommandFrame(elisa3_ctx *ctx, int numRobots) {
+    struct commandFrame *frame = ctx->userFrame;
+    if(numRobots<0 || numRobots>MAX_ROBOTS) {
+        return NULL;
+    }
+    if(frame == NULL || frame->capacity < numRobots) {
+        frame = realloc(frame, sizeof(struct commandFrame) + (numRobots>0 ? numRobots : 1)*sizeof(robotCommand));
+        if(frame == NULL) {
+            return NULL;    // the previous frame (if any) is kept
+        }
+        frame->capacity = (numRobots>0) ? numRobots : 1;
+        ctx->userFrame = frame;
+    }
+    frame->numRobots = numRobots;
+    return frame->commands;
+}
+
+int elisa3_publishCommandFrame(elisa3_ctx *ctx) {
+    struct commandFrame *frame = ctx->userFrame;
+    unsigned long previous = 0;
+    if(frame == NULL) {
+        return -1;
+    }
+    codecClampCommands(frame->commands, frame->numRobots);
+    // the frame published before (not applied yet) or the one given back by the communication threads
+    previous = __atomic_exchange_n(&ctx->publishedFrame, (unsigned long)frame | FRAME_PUBLISHED, __ATOMIC_ACQ_REL);
+    ctx->userFrame = (struct commandFrame*)(previous & ~(unsigned long)FRAME_PUBLISHED);
+    return 0;
+}
+
+int elisa3_setCommandsForAll(elisa3_ctx *ctx, const robotCommand *commands, int numRobots) {
+    robotCommand *frame = elisa3_getCommandFrame(ctx, numRobots);
+    if(frame == NULL) {
+        return -1;
     }
+    memcpy(frame, commands, numRobots*sizeof(robotCommand));
+    return elisa3_publishCommandFrame(ctx);
 }
 
-void setCompletePacketForAll(int *robotAddr, char *red, char *green, char *blue, char flags[][2], char *left, char *right, char *leds) {
-    int i=0;
-    setMutexTx();
-    for(i=0; i<currNumRobots; i++) {
-        redLed[i] = red[i];
-        blueLed[i] = blue[i];
-        greenLed[i] = green[i];
-        flagsTX[i][0] = flags[i][0];
-        flagsTX[i][1] = flags[i][1];
-        leftSpeed[i] = left[i];
-        rightSpeed[i] = right[i];
-        smallLeds[i] = leds[i];
-        robotAddress[i] = robotAddr[i];
+// Take the frame published, if any, and copy it in the TX records (with "mutexTx" locked): the packet being built and
+// the next ones carry the whole frame.
+void applyCommandFrame(elisa3_ctx *ctx) {
+    struct commandFrame *frame = NULL;
+    const robotCommand *command = NULL;
+    struct robotTx *robot = NULL;
+    unsigned long published = 0;
+    int i = 0, numRobots = 0;
+
+    if((__atomic_load_n(&ctx->publishedFrame, __ATOMIC_RELAXED) & FRAME_PUBLISHED) == 0) {
+        return;
+    }
+    published = __atomic_exchange_n(&ctx->publishedFrame, (unsigned long)ctx->appliedFrame, __ATOMIC_ACQ_REL);
+    frame = (struct commandFrame*)(published & ~(unsigned long)FRAME_PUBLISHED);
+    ctx->appliedFrame = frame;
+    numRobots = (frame->numRobots < (int)ctx->currNumRobots) ? frame->numRobots : (int)ctx->currNumRobots;
+    for(i=0; i<numRobots; i++) {
+        command = &frame->commands[i];
+        robot = &ctx->tx[i];
+        robot->leftSpeed = command->left;
+        robot->rightSpeed = command->right;
+        robot->redLed = command->red;
+        robot->greenLed = command->green;
+        robot->blueLed = command->blue;
+        robot->flagsTX[0] = command->flags[0];
+        robot->flagsTX[1] = command->flags[1];
+        robot->smallLeds = command->leds;
     }
-    freeMutexTx();
 }
 
-unsigned char sendMessageToRobot(int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds, unsigned long us) {
+unsigned char elisa3_sendMessageToRobot(elisa3_ctx *ctx, int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds, unsigned long us) {
     int robotAddrArr[1] = {robotAddr};
-    setRobotAddresses(robotAddrArr, 1);
-    setCompletePacket(robotAddr, red, green, blue, flags, left, right, leds);
-    return waitForUpdate(robotAddr, us);
+    elisa3_setRobotAddresses(ctx, robotAddrArr, 1);
+    elisa3_setCompletePacket(ctx, robotAddr, red, green, blue, flags, left, right, leds);
+    return elisa3_waitForUpdate(ctx, robotAddr, us);
 }
 
-signed int getGyroZ(int robotAddr) {
+signed int elisa3_getGyroZ(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = gyroZ[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].gyroZ;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-int getHeading(int robotAddr) {
+int elisa3_getHeading(elisa3_ctx *ctx, int robotAddr) {
     signed int tempVal=0;
-    int id = getIdFromAddress(robotAddr);
-    unsigned char enableMut = checkConcurrency(id);
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int seq = 0;
     if(id>=0) {
-        if(enableMut) {
-            setMutexRx();
-        }
-        tempVal = heading[id];
-        if(enableMut) {
-            freeMutexRx();
-        }
+        do {
+            seq = rxReadBegin(table, id);
+            tempVal = table->rx[id].heading;
+        } while(rxReadRetry(table, id, seq));
         return tempVal;
     }
     return -1;
 }
 
-unsigned char waitForUpdate(int robotAddr, unsigned long us) {
-#if defined(_WIN32) || defined(_WIN64)
-    SYSTEMTIME startTime;
-    FILETIME startTimeF;
-    ULONGLONG startTime64;
-    SYSTEMTIME exitTime;
-    FILETIME exitTimeF;
-    ULONGLONG exitTime64;
-    GetSystemTime(&startTime);
-    SystemTimeToFileTime(&startTime, &startTimeF);
-    startTime64 = (((ULONGLONG) startTimeF.dwHighDateTime) << 32) + startTimeF.dwLowDateTime;
-#endif
+void elisa3_setTransferPeriod(elisa3_ctx *ctx, unsigned long us) {
+    if(us == 0) {
+        return;
+    }
+    ctx->transferPeriodUs = us;
+}
 
-#if defined(__linux__) || defined(__APPLE__)
-	struct timeval startTime, exitTime;
-    gettimeofday(&startTime, NULL);
-	gettimeofday(&exitTime, NULL);
-#endif
+unsigned long elisa3_getTransferPeriod(elisa3_ctx *ctx) {
+    return ctx->transferPeriodUs;
+}
 
-    resetMessageIsSentFlag(robotAddr);
+void elisa3_getTransferJitter(elisa3_ctx *ctx, unsigned long *lastUs, unsigned long *meanUs, unsigned long *maxUs) {
+    setMutexThread(ctx);
+    *lastUs = ctx->jitterLastUs;
+    *meanUs = (ctx->jitterSamples > 0) ? (unsigned long)(ctx->jitterSumUs/ctx->jitterSamples) : 0;
+    *maxUs = ctx->jitterMaxUs;
+    freeMutexThread(ctx);
+}
 
-    while(messageIsSent(robotAddr)==0) {
-#if defined(_WIN32) || defined(_WIN64)
-        GetSystemTime(&exitTime);
-        SystemTimeToFileTime(&exitTime, &exitTimeF);
-        exitTime64 = (((ULONGLONG) exitTimeF.dwHighDateTime) << 32) + exitTimeF.dwLowDateTime;
-        if(((exitTime64-startTime64)/10 > us)) {
-            return 1;
-        }
-#endif
+void elisa3_resetTransferJitter(elisa3_ctx *ctx) {
+    setMutexThread(ctx);
+    ctx->jitterLastUs = 0;
+    ctx->jitterMaxUs = 0;
+    ctx->jitterSumUs = 0;
+    ctx->jitterSamples = 0;
+    freeMutexThread(ctx);
+}
 
-#if defined(__linux__) || defined(__APPLE__)
-        gettimeofday(&exitTime, NULL);
-        if((((exitTime.tv_sec * 1000000 + exitTime.tv_usec)-(startTime.tv_sec * 1000000 + startTime.tv_usec)) > us)) {
-            return 1;
-        }
-#endif
+void elisa3_setAsyncTransfer(elisa3_ctx *ctx, unsigned int depth) {
+    if(depth > USB_MAX_ASYNC_DEPTH) {
+        depth = USB_MAX_ASYNC_DEPTH;
     }
+    ctx->asyncDepthRequested = depth;
+}
 
-    return 0;
+unsigned int elisa3_getAsyncTransfer(elisa3_ctx *ctx) {
+    return usb_async_depth(ctx->links[0].device);
 }
 
-void transferData() {
+void elisa3_setAdaptiveTransfer(elisa3_ctx *ctx, int enabled) {
+    ctx->adaptiveTransfer = (enabled != 0);
+}
 
-    int err=0;
+unsigned long elisa3_getAdaptivePeriod(elisa3_ctx *ctx, int baseStation) {
+    if(baseStation<0 || baseStation>=ctx->numLinks) {
+        return 0;
+    }
+    return __atomic_load_n(&ctx->links[baseStation].periodUs, __ATOMIC_RELAXED);
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexTx, INFINITE);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexTx);
-#endif
+int elisa3_getNumBaseStations(elisa3_ctx *ctx) {
+    return ctx->numLinks;
+}
 
-    //printf("addresses: %d, %d, %d, %d\r\n", robotAddress[currPacketId*4+0], robotAddress[currPacketId*4+1], robotAddress[currPacketId*4+2], robotAddress[currPacketId*4+3]);
-
-    // first robot
-    if(sleepEnabledFlag[0] == 1) {
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+1] = 0x00;                          // R
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+2] = 0x00;				            // B
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+3] = 0x00;                          // G
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+0][0];                 // activate IR remote control
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+5] = 0x00;                          // speed right (in percentage)
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+6] = 0x00;                          // speed left (in percentage)
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+7] = 0x00;                          // small green leds
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+8] = 0x00;
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+14] = (robotAddress[currPacketId*4+0]>>8)&0xFF;     // address of the robot
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+15] = robotAddress[currPacketId*4+0]&0xFF;
-    } else {
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+1] = redLed[currPacketId*4+0];                     // R
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+2] = blueLed[currPacketId*4+0];    	            // B
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+3] = greenLed[currPacketId*4+0];                   // G
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+0][0];                    // flags
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+5] = speed(rightSpeed[currPacketId*4+0]);                     // speed right
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+6] = speed(leftSpeed[currPacketId*4+0]);                     // speed left
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+7] = smallLeds[currPacketId*4+0];                   // small green leds
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+8] = flagsTX[currPacketId*4+0][1];
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+14] = (robotAddress[currPacketId*4+0]>>8)&0xFF;     // address of the robot
-        TX_buffer[(0*ROBOT_PACKET_SIZE)+15] = robotAddress[currPacketId*4+0]&0xFF;
-    }
-
-    // second robot
-    if(sleepEnabledFlag[1] == 1) {
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+1] = 0x00;                          // R
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+2] = 0x00;				            // B
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+3] = 0x00;                          // G
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+1][0];                       // activate IR remote control
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+5] = 0x00;                          // speed right (in percentage)
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+6] = 0x00;                          // speed left (in percentage)
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+7] = 0x00;                          // small green leds
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+8] = 0x00;
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+14] = ((robotAddress[currPacketId*4+1])>>8)&0xFF; // address of the robot
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+15] = (robotAddress[currPacketId*4+1])&0xFF;
-    } else {
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+1] = redLed[currPacketId*4+1];                     // R
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+2] = blueLed[currPacketId*4+1];    	            // B
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+3] = greenLed[currPacketId*4+1];                   // G
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+1][0];                    // flags
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+5] = speed(rightSpeed[currPacketId*4+1]);                     // speed right
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+6] = speed(leftSpeed[currPacketId*4+1]);                     // speed left
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+7] = smallLeds[currPacketId*4+1];                   // small green leds
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+8] = flagsTX[currPacketId*4+1][1];
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+14] = (robotAddress[currPacketId*4+1]>>8)&0xFF;     // address of the robot
-        TX_buffer[(1*ROBOT_PACKET_SIZE)+15] = robotAddress[currPacketId*4+1]&0xFF;
-    }
-
-    // third robot
-    if(sleepEnabledFlag[2] == 1) {
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+1] = 0x00;                          // R
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+2] = 0x00;				            // B
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+3] = 0x00;                          // G
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+2][0];                       // activate IR remote control
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+5] = 0x00;                          // speed right (in percentage)
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+6] = 0x00;                          // speed left (in percentage)
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+7] = 0x00;                          // small green leds
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+8] = 0x00;
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+14] = ((robotAddress[currPacketId*4+2])>>8)&0xFF; // address of the robot
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+15] = (robotAddress[currPacketId*4+2])&0xFF;
-    } else {
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+1] = redLed[currPacketId*4+2];                     // R
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+2] = blueLed[currPacketId*4+2];    	            // B
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+3] = greenLed[currPacketId*4+2];                   // G
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+2][0];                    // flags
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+5] = speed(rightSpeed[currPacketId*4+2]);                     // speed right
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+6] = speed(leftSpeed[currPacketId*4+2]);                     // speed left
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+7] = smallLeds[currPacketId*4+2];                   // small green leds
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+8] = flagsTX[currPacketId*4+2][1];
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+14] = (robotAddress[currPacketId*4+2]>>8)&0xFF;     // address of the robot
-        TX_buffer[(2*ROBOT_PACKET_SIZE)+15] = robotAddress[currPacketId*4+2]&0xFF;
-    }
-
-    // fourth robot
-    if(sleepEnabledFlag[3] == 1) {
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+1] = 0x00;                          // R
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+2] = 0x00;				            // B
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+3] = 0x00;                          // G
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+3][0];                       // activate IR remote control
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+5] = 0x00;                          // speed right (in percentage)
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+6] = 0x00;                          // speed left (in percentage)
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+7] = 0x00;                          // small green leds
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+8] = 0x00;
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+14] = ((robotAddress[currPacketId*4+3])>>8)&0xFF; // address of the robot
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+15] = (robotAddress[currPacketId*4+3])&0xFF;
-    } else {
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+1] = redLed[currPacketId*4+3];                     // R
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+2] = blueLed[currPacketId*4+3];    	            // B
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+3] = greenLed[currPacketId*4+3];                   // G
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+4] = flagsTX[currPacketId*4+3][0];                    // flags
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+5] = speed(rightSpeed[currPacketId*4+3]);                     // speed right
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+6] = speed(leftSpeed[currPacketId*4+3]);                     // speed left
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+7] = smallLeds[currPacketId*4+3];                   // small green leds
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+8] = flagsTX[currPacketId*4+3][1];
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+9] = payloadId;
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+14] = (robotAddress[currPacketId*4+3]>>8)&0xFF;     // address of the robot
-        TX_buffer[(3*ROBOT_PACKET_SIZE)+15] = robotAddress[currPacketId*4+3]&0xFF;
+void elisa3_setSlotScheduler(elisa3_ctx *ctx, slotScheduler scheduler, void *userData) {
+    setMutexTx(ctx);
+    ctx->scheduler = scheduler;
+    ctx->schedulerData = userData;
+    freeMutexTx(ctx);
+}
+
+int elisa3_scheduleCommands(elisa3_ctx *ctx, int robotAddr, const timedCommand *commands, int numCommands) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    struct commandQueue *queue = NULL;
+    unsigned int head = 0, tail = 0;
+    unsigned char enableMut = 0;
+    int i = 0;
+    if(id<0) {
+        return -1;
+    }
+    queue = __atomic_load_n(&table->sched[id].commands, __ATOMIC_ACQUIRE);
+    if(queue == NULL) {
+        queue = alignedAlloc(sizeof(struct commandQueue));
+        if(queue == NULL) {
+            return 0;
+        }
+        memset(queue, 0, sizeof(struct commandQueue));
+        table = beginTxUpdate(ctx, id, &enableMut);    // the table could be growing
+        if(table->sched[id].commands == NULL) {
+            __atomic_store_n(&table->sched[id].commands, queue, __ATOMIC_RELEASE);
+        } else {
+            alignedFree(queue);
+            queue = table->sched[id].commands;
+        }
+        endTxUpdate(ctx, enableMut);
     }
+    head = queue->head;
+    tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    for(i=0; i<numCommands && head-tail<COMMAND_QUEUE_SIZE; i++) {
+        queue->commands[head & (COMMAND_QUEUE_SIZE-1)] = commands[i];
+        head++;
+    }
+    __atomic_store_n(&queue->head, head, __ATOMIC_RELEASE);
+    return i;
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexTx);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexTx);
-#endif
+void elisa3_clearScheduledCommands(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    struct commandQueue *queue = NULL;
+    if(id>=0) {
+        queue = __atomic_load_n(&table->sched[id].commands, __ATOMIC_ACQUIRE);
+        if(queue != NULL) {
+            __atomic_store_n(&queue->clearTo, queue->head, __ATOMIC_RELEASE);
+        }
+    }
+}
 
-    // transfer the data to the base-station
-    err = usb_send(TX_buffer, PACKETS_SIZE-UNUSED_BYTES);
-    if(err < 0) {
-        printf("send error!\n");
+int elisa3_getScheduledCommands(elisa3_ctx *ctx, int robotAddr) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    struct commandQueue *queue = NULL;
+    unsigned int tail = 0, clearTo = 0;
+    if(id<0) {
+        return -1;
+    }
+    queue = __atomic_load_n(&table->sched[id].commands, __ATOMIC_ACQUIRE);
+    if(queue == NULL) {
+        return 0;
     }
+    tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    clearTo = __atomic_load_n(&queue->clearTo, __ATOMIC_RELAXED);
+    if((int)(clearTo-tail) > 0) {
+        tail = clearTo;
+    }
+    return (int)(queue->head-tail);
+}
+
+int elisa3_getRFStats(elisa3_ctx *ctx, int robotAddr, int window, unsigned int *counts) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    struct robotStats *stats = NULL;
+    unsigned int now = (unsigned int)(getTimeUs()/1000000), seq = 0, t = 0;
+    int i = 0, k = 0;
+    if(id<0 || window<RF_WINDOW_1S || window>RF_WINDOW_60S) {
+        return -1;
+    }
+    do {
+        seq = rxReadBegin(table, id);
+        stats = table->stats;
+        for(k=0; k<RF_OUTCOMES; k++) {
+            counts[k] = 0;
+        }
+        if(window == RF_WINDOW_60S) {   // the last 6 complete tens of seconds
+            for(t=now/10-STATS_TENS; t<now/10; t++) {
+                i = t%STATS_TENS;
+                for(k=0; k<RF_OUTCOMES && stats[id].tenTag[i]==t; k++) {
+                    counts[k] += stats[id].ten[i][k];
+                }
+            }
+        } else {                        // the last 1 or 10 complete seconds
+            for(t=now-((window==RF_WINDOW_1S)?1:STATS_SECONDS); t<now; t++) {
+                i = t%STATS_SECONDS;
+                for(k=0; k<RF_OUTCOMES && stats[id].secondTag[i]==t; k++) {
+                    counts[k] += stats[id].second[i][k];
+                }
+            }
+        }
+    } while(rxReadRetry(table, id, seq));
+    return 0;
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexTx, INFINITE);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexTx);
-#endif
-	calibrationSent[currPacketId*4+0]++;
-	calibrationSent[currPacketId*4+1]++;
-	calibrationSent[currPacketId*4+2]++;
-	calibrationSent[currPacketId*4+3]++;
-
-	calibrateOdomSent[currPacketId*4+0]++;
-	calibrateOdomSent[currPacketId*4+1]++;
-	calibrateOdomSent[currPacketId*4+2]++;
-	calibrateOdomSent[currPacketId*4+3]++;
-
-	if(calibrationSent[currPacketId*4+0] > 2) {
-	    CALIBRATION_OFF(flagsTX[currPacketId*4+0][0]);
-	}
-	if(calibrationSent[currPacketId*4+1] > 2) {
-	    CALIBRATION_OFF(flagsTX[currPacketId*4+1][0]);
-	}
-	if(calibrationSent[currPacketId*4+2] > 2) {
-    	CALIBRATION_OFF(flagsTX[currPacketId*4+2][0]);
-	}
-	if(calibrationSent[currPacketId*4+3] > 2) {
-    	CALIBRATION_OFF(flagsTX[currPacketId*4+3][0]);
-	}
+int elisa3_getRobotLiveness(elisa3_ctx *ctx, int robotAddr, unsigned int *failures) {
+    struct robotTable *table = NULL;
+    int id = lookupRobot(ctx, robotAddr, &table);
+    unsigned int n = 0;
+    if(id < 0) {
+        return -1;
+    }
+    n = __atomic_load_n(&table->sched[id].failures, __ATOMIC_RELAXED);
+    if(failures != NULL) {
+        *failures = n;
+    }
+    return (n >= LIVENESS_FAILURES) ? ROBOT_UNREACHABLE : ROBOT_ALIVE;
+}
 
-	if(calibrateOdomSent[currPacketId*4+0] > 2) {
-	    flagsTX[currPacketId*4+0][1] &= ~(1<<0);
-	}
-	if(calibrateOdomSent[currPacketId*4+1] > 2) {
-    	flagsTX[currPacketId*4+1][1] &= ~(1<<0);
-	}
-	if(calibrateOdomSent[currPacketId*4+2] > 2) {
-	    flagsTX[currPacketId*4+2][1] &= ~(1<<0);
-	}
-	if(calibrateOdomSent[currPacketId*4+3] > 2) {
-	    flagsTX[currPacketId*4+3][1] &= ~(1<<0);
-	}
+void elisa3_getLatencyStats(elisa3_ctx *ctx, int baseStation, latencyHistogram *usb, latencyHistogram *ack) {
+    struct commLink *link = NULL;
+    unsigned long long maxUs = 0;
+    unsigned int n = 0;
+    int i = 0, k = 0;
+    if(usb != NULL) {
+        memset(usb, 0, sizeof(latencyHistogram));
+    }
+    if(ack != NULL) {
+        memset(ack, 0, sizeof(latencyHistogram));
+    }
+    for(i=0; i<ctx->numLinks; i++) {
+        link = &ctx->links[i];
+        if(baseStation>=0 && baseStation!=i) {
+            continue;
+        }
+        for(k=0; k<LATENCY_BUCKETS; k++) {
+            if(usb != NULL) {
+                n = __atomic_load_n(&link->usbLatency[k], __ATOMIC_RELAXED);
+                usb->count[k] += n;
+                usb->samples += n;
+            }
+            if(ack != NULL) {
+                n = __atomic_load_n(&link->ackLatency[k], __ATOMIC_RELAXED);
+                ack->count[k] += n;
+                ack->samples += n;
+            }
+        }
+        if(usb != NULL && (maxUs=__atomic_load_n(&link->usbLatencyMax, __ATOMIC_RELAXED)) > usb->maxUs) {
+            usb->maxUs = maxUs;
+        }
+        if(ack != NULL && (maxUs=__atomic_load_n(&link->ackLatencyMax, __ATOMIC_RELAXED)) > ack->maxUs) {
+            ack->maxUs = maxUs;
+        }
+    }
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexTx);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexTx);
-#endif
+int elisa3_startRecorder(elisa3_ctx *ctx, const char *path, unsigned int numRecords) {
+    struct flightRecorder *rec = NULL, *old = NULL;
+    if(numRecords == 0) {
+        return -1;
+    }
+    rec = recorderOpen(path, numRecords);
+    if(rec == NULL) {
+        return -1;
+    }
+    setMutexRx(ctx);
+    old = ctx->recorder;
+    ctx->recorder = rec;
+    freeMutexRx(ctx);
+    recorderClose(old);
+    return 0;
+}
 
+void elisa3_stopRecorder(elisa3_ctx *ctx) {
+    struct flightRecorder *old = NULL;
+    setMutexRx(ctx);
+    old = ctx->recorder;
+    ctx->recorder = NULL;
+    freeMutexRx(ctx);
+    recorderClose(old);
+}
 
-    RX_buffer[0] = 0;
-    RX_buffer[16] = 0;
-    RX_buffer[32] = 0;
-    RX_buffer[48] = 0;
-    err = usb_receive(RX_buffer, 64);     // receive the ack payload for 4 robots at a time (16 bytes for each one)
-    if(err < 0) {
-        printf("receive error!\n");
+int elisa3_startSharedExport(elisa3_ctx *ctx, const char *name, unsigned int maxRobots) {
+    struct sharedExport *exp = NULL;
+    elisa3_stopSharedExport(ctx);   // the new segment can have the same name
+    exp = exportOpen(name, maxRobots);
+    if(exp == NULL) {
+        return -1;
     }
+    setMutexRx(ctx);
+    ctx->sharedExport = exp;
+    exportSwarm(ctx);
+    freeMutexRx(ctx);
+    return 0;
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    WaitForSingleObject(mutexRx, INFINITE);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_lock(&mutexRx);
-#endif
+void elisa3_stopSharedExport(elisa3_ctx *ctx) {
+    struct sharedExport *old = NULL;
+    setMutexRx(ctx);
+    old = ctx->sharedExport;
+    ctx->sharedExport = NULL;
+    freeMutexRx(ctx);
+    exportClose(old);
+}
 
-    // when the flag "lastMessageSentFlag" is reset we aren't sure the current message is really sent to the radio module
-    // for next transmission to the robots so we wait the message is sent twice
-    if(lastMessageSentFlag[currPacketId*4+0]==0) {
-        lastMessageSentFlag[currPacketId*4+0]=1;
-    } else if(lastMessageSentFlag[currPacketId*4+0]==1) {
-        lastMessageSentFlag[currPacketId*4+0]=2;
-    }
-    if(lastMessageSentFlag[currPacketId*4+1]==0) {
-        lastMessageSentFlag[currPacketId*4+1]=1;
-    } else if(lastMessageSentFlag[currPacketId*4+1]==1) {
-        lastMessageSentFlag[currPacketId*4+1]=2;
-    }
-    if(lastMessageSentFlag[currPacketId*4+2]==0) {
-        lastMessageSentFlag[currPacketId*4+2]=1;
-    } else if(lastMessageSentFlag[currPacketId*4+2]==1) {
-        lastMessageSentFlag[currPacketId*4+2]=2;
-    }
-    if(lastMessageSentFlag[currPacketId*4+3]==0) {
-        lastMessageSentFlag[currPacketId*4+3]=1;
-    } else if(lastMessageSentFlag[currPacketId*4+3]==1) {
-        lastMessageSentFlag[currPacketId*4+3]=2;
-    }
-
-    // the base-station returns these "error" codes:
-    // - 0 => transmission succeed (no ack received though)
-    // - 1 => ack received (should not be returned because if the ack is received, then the payload is read)
-    // - 2 => transfer failed
-    if((int)((unsigned char)RX_buffer[0])<=2) { // if something goes wrong skip the data
-        //printf("transfer failed to robot %d (addr=%d)\n", currPacketId*4+0, robotAddress[currPacketId*4+0]);
-        numOfErrors[currPacketId*4+0]++;
-    } else {
-        if(lastMessageSentFlag[currPacketId*4+0]==2) {
-            lastMessageSentFlag[currPacketId*4+0]=3;
-        }
-        // extract the sensors data for the first robot based on the packet id (first byte):
-        // id=3 | prox0         | prox1         | prox2         | prox3         | prox5         | prox6         | prox7         | flags
-        // id=4 | prox4         | gound0        | ground1       | ground2       | ground3       | accX          | accY          | tv remote
-        // id=5 | proxAmbient0  | proxAmbient1  | proxAmbient2  | proxAmbient3  | proxAmbient5  | proxAmbient6  | proxAmbient7  | selector
-        // id=6 | proxAmbient4  | goundAmbient0 | goundAmbient1 | goundAmbient2 | goundAmbient3 | accZ          | battery       | free byte
-        switch((int)((unsigned char)RX_buffer[0])) {
-            case 3:
-                proxValue[currPacketId*4+0][0] = (((signed int)RX_buffer[2]<<8)|(unsigned char)RX_buffer[1]);
-                proxValue[currPacketId*4+0][1] = ((signed int)RX_buffer[4]<<8)|(unsigned char)RX_buffer[3];
-                proxValue[currPacketId*4+0][2] = ((signed int)RX_buffer[6]<<8)|(unsigned char)RX_buffer[5];
-                proxValue[currPacketId*4+0][3] = ((signed int)RX_buffer[8]<<8)|(unsigned char)RX_buffer[7];
-                proxValue[currPacketId*4+0][5] = ((signed int)RX_buffer[10]<<8)|(unsigned char)RX_buffer[9];
-                proxValue[currPacketId*4+0][6] = ((signed int)RX_buffer[12]<<8)|(unsigned char)RX_buffer[11];
-                proxValue[currPacketId*4+0][7] = ((signed int)RX_buffer[14]<<8)|(unsigned char)RX_buffer[13];
-                flagsRX[currPacketId*4+0] = (unsigned char)RX_buffer[15];
-                //printf("prox[%d][0] = %d (%d, %d)\r\n", currPacketId*4+0, proxValue[currPacketId*4+0][0], RX_buffer[2], RX_buffer[1]);
-                break;
-
-            case 4:
-                proxValue[currPacketId*4+0][4] = ((signed int)RX_buffer[2]<<8)|(unsigned char)RX_buffer[1];
-                groundValue[currPacketId*4+0][0] = ((signed int)RX_buffer[4]<<8)|(unsigned char)RX_buffer[3];
-                groundValue[currPacketId*4+0][1] = ((signed int)RX_buffer[6]<<8)|(unsigned char)RX_buffer[5];
-                groundValue[currPacketId*4+0][2] = ((signed int)RX_buffer[8]<<8)|(unsigned char)RX_buffer[7];
-                groundValue[currPacketId*4+0][3] = ((signed int)RX_buffer[10]<<8)|(unsigned char)RX_buffer[9];
-                accX[currPacketId*4+0] = ((signed int)RX_buffer[12]<<8)|(unsigned char)RX_buffer[11];
-                accY[currPacketId*4+0] = ((signed int)RX_buffer[14]<<8)|(unsigned char)RX_buffer[13];
-                tvRemote[currPacketId*4+0] = (unsigned char)RX_buffer[15];
-                break;
-
-            case 5:
-                proxAmbientValue[currPacketId*4+0][0] = ((signed int)RX_buffer[2]<<8)|(unsigned char)RX_buffer[1];
-                proxAmbientValue[currPacketId*4+0][1] = ((signed int)RX_buffer[4]<<8)|(unsigned char)RX_buffer[3];
-                proxAmbientValue[currPacketId*4+0][2] = ((signed int)RX_buffer[6]<<8)|(unsigned char)RX_buffer[5];
-                proxAmbientValue[currPacketId*4+0][3] = ((signed int)RX_buffer[8]<<8)|(unsigned char)RX_buffer[7];
-                proxAmbientValue[currPacketId*4+0][5] = ((signed int)RX_buffer[10]<<8)|(unsigned char)RX_buffer[9];
-                proxAmbientValue[currPacketId*4+0][6] = ((signed int)RX_buffer[12]<<8)|(unsigned char)RX_buffer[11];
-                proxAmbientValue[currPacketId*4+0][7] = ((signed int)RX_buffer[14]<<8)|(unsigned char)RX_buffer[13];
-                selector[currPacketId*4+0] = (unsigned char)RX_buffer[15];
-                break;
-
-            case 6:
-                proxAmbientValue[currPacketId*4+0][4] = ((signed int)RX_buffer[2]<<8)|(unsigned char)RX_buffer[1];
-                groundAmbientValue[currPacketId*4+0][0] = ((signed int)RX_buffer[4]<<8)|(unsigned char)RX_buffer[3];
-                groundAmbientValue[currPacketId*4+0][1] = ((signed int)RX_buffer[6]<<8)|(unsigned char)RX_buffer[5];
-                groundAmbientValue[currPacketId*4+0][2] = ((signed int)RX_buffer[8]<<8)|(unsigned char)RX_buffer[7];
-                groundAmbientValue[currPacketId*4+0][3] = ((signed int)RX_buffer[10]<<8)|(unsigned char)RX_buffer[9];
-                accZ[currPacketId*4+0] = ((signed int)RX_buffer[12]<<8)|(unsigned char)RX_buffer[11];
-                batteryAdc[currPacketId*4+0] = ((signed int)RX_buffer[14]<<8)|(unsigned char)RX_buffer[13];
-                heading[currPacketId*4+0] = ((unsigned char)RX_buffer[15])<<1;
-                break;
-
-            case 7:
-                leftMotSteps[currPacketId*4+0] = ((signed long)((unsigned char)RX_buffer[4]<<24)| ((unsigned char)RX_buffer[3]<<16)| ((unsigned char)RX_buffer[2]<<8)|((unsigned char)RX_buffer[1]));
-                rightMotSteps[currPacketId*4+0] = ((signed long)((unsigned char)RX_buffer[8]<<24)| ((unsigned char)RX_buffer[7]<<16)| ((unsigned char)RX_buffer[6]<<8)|((unsigned char)RX_buffer[5]));
-                robTheta[currPacketId*4+0] = ((((signed int)RX_buffer[10]<<8)|(unsigned char)RX_buffer[9])/10);//%360;
-                robXPos[currPacketId*4+0] = ((signed int)RX_buffer[12]<<8)|(unsigned char)RX_buffer[11];
-                robYPos[currPacketId*4+0] = ((signed int)RX_buffer[14]<<8)|(unsigned char)RX_buffer[13];
-                gyroZ[currPacketId*4+0] = RX_buffer[15]<<6;
-                break;
-        }
-    }
-
-    if((int)((unsigned char)RX_buffer[16])<=2) { // if something goes wrong skip the data
-        //printf("transfer failed to robot %d (addr=%d)\n", currPacketId*4+1, robotAddress[currPacketId*4+1]);
-        numOfErrors[currPacketId*4+1]++;
-    } else {
-        if(lastMessageSentFlag[currPacketId*4+1]==2) {
-            lastMessageSentFlag[currPacketId*4+1]=3;
-        }
-        switch((int)((unsigned char)RX_buffer[16])) {
-            case 3:
-                proxValue[currPacketId*4+1][0] = (((signed int)RX_buffer[18]<<8)|(unsigned char)RX_buffer[17]);
-                proxValue[currPacketId*4+1][1] = ((signed int)RX_buffer[20]<<8)|(unsigned char)RX_buffer[19];
-                proxValue[currPacketId*4+1][2] = ((signed int)RX_buffer[22]<<8)|(unsigned char)RX_buffer[21];
-                proxValue[currPacketId*4+1][3] = ((signed int)RX_buffer[24]<<8)|(unsigned char)RX_buffer[23];
-                proxValue[currPacketId*4+1][5] = ((signed int)RX_buffer[26]<<8)|(unsigned char)RX_buffer[25];
-                proxValue[currPacketId*4+1][6] = ((signed int)RX_buffer[28]<<8)|(unsigned char)RX_buffer[27];
-                proxValue[currPacketId*4+1][7] = ((signed int)RX_buffer[30]<<8)|(unsigned char)RX_buffer[29];
-                flagsRX[currPacketId*4+1] = (unsigned char)RX_buffer[31];
-                break;
-
-            case 4:
-                proxValue[currPacketId*4+1][4] = ((signed int)RX_buffer[18]<<8)|(unsigned char)RX_buffer[17];
-                groundValue[currPacketId*4+1][0] = ((signed int)RX_buffer[20]<<8)|(unsigned char)RX_buffer[19];
-                groundValue[currPacketId*4+1][1] = ((signed int)RX_buffer[22]<<8)|(unsigned char)RX_buffer[21];
-                groundValue[currPacketId*4+1][2] = ((signed int)RX_buffer[24]<<8)|(unsigned char)RX_buffer[23];
-                groundValue[currPacketId*4+1][3] = ((signed int)RX_buffer[26]<<8)|(unsigned char)RX_buffer[25];
-                accX[currPacketId*4+1] = ((signed int)RX_buffer[28]<<8)|(unsigned char)RX_buffer[27];
-                accY[currPacketId*4+1] = ((signed int)RX_buffer[30]<<8)|(unsigned char)RX_buffer[29];
-                tvRemote[currPacketId*4+1] = (unsigned char)RX_buffer[31];
-                break;
-
-            case 5:
-                proxAmbientValue[currPacketId*4+1][0] = ((signed int)RX_buffer[18]<<8)|(unsigned char)RX_buffer[17];
-                proxAmbientValue[currPacketId*4+1][1] = ((signed int)RX_buffer[20]<<8)|(unsigned char)RX_buffer[19];
-                proxAmbientValue[currPacketId*4+1][2] = ((signed int)RX_buffer[22]<<8)|(unsigned char)RX_buffer[21];
-                proxAmbientValue[currPacketId*4+1][3] = ((signed int)RX_buffer[24]<<8)|(unsigned char)RX_buffer[23];
-                proxAmbientValue[currPacketId*4+1][5] = ((signed int)RX_buffer[26]<<8)|(unsigned char)RX_buffer[25];
-                proxAmbientValue[currPacketId*4+1][6] = ((signed int)RX_buffer[28]<<8)|(unsigned char)RX_buffer[27];
-                proxAmbientValue[currPacketId*4+1][7] = ((signed int)RX_buffer[30]<<8)|(unsigned char)RX_buffer[29];
-                selector[currPacketId*4+1] = (unsigned char)RX_buffer[31];
-                break;
-
-            case 6:
-                proxAmbientValue[currPacketId*4+1][4] = ((signed int)RX_buffer[18]<<8)|(unsigned char)RX_buffer[17];
-                groundAmbientValue[currPacketId*4+1][0] = ((signed int)RX_buffer[20]<<8)|(unsigned char)RX_buffer[19];
-                groundAmbientValue[currPacketId*4+1][1] = ((signed int)RX_buffer[22]<<8)|(unsigned char)RX_buffer[21];
-                groundAmbientValue[currPacketId*4+1][2] = ((signed int)RX_buffer[24]<<8)|(unsigned char)RX_buffer[23];
-                groundAmbientValue[currPacketId*4+1][3] = ((signed int)RX_buffer[26]<<8)|(unsigned char)RX_buffer[25];
-                accZ[currPacketId*4+1] = ((signed int)RX_buffer[28]<<8)|(unsigned char)RX_buffer[27];
-                batteryAdc[currPacketId*4+1] = ((signed int)RX_buffer[30]<<8)|(unsigned char)RX_buffer[29];
-                heading[currPacketId*4+1] = ((unsigned char)RX_buffer[31])<<1;
-                break;
-
-            case 7:
-                leftMotSteps[currPacketId*4+1] = ((signed long)((unsigned char)RX_buffer[20]<<24)| ((unsigned char)RX_buffer[19]<<16)| ((unsigned char)RX_buffer[18]<<8)|((unsigned char)RX_buffer[17]));
-                rightMotSteps[currPacketId*4+1] = ((signed long)((unsigned char)RX_buffer[24]<<24)| ((unsigned char)RX_buffer[23]<<16)| ((unsigned char)RX_buffer[22]<<8)|((unsigned char)RX_buffer[21]));
-                robTheta[currPacketId*4+1] = ((((signed int)RX_buffer[26]<<8)|(unsigned char)RX_buffer[25])/10);//%360;
-                robXPos[currPacketId*4+1] = ((signed int)RX_buffer[28]<<8)|(unsigned char)RX_buffer[27];
-                robYPos[currPacketId*4+1] = ((signed int)RX_buffer[30]<<8)|(unsigned char)RX_buffer[29];
-                gyroZ[currPacketId*4+1] = RX_buffer[31]<<6;
-                break;
-        }
-    }
-
-    if((int)((unsigned char)RX_buffer[32])<=2) { // if something goes wrong skip the data
-        //printf("transfer failed to robot %d (addr=%d)\n", currPacketId*4+2, robotAddress[currPacketId*4+2]);
-        numOfErrors[currPacketId*4+2]++;
-    } else {
-        if(lastMessageSentFlag[currPacketId*4+2]==2) {
-            lastMessageSentFlag[currPacketId*4+2]=3;
-        }
-        switch((int)((unsigned char)RX_buffer[32])) {
-            case 3:
-                proxValue[currPacketId*4+2][0] = (((signed int)RX_buffer[34]<<8)|(unsigned char)RX_buffer[33]);
-                proxValue[currPacketId*4+2][1] = ((signed int)RX_buffer[36]<<8)|(unsigned char)RX_buffer[35];
-                proxValue[currPacketId*4+2][2] = ((signed int)RX_buffer[38]<<8)|(unsigned char)RX_buffer[37];
-                proxValue[currPacketId*4+2][3] = ((signed int)RX_buffer[40]<<8)|(unsigned char)RX_buffer[39];
-                proxValue[currPacketId*4+2][5] = ((signed int)RX_buffer[42]<<8)|(unsigned char)RX_buffer[41];
-                proxValue[currPacketId*4+2][6] = ((signed int)RX_buffer[44]<<8)|(unsigned char)RX_buffer[43];
-                proxValue[currPacketId*4+2][7] = ((signed int)RX_buffer[46]<<8)|(unsigned char)RX_buffer[45];
-                flagsRX[currPacketId*4+2] = (unsigned char)RX_buffer[47];
-                break;
-
-            case 4:
-                proxValue[currPacketId*4+2][4] = ((signed int)RX_buffer[34]<<8)|(unsigned char)RX_buffer[33];
-                groundValue[currPacketId*4+2][0] = ((signed int)RX_buffer[36]<<8)|(unsigned char)RX_buffer[35];
-                groundValue[currPacketId*4+2][1] = ((signed int)RX_buffer[38]<<8)|(unsigned char)RX_buffer[37];
-                groundValue[currPacketId*4+2][2] = ((signed int)RX_buffer[40]<<8)|(unsigned char)RX_buffer[39];
-                groundValue[currPacketId*4+2][3] = ((signed int)RX_buffer[42]<<8)|(unsigned char)RX_buffer[41];
-                accX[currPacketId*4+2] = ((signed int)RX_buffer[33]<<8)|(unsigned char)RX_buffer[43];
-                accY[currPacketId*4+2] = ((signed int)RX_buffer[46]<<8)|(unsigned char)RX_buffer[45];
-                tvRemote[currPacketId*4+2] = (unsigned char)RX_buffer[47];
-                break;
-
-            case 5:
-                proxAmbientValue[currPacketId*4+2][0] = ((signed int)RX_buffer[34]<<8)|(unsigned char)RX_buffer[33];
-                proxAmbientValue[currPacketId*4+2][1] = ((signed int)RX_buffer[36]<<8)|(unsigned char)RX_buffer[35];
-                proxAmbientValue[currPacketId*4+2][2] = ((signed int)RX_buffer[38]<<8)|(unsigned char)RX_buffer[37];
-                proxAmbientValue[currPacketId*4+2][3] = ((signed int)RX_buffer[40]<<8)|(unsigned char)RX_buffer[39];
-                proxAmbientValue[currPacketId*4+2][5] = ((signed int)RX_buffer[42]<<8)|(unsigned char)RX_buffer[41];
-                proxAmbientValue[currPacketId*4+2][6] = ((signed int)RX_buffer[44]<<8)|(unsigned char)RX_buffer[43];
-                proxAmbientValue[currPacketId*4+2][7] = ((signed int)RX_buffer[46]<<8)|(unsigned char)RX_buffer[45];
-                selector[currPacketId*4+2] = (unsigned char)RX_buffer[47];
-                break;
-
-            case 6:
-                proxAmbientValue[currPacketId*4+2][4] = ((signed int)RX_buffer[34]<<8)|(unsigned char)RX_buffer[33];
-                groundAmbientValue[currPacketId*4+2][0] = ((signed int)RX_buffer[36]<<8)|(unsigned char)RX_buffer[35];
-                groundAmbientValue[currPacketId*4+2][1] = ((signed int)RX_buffer[38]<<8)|(unsigned char)RX_buffer[37];
-                groundAmbientValue[currPacketId*4+2][2] = ((signed int)RX_buffer[40]<<8)|(unsigned char)RX_buffer[39];
-                groundAmbientValue[currPacketId*4+2][3] = ((signed int)RX_buffer[42]<<8)|(unsigned char)RX_buffer[41];
-                accZ[currPacketId*4+2] = ((signed int)RX_buffer[44]<<8)|(unsigned char)RX_buffer[43];
-                batteryAdc[currPacketId*4+2] = ((signed int)RX_buffer[46]<<8)|(unsigned char)RX_buffer[45];
-                heading[currPacketId*4+2] = ((unsigned char)RX_buffer[47])<<1;
-                break;
-
-            case 7:
-                leftMotSteps[currPacketId*4+2] = ((signed long)((unsigned char)RX_buffer[36]<<24)| ((unsigned char)RX_buffer[35]<<16)| ((unsigned char)RX_buffer[34]<<8)|((unsigned char)RX_buffer[33]));
-                rightMotSteps[currPacketId*4+2] = ((signed long)((unsigned char)RX_buffer[40]<<24)| ((unsigned char)RX_buffer[39]<<16)| ((unsigned char)RX_buffer[38]<<8)|((unsigned char)RX_buffer[37]));
-                robTheta[currPacketId*4+2] = ((((signed int)RX_buffer[42]<<8)|(unsigned char)RX_buffer[41])/10);//%360;
-                robXPos[currPacketId*4+2] = ((signed int)RX_buffer[44]<<8)|(unsigned char)RX_buffer[43];
-                robYPos[currPacketId*4+2] = ((signed int)RX_buffer[46]<<8)|(unsigned char)RX_buffer[45];
-                gyroZ[currPacketId*4+2] = RX_buffer[47]<<6;
-                break;
-        }
-    }
-
-    if((int)((unsigned char)RX_buffer[48])<=2) { // if something goes wrong skip the data
-        //printf("transfer failed to robot %d (addr=%d)\n", currPacketId*4+3, robotAddress[currPacketId*4+3]);
-        numOfErrors[currPacketId*4+3]++;
+int addSubscription(elisa3_ctx *ctx, int robotAddr, unsigned int packetTypes, sensorsCallback callback, void *userData, sensorsRing *ring) {
+    int i = 0;
+    setMutexSubs(ctx);
+    for(i=0; i<MAX_SUBSCRIPTIONS && ctx->subs[i].active; i++);
+    if(i < MAX_SUBSCRIPTIONS) {
+        ctx->subs[i].robotAddr = robotAddr;
+        ctx->subs[i].packetTypes = packetTypes;
+        ctx->subs[i].callback = callback;
+        ctx->subs[i].userData = userData;
+        ctx->subs[i].ring = ring;
+        ctx->subs[i].active = 1;
+        if(i >= ctx->subsEnd) {
+            ctx->subsEnd = i+1;
+        }
+        __atomic_store_n(&ctx->numSubscriptions, ctx->numSubscriptions+1, __ATOMIC_RELAXED);
     } else {
-        if(lastMessageSentFlag[currPacketId*4+3]==2) {
-            lastMessageSentFlag[currPacketId*4+3]=3;
-        }
-        switch((int)((unsigned char)RX_buffer[48])) {
-            case 3:
-                proxValue[currPacketId*4+3][0] = (((signed int)RX_buffer[50]<<8)|(unsigned char)RX_buffer[49]);
-                proxValue[currPacketId*4+3][1] = ((signed int)RX_buffer[52]<<8)|(unsigned char)RX_buffer[51];
-                proxValue[currPacketId*4+3][2] = ((signed int)RX_buffer[54]<<8)|(unsigned char)RX_buffer[53];
-                proxValue[currPacketId*4+3][3] = ((signed int)RX_buffer[56]<<8)|(unsigned char)RX_buffer[55];
-                proxValue[currPacketId*4+3][5] = ((signed int)RX_buffer[58]<<8)|(unsigned char)RX_buffer[57];
-                proxValue[currPacketId*4+3][6] = ((signed int)RX_buffer[60]<<8)|(unsigned char)RX_buffer[59];
-                proxValue[currPacketId*4+3][7] = ((signed int)RX_buffer[62]<<8)|(unsigned char)RX_buffer[61];
-                flagsRX[currPacketId*4+3] = (unsigned char)RX_buffer[63];
-                break;
-
-            case 4:
-                proxValue[currPacketId*4+3][4] = ((signed int)RX_buffer[50]<<8)|(unsigned char)RX_buffer[49];
-                groundValue[currPacketId*4+3][0] = ((signed int)RX_buffer[52]<<8)|(unsigned char)RX_buffer[51];
-                groundValue[currPacketId*4+3][1] = ((signed int)RX_buffer[54]<<8)|(unsigned char)RX_buffer[53];
-                groundValue[currPacketId*4+3][2] = ((signed int)RX_buffer[56]<<8)|(unsigned char)RX_buffer[55];
-                groundValue[currPacketId*4+3][3] = ((signed int)RX_buffer[58]<<8)|(unsigned char)RX_buffer[57];
-                accX[currPacketId*4+3] = ((signed int)RX_buffer[60]<<8)|(unsigned char)RX_buffer[59];
-                accY[currPacketId*4+3] = ((signed int)RX_buffer[62]<<8)|(unsigned char)RX_buffer[61];
-                tvRemote[currPacketId*4+3] = (unsigned char)RX_buffer[63];
-                break;
-
-            case 5:
-                proxAmbientValue[currPacketId*4+3][0] = ((signed int)RX_buffer[50]<<8)|(unsigned char)RX_buffer[49];
-                proxAmbientValue[currPacketId*4+3][1] = ((signed int)RX_buffer[52]<<8)|(unsigned char)RX_buffer[51];
-                proxAmbientValue[currPacketId*4+3][2] = ((signed int)RX_buffer[54]<<8)|(unsigned char)RX_buffer[53];
-                proxAmbientValue[currPacketId*4+3][3] = ((signed int)RX_buffer[56]<<8)|(unsigned char)RX_buffer[55];
-                proxAmbientValue[currPacketId*4+3][5] = ((signed int)RX_buffer[58]<<8)|(unsigned char)RX_buffer[57];
-                proxAmbientValue[currPacketId*4+3][6] = ((signed int)RX_buffer[60]<<8)|(unsigned char)RX_buffer[59];
-                proxAmbientValue[currPacketId*4+3][7] = ((signed int)RX_buffer[62]<<8)|(unsigned char)RX_buffer[61];
-                selector[currPacketId*4+3] = (unsigned char)RX_buffer[63];
-                break;
-
-            case 6:
-                proxAmbientValue[currPacketId*4+3][4] = ((signed int)RX_buffer[50]<<8)|(unsigned char)RX_buffer[49];
-                groundAmbientValue[currPacketId*4+3][0] = ((signed int)RX_buffer[52]<<8)|(unsigned char)RX_buffer[51];
-                groundAmbientValue[currPacketId*4+3][1] = ((signed int)RX_buffer[54]<<8)|(unsigned char)RX_buffer[53];
-                groundAmbientValue[currPacketId*4+3][2] = ((signed int)RX_buffer[56]<<8)|(unsigned char)RX_buffer[55];
-                groundAmbientValue[currPacketId*4+3][3] = ((signed int)RX_buffer[58]<<8)|(unsigned char)RX_buffer[57];
-                accZ[currPacketId*4+3] = ((signed int)RX_buffer[60]<<8)|(unsigned char)RX_buffer[59];
-                batteryAdc[currPacketId*4+3] = ((signed int)RX_buffer[62]<<8)|(unsigned char)RX_buffer[61];
-                heading[currPacketId*4+3] = ((unsigned char)RX_buffer[63])<<1;
-                break;
-
-            case 7:
-                leftMotSteps[currPacketId*4+3] = ((signed long)((unsigned char)RX_buffer[52]<<24)| ((unsigned char)RX_buffer[51]<<16)| ((unsigned char)RX_buffer[50]<<8)|((unsigned char)RX_buffer[49]));
-                rightMotSteps[currPacketId*4+3] = ((signed long)((unsigned char)RX_buffer[56]<<24)| ((unsigned char)RX_buffer[55]<<16)| ((unsigned char)RX_buffer[54]<<8)|((unsigned char)RX_buffer[53]));
-                robTheta[currPacketId*4+3] = ((((signed int)RX_buffer[58]<<8)|(unsigned char)RX_buffer[57])/10);//%360;
-                robXPos[currPacketId*4+3] = ((signed int)RX_buffer[60]<<8)|(unsigned char)RX_buffer[59];
-                robYPos[currPacketId*4+3] = ((signed int)RX_buffer[62]<<8)|(unsigned char)RX_buffer[61];
-                gyroZ[currPacketId*4+3] = RX_buffer[63]<<6;
-                break;
+        i = -1;
+    }
+    freeMutexSubs(ctx);
+    return i;
+}
+
+void removeSubscription(elisa3_ctx *ctx, int subscription) {
+    setMutexSubs(ctx);
+    if(subscription>=0 && subscription<ctx->subsEnd && ctx->subs[subscription].active) {
+        ctx->subs[subscription].active = 0;
+        while(ctx->subsEnd > 0 && !ctx->subs[ctx->subsEnd-1].active) {
+            ctx->subsEnd--;
         }
+        __atomic_store_n(&ctx->numSubscriptions, ctx->numSubscriptions-1, __ATOMIC_RELAXED);
     }
+    freeMutexSubs(ctx);
+}
 
-#if defined(_WIN32) || defined(_WIN64)
-    ReleaseMutex(mutexRx);
-#endif
-#if defined(__linux__) || defined(__APPLE__)
-    pthread_mutex_unlock(&mutexRx);
-#endif
+int elisa3_subscribeSensors(elisa3_ctx *ctx, int robotAddr, unsigned int packetTypes, sensorsCallback callback, void *userData) {
+    if(callback == NULL) {
+        return -1;
+    }
+    return addSubscription(ctx, robotAddr, packetTypes, callback, userData, NULL);
+}
 
+void elisa3_unsubscribeSensors(elisa3_ctx *ctx, int subscription) {
+    if(subscription>=0 && subscription<MAX_SUBSCRIPTIONS && ctx->subs[subscription].ring==NULL) {
+        removeSubscription(ctx, subscription);
+    }
 }
 
-#if defined(_WIN32) || defined(_WIN64)
-DWORD WINAPI CommThread( LPVOID lpParameter) {
+sensorsRing* elisa3_subscribeSensorsRing(elisa3_ctx *ctx, int robotAddr, unsigned int packetTypes, unsigned int size) {
+    sensorsRing *ring = NULL;
+    unsigned int capacity = 1;
+    if(size == 0 || size > (1u<<20)) {
+        return NULL;
+    }
+    while(capacity < size) {
+        capacity <<= 1;
+    }
+    ring = alignedAlloc(sizeof(sensorsRing) + capacity*sizeof(sensorsEvent));
+    if(ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(sensorsRing));
+    ring->mask = capacity-1;
+    if(addSubscription(ctx, robotAddr, packetTypes, NULL, NULL, ring) < 0) {
+        alignedFree(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+void elisa3_unsubscribeSensorsRing(elisa3_ctx *ctx, sensorsRing *ring) {
     int i = 0;
+    if(ring == NULL) {
+        return;
+    }
+    setMutexSubs(ctx);
+    for(i=0; i<ctx->subsEnd; i++) {
+        if(ctx->subs[i].active && ctx->subs[i].ring==ring) {
+            removeSubscription(ctx, i);
+            break;
+        }
+    }
+    freeMutexSubs(ctx);
+    alignedFree(ring);
+}
 
-    SYSTEMTIME currTimeRF;
-    FILETIME currTimeRFF;
-    ULONGLONG currTimeRF64;
-    SYSTEMTIME txTimeRF;
-    FILETIME txTimeRFF;
-    ULONGLONG txTimeRF64;
-    SYSTEMTIME exitTime;
-    FILETIME exitTimeF;
-    ULONGLONG exitTime64;
-
-    GetSystemTime(&currTimeRF);
-    SystemTimeToFileTime(&currTimeRF, &currTimeRFF);
-    currTimeRF64 = (((ULONGLONG) currTimeRFF.dwHighDateTime) << 32) + currTimeRFF.dwLowDateTime;
-    GetSystemTime(&txTimeRF);
-    SystemTimeToFileTime(&txTimeRF, &txTimeRFF);
-    txTimeRF64 = (((ULONGLONG) txTimeRFF.dwHighDateTime) << 32) + txTimeRFF.dwLowDateTime;
-    GetSystemTime(&exitTime);
-    SystemTimeToFileTime(&exitTime, &exitTimeF);
-    exitTime64 = (((ULONGLONG) exitTimeF.dwHighDateTime) << 32) + exitTimeF.dwLowDateTime;
+int popSensorsEvent(sensorsRing *ring, sensorsEvent *event) {
+    unsigned int tail = ring->tail;
+    if(tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *event = ring->events[tail & ring->mask];
+    __atomic_store_n(&ring->tail, tail+1, __ATOMIC_RELEASE);
+    return 1;
+}
 
-    while(1) {
+unsigned long getSensorsEventsLost(sensorsRing *ring) {
+    return __atomic_load_n(&ring->lost, __ATOMIC_RELAXED);
+}
 
-        if(stopTransmissionFlag==1) {
-            continue;
-        }
+void elisa3_setUpdateRate(elisa3_ctx *ctx, int robotAddr, double rateHz) {
+    struct robotTable *table = NULL;
+    int id = getIdFromAddress(ctx, robotAddr);
+    if(id>=0) {
+        setMutexTx(ctx);
+        table = loadTable(ctx);
+        table->sched[id].updatePeriodUs = (rateHz > 0) ? (unsigned long)(1000000.0/rateHz) : 0;
+        freeMutexTx(ctx);
+    }
+}
 
-        transferData();
+// Restart the "lastMessageSentFlag" state machine of a robot (with "mutexRx" locked): only the acks of the packets built
+// from now on advance it, that is from the next packet sequence of the link of the robot (see "scheduleSlots").
+void resetSentFlag(elisa3_ctx *ctx, struct robotTable *table, int id) {
+    table->rx[id].lastMessageSentFlag = 0;
+    if(ctx->numLinks > 0) {
+        table->rx[id].sentFlagSeq = __atomic_load_n(&ctx->links[(id/NUM_ROBOTS)%ctx->numLinks].packetSeq, __ATOMIC_SEQ_CST);
+    }
+}
 
-        if(payloadId == 255) {
-            payloadId = 0;
-        } else {
-            payloadId++;
-        }
+// Wait for the "lastMessageSentFlag" state machine of the robots to complete (see "handleRxPacket"). The waiting threads
+// sleep on "rxEvent", signaled by the communication threads when a robot acknowledges its message: they use no cpu and
+// are woken up as soon as the ack is decoded. Since a single event is shared by all the robots, a thread can be woken up
+// by the ack of another robot, it then checks its robots and sleeps again. The robots not in the list aren't waited for.
+// Return the number of robots that didn't acknowledge, "notSent" (optional) receives the result of each one; -1 when
+// called from a communication thread of the context (a callback), the acks would be decoded by that same thread.
+int waitMessagesSent(elisa3_ctx *ctx, int *robotAddr, int numRobots, unsigned long us, unsigned char *notSent) {
+    unsigned long long deadline = getTimeUs()+us, now = 0;
+    struct robotTable *table = NULL;
+    int i = 0, id = 0, remaining = 0;
+    unsigned char pending = 0;
 
-        currPacketId++;
-        if(currPacketId*4 >= currNumRobots) {
-            currPacketId = 0;
-            numOfPackets++; // num packets sent to each robot
+    if(commThreadCtx == ctx) {
+        if(notSent != NULL) {
+            memset(notSent, 1, numRobots);
         }
+        return -1;
+    }
 
-        while(1) {
-            GetSystemTime(&currTimeRF);
-            SystemTimeToFileTime(&currTimeRF, &currTimeRFF);
-            currTimeRF64 = (((ULONGLONG) currTimeRFF.dwHighDateTime) << 32) + currTimeRFF.dwLowDateTime;    // 100 nsec resolution
-
-            if(((currTimeRF64-txTimeRF64)/10000 > 4)) {   // 4 ms => transfer @ 250 Hz
-                GetSystemTime(&txTimeRF);
-                SystemTimeToFileTime(&txTimeRF, &txTimeRFF);
-                txTimeRF64 = (((ULONGLONG) txTimeRFF.dwHighDateTime) << 32) + txTimeRFF.dwLowDateTime;
-                break;
-            }
+    setMutexRx(ctx);
+    for(i=0; i<numRobots; i++) {
+        id = lookupRobot(ctx, robotAddr[i], &table);
+        if(id>=0) {
+            resetSentFlag(ctx, table, id);
         }
-
-        if(((currTimeRF64-exitTime64)/10000 > 5000)) { // 5 seconsd
-            GetSystemTime(&exitTime);
-            SystemTimeToFileTime(&exitTime, &exitTimeF);
-            exitTime64 = (((ULONGLONG) exitTimeF.dwHighDateTime) << 32) + exitTimeF.dwLowDateTime;
-            setMutexThread();
-            for(i=0; i<currNumRobots; i++) {
-                errorPercentage[i] = numOfErrors[i]/numOfPackets*100.0;
-                //printf("errorPercentage[%d] = %f\r\n", i, errorPercentage[i]);
-                numOfErrors[i] = 0;
+    }
+    ctx->rxWaiters++;
+    while(1) {
+        remaining = 0;
+        for(i=0; i<numRobots; i++) {
+            id = lookupRobot(ctx, robotAddr[i], &table);  // the robots list could change meanwhile
+            pending = (id>=0 && table->rx[id].lastMessageSentFlag!=3);
+            if(notSent != NULL) {
+                notSent[i] = pending;
             }
-            freeMutexThread();
-            numOfPackets = 0;
+            remaining += pending;
+        }
+        if(remaining == 0) {
+            break;
         }
+        now = getTimeUs();
+        if(now >= deadline) {
+            break;
+        }
+        waitRxEvent(ctx, deadline-now);
     }
+    ctx->rxWaiters--;
+    freeMutexRx(ctx);
 
-    return 0;
+    return remaining;
 }
-#endif
-
-#if defined(__linux__) || defined(__APPLE__)
-void *CommThread(void *arg) {
-	int i = 0;
-	struct timeval currTimeRF, txTimeRF, exitTime;
 
-    gettimeofday(&currTimeRF, NULL);
-	gettimeofday(&txTimeRF, NULL);
-	gettimeofday(&exitTime, NULL);
+unsigned char waitMessageSent(elisa3_ctx *ctx, int robotAddr, unsigned long us) {
+    return (waitMessagesSent(ctx, &robotAddr, 1, us, NULL) != 0) ? 1 : 0;
+}
 
-    while(1) {
+unsigned char elisa3_waitForUpdate(elisa3_ctx *ctx, int robotAddr, unsigned long us) {
+    return waitMessageSent(ctx, robotAddr, us);
+}
 
-        if(stopTransmissionFlag==1) {
-            continue;
-        }
+unsigned char elisa3_waitForMessageTransmission(elisa3_ctx *ctx, int robotAddr, unsigned long us) {
+    return waitMessageSent(ctx, robotAddr, us);
+}
 
-        transferData();
+int elisa3_waitForUpdateGroup(elisa3_ctx *ctx, int *robotAddr, int numRobots, unsigned long us, unsigned char *notUpdated) {
+    if(numRobots<=0 || robotAddr==NULL) {
+        return 0;
+    }
+    return waitMessagesSent(ctx, robotAddr, numRobots, us, notUpdated);
+}
 
-        if(payloadId == 255) {
-            payloadId = 0;
-        } else {
-            payloadId++;
-        }
+void recordLatency(unsigned int *histogram, unsigned long long *maxUs, unsigned long long us) {
+    int bucket = 63-__builtin_clzll(us|1);
+    if(bucket >= LATENCY_BUCKETS) {
+        bucket = LATENCY_BUCKETS-1;
+    }
+    __atomic_store_n(&histogram[bucket], histogram[bucket]+1, __ATOMIC_RELAXED);
+    if(us > *maxUs) {
+        __atomic_store_n(maxUs, us, __ATOMIC_RELAXED);
+    }
+}
 
-        currPacketId++;
-        if(currPacketId*4 >= currNumRobots) {
-            currPacketId = 0;
-            numOfPackets++; // num packets sent to each robot
-        }
-        //printf("curr packet id = %d\r\n", currPacketId);
+void countRFOutcome(elisa3_ctx *ctx, int id, int outcome, unsigned long long rxTime) {
+    struct robotStats *stats = &ctx->stats[id];
+    unsigned int second = (unsigned int)(rxTime/1000000), ten = second/10;
+    int i = second%STATS_SECONDS, j = ten%STATS_TENS;
+    if(stats->secondTag[i] != second) {
+        memset(stats->second[i], 0, sizeof(stats->second[i]));
+        stats->secondTag[i] = second;
+    }
+    if(stats->tenTag[j] != ten) {
+        memset(stats->ten[j], 0, sizeof(stats->ten[j]));
+        stats->tenTag[j] = ten;
+    }
+    stats->second[i][outcome]++;
+    stats->ten[j][outcome]++;
+}
 
-        while(1) {
-            gettimeofday(&currTimeRF, NULL);
+// Apply the timed commands of the robot whose time is reached (with "mutexTx" locked), before the robot is considered
+// by the scheduler: a command applied makes the robot pending, thus it is sent in the packet being built.
+void applyDueCommands(elisa3_ctx *ctx, int id, unsigned long long now) {
+    struct commandQueue *queue = __atomic_load_n(&ctx->sched[id].commands, __ATOMIC_ACQUIRE);
+    struct robotTx *robot = &ctx->tx[id];
+    const timedCommand *command = NULL;
+    unsigned int head = 0, tail = 0, clearTo = 0;
 
-            if((((currTimeRF.tv_sec * 1000000 + currTimeRF.tv_usec)-(txTimeRF.tv_sec * 1000000 + txTimeRF.tv_usec)) > 4000)) {   // 4 ms => transfer @ 250 Hz
-                gettimeofday(&txTimeRF, NULL);
-                break;
+    if(queue == NULL) {
+        return;
+    }
+    head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    clearTo = __atomic_load_n(&queue->clearTo, __ATOMIC_ACQUIRE);
+    tail = queue->tail;
+    if((int)(clearTo-tail) > 0) {
+        tail = clearTo;
+    }
+    while(tail != head && queue->commands[tail & (COMMAND_QUEUE_SIZE-1)].time <= now) {
+        command = &queue->commands[tail & (COMMAND_QUEUE_SIZE-1)];
+        if(command->fields & COMMAND_SPEED) {
+            robot->leftSpeed = command->left;
+            robot->rightSpeed = command->right;
+        }
+        if(command->fields & COMMAND_RGB) {
+            robot->redLed = command->red;
+            robot->greenLed = command->green;
+            robot->blueLed = command->blue;
+        }
+        if(command->fields & COMMAND_FLAGS) {
+            robot->flagsTX[0] = command->flags[0];
+            robot->flagsTX[1] = command->flags[1];
+        }
+        if(command->fields & COMMAND_LEDS) {
+            robot->smallLeds = command->leds;
+        }
+        tail++;
+    }
+    __atomic_store_n(&queue->tail, tail, __ATOMIC_RELEASE);
+}
+
+// Choose the robots of the next packet of the link (with "mutexTx" locked). The candidates are the robots of the groups
+// handled by the link, the last group completed up to 4 entries: the whole list of the link is scanned at each packet.
+void scheduleSlots(struct commLink *link, int *slots, unsigned long long now) {
+    elisa3_ctx *ctx = link->ctx;
+    slotScheduler scheduler = (ctx->scheduler != NULL) ? ctx->scheduler : schedulePriority;
+    struct robotSched *robotSched = NULL;
+    slotCandidate *candidate = NULL;
+    int numGroups = 0, maxCandidates = 0, numCandidates = 0, numChosen = 0;
+    int chosen[NUM_ROBOTS];
+    int g = 0, i = 0, j = 0, k = 0;
+
+    numGroups = ((ctx->currNumRobots > NUM_ROBOTS ? ctx->currNumRobots : NUM_ROBOTS)+3)/4;
+    maxCandidates = ((numGroups-link->index+ctx->numLinks-1)/ctx->numLinks)*NUM_ROBOTS;
+    if(maxCandidates > link->candidateCapacity) {
+        slotCandidate *candidates = realloc(link->candidates, maxCandidates*sizeof(slotCandidate));
+        int *candidateIds = (candidates != NULL) ? realloc(link->candidateIds, maxCandidates*sizeof(int)) : NULL;
+        if(candidates != NULL) {
+            link->candidates = candidates;
+        }
+        if(candidateIds == NULL) {  // keep sending the first group of the link
+            for(i=0; i<NUM_ROBOTS; i++) {
+                slots[i] = link->index*NUM_ROBOTS+i;
             }
-        }
-
-        if(((currTimeRF.tv_sec * 1000000 + currTimeRF.tv_usec)-(exitTime.tv_sec * 1000000 + exitTime.tv_usec) > 5000000)) { // 5 seconds
-            gettimeofday(&exitTime, NULL);
-            setMutexThread();
-            for(i=0; i<currNumRobots; i++) {
-                errorPercentage[i] = numOfErrors[i]/numOfPackets*100.0;
-                //printf("errorPercentage[%d] = %f\r\n", i, errorPercentage[i]);
-                numOfErrors[i] = 0;
+            return;
+        }
+        link->candidateIds = candidateIds;
+        link->candidateCapacity = maxCandidates;
+    }
+
+    for(g=link->index; g<numGroups; g+=ctx->numLinks) {
+        for(i=g*NUM_ROBOTS; i<(g+1)*NUM_ROBOTS; i++) {
+            robotSched = &ctx->sched[i];
+            candidate = &link->candidates[numCandidates];
+            applyDueCommands(ctx, i, now);
+            if(memcmp(&ctx->tx[i], &robotSched->lastSent, TX_COMMANDS_SIZE) != 0) {
+                if(robotSched->pendingSince == 0) {
+                    robotSched->pendingSince = now;
+                }
+            } else {
+                robotSched->pendingSince = 0;
             }
-            freeMutexThread();
-            numOfPackets = 0;
+            candidate->robotAddr = ctx->tx[i].robotAddress;
+            candidate->txPending = (robotSched->pendingSince != 0);
+            candidate->padding = (i >= (int)ctx->currNumRobots);
+            candidate->unreachable = (robotSched->failures >= LIVENESS_FAILURES);
+            candidate->probeTime = robotSched->probeTime;
+            candidate->pendingSince = robotSched->pendingSince;
+            candidate->lastTxTime = robotSched->lastTxTime;
+            candidate->lastRxTime = robotSched->lastRxTime;
+            candidate->updatePeriodUs = robotSched->updatePeriodUs;
+            link->candidateIds[numCandidates++] = i;
+        }
+    }
+
+    numChosen = scheduler(ctx->schedulerData, link->candidates, numCandidates, chosen, NUM_ROBOTS, now);
+    if(numChosen < 0) {
+        numChosen = 0;
+    } else if(numChosen > NUM_ROBOTS) {
+        numChosen = NUM_ROBOTS;
+    }
+    // keep only valid and distinct choices, the slots left are filled with the first candidates not chosen
+    for(i=0, k=0; i<numChosen; i++) {
+        if(chosen[i] < 0 || chosen[i] >= numCandidates) {
+            continue;
+        }
+        for(j=0; j<k && slots[j]!=link->candidateIds[chosen[i]]; j++);
+        if(j == k) {
+            slots[k++] = link->candidateIds[chosen[i]];
+        }
+    }
+    for(i=0; k<NUM_ROBOTS && i<numCandidates; i++) {
+        for(j=0; j<k && slots[j]!=link->candidateIds[i]; j++);
+        if(j == k) {
+            slots[k++] = link->candidateIds[i];
         }
     }
-
 }
-#endif
 
+// Deliver the packets just decoded to the subscribers, outside "mutexRx" so that the callbacks can use the library.
+void notifySubscribers(elisa3_ctx *ctx, const int *slots, const int *packetTypes) {
+    struct subscription *sub = NULL;
+    sensorsEvent event;
+    struct robotTable *table = NULL;
+    unsigned int seq = 0, head = 0, numRobots = 0;
+    unsigned char copied = 0;
+    int i = 0, j = 0, address = 0;
 
+    if(__atomic_load_n(&ctx->numSubscriptions, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+
+    setMutexSubs(ctx);
+    numRobots = swarmTable(ctx, &table);
+    for(i=0; i<NUM_ROBOTS; i++) {
+        if(packetTypes[i] < 0 || slots[i] >= (int)numRobots) {
+            continue;
+        }
+        address = table->tx[slots[i]].robotAddress;
+        copied = 0;
+        for(j=0; j<ctx->subsEnd; j++) {
+            sub = &ctx->subs[j];
+            if(!sub->active || !(sub->packetTypes & (1<<packetTypes[i])) || (sub->robotAddr!=ALL_ROBOTS && sub->robotAddr!=address)) {
+                continue;
+            }
+            if(!copied) {   // one copy of the data for all the subscribers
+                event.robotAddr = address;
+                event.packetType = packetTypes[i];
+                do {
+                    seq = rxReadBegin(table, slots[i]);
+                    copySensors(table, slots[i], &event.sensors);
+                } while(rxReadRetry(table, slots[i], seq));
+                copied = 1;
+            }
+            if(sub->ring != NULL) {
+                head = sub->ring->head;
+                if(head - __atomic_load_n(&sub->ring->tail, __ATOMIC_ACQUIRE) > sub->ring->mask) {    // full
+                    __atomic_store_n(&sub->ring->lost, sub->ring->lost+1, __ATOMIC_RELAXED);
+                } else {
+                    sub->ring->events[head & sub->ring->mask] = event;
+                    __atomic_store_n(&sub->ring->head, head+1, __ATOMIC_RELEASE);
+                }
+            } else {
+                sub->callback(sub->userData, &event);
+            }
+        }
+    }
+    freeMutexSubs(ctx);
+}
+
+void prepareTxPacket(struct commLink *link, struct packetInfo *packet, char *txBuf, unsigned char payloadId) {
+    elisa3_ctx *ctx = link->ctx;
+    int *slots = packet->robots;
+    struct robotTx *robots[NUM_ROBOTS];
+    unsigned long long now = getTimeUs();
+    int i = 0;
+
+    setMutexTx(ctx);
+
+    applyCommandFrame(ctx);
+    scheduleSlots(link, slots, now);
+    packet->seq = __atomic_fetch_add(&link->packetSeq, 1, __ATOMIC_SEQ_CST);   // read by "resetSentFlag"
+    for(i=0; i<NUM_ROBOTS; i++) {
+        link->txSlots[i] = slots[i];
+        robots[i] = &ctx->tx[slots[i]];
+        packet->address[i] = robots[i]->robotAddress;
+    }
+    codecEncodeTx(txBuf, robots, NUM_ROBOTS, payloadId);
+    memcpy(packet->tx, txBuf, PACKETS_SIZE);
+    for(i=0; i<NUM_ROBOTS; i++) {
+        memcpy(&packet->sent[i], robots[i], sizeof(struct robotTx));
+    }
+
+    freeMutexTx(ctx);
+
+}
+
+// Scheduling bookkeeping of the robots of a packet, once it is handed to the base-station: a packet that couldn't be
+// sent leaves the robots with their commands pending, they are scheduled again as if it was never built.
+void txPacketSent(elisa3_ctx *ctx, const struct packetInfo *packet) {
+    const int *slots = packet->robots;
+    struct robotTx *robot = NULL;
+    struct robotSched *robotSched = NULL;
+    int i = 0;
+
+    setMutexTx(ctx);
+    for(i=0; i<NUM_ROBOTS; i++) {
+        robotSched = &ctx->sched[slots[i]];
+        if(packet->address[i] == ctx->tx[slots[i]].robotAddress) {  // not replaced after the packet was built
+            memcpy(&robotSched->lastSent, &packet->sent[i], sizeof(struct robotTx));
+            if(robotSched->pendingSince!=0 && robotSched->unackedSince==0) {   // the ack of this packet (or a later one) completes the change
+                robotSched->unackedSince = robotSched->pendingSince;
+                robotSched->unackedSeq = packet->seq;
+            }
+            robotSched->pendingSince = 0;
+            robotSched->lastTxTime = packet->txTime;
+        }
+        robot = &ctx->tx[slots[i]];
+        robot->calibrationSent++;
+        robot->calibrateOdomSent++;
+        if(robot->calibrationSent > 2) {
+            CALIBRATION_OFF(robot->flagsTX[0]);
+        }
+        if(robot->calibrateOdomSent > 2) {
+            robot->flagsTX[1] &= ~(1<<0);
+        }
+    }
+    freeMutexTx(ctx);
+
+}
+
+// Liveness: a robot that doesn't answer LIVENESS_FAILURES times in a row is unreachable, the schedulers then give its
+// slot to the other robots and send it a packet only at the probe time, with an interval doubling at each probe failed
+// (from PROBE_MIN_US to PROBE_MAX_US). Any ack brings it back.
+void robotFailed(struct robotSched *robotSched, unsigned long long rxTime) {
+    unsigned long long interval = PROBE_MIN_US;
+    unsigned int i = 0;
+
+    if(robotSched->failures < LIVENESS_FAILURES) {
+        __atomic_store_n(&robotSched->failures, robotSched->failures+1, __ATOMIC_RELAXED);
+        if(robotSched->failures < LIVENESS_FAILURES) {
+            return;
+        }
+    } else {
+        robotSched->probesFailed++;
+    }
+    for(i=0; i<robotSched->probesFailed && interval<PROBE_MAX_US; i++) {
+        interval *= 2;
+    }
+    robotSched->probeTime = rxTime + ((interval < PROBE_MAX_US) ? interval : PROBE_MAX_US);
+}
+
+void handleRxPacket(struct commLink *link, const struct packetInfo *packet, char *rxBuf, unsigned long long rxTime) {
+    elisa3_ctx *ctx = link->ctx;
+    const int *slots = packet->robots;
+    struct robotSched *robotSched = NULL;
+    struct robotRx *robots[NUM_ROBOTS];
+    int packetTypes[NUM_ROBOTS];
+    struct robotRx *robot = NULL;
+    unsigned char id = 0, acked = 0, fresh = 0;
+    int i = 0;
+
+    setMutexRx(ctx);
+    memcpy(link->rxSlots, slots, sizeof(link->rxSlots));
+    beginRxUpdate(ctx, slots);
+
+    for(i=0; i<NUM_ROBOTS; i++) {
+        robot = &ctx->rx[slots[i]];
+        id = (unsigned char)rxBuf[i*CODEC_RX_SLOT_SIZE];
+
+        if(packet->address[i] != ctx->tx[slots[i]].robotAddress) {  // robot replaced after the packet was built
+            robots[i] = NULL;
+            packetTypes[i] = -1;
+            continue;
+        }
+
+        // when the flag "lastMessageSentFlag" is reset we aren't sure the current message is really sent to the radio module
+        // for next transmission to the robots so we wait the message is sent twice; only the packets built after the
+        // reset count, the ones already in flight carry the previous commands (see "resetSentFlag")
+        fresh = ((int)(packet->seq-robot->sentFlagSeq) >= 0);
+        if(fresh && robot->lastMessageSentFlag==0) {
+            robot->lastMessageSentFlag=1;
+        } else if(fresh && robot->lastMessageSentFlag==1) {
+            robot->lastMessageSentFlag=2;
+        }
+
+        // the base-station returns these "error" codes:
+        // - 0 => transmission succeed (no ack received though)
+        // - 1 => ack received (should not be returned because if the ack is received, then the payload is read)
+        // - 2 => transfer failed
+        countRFOutcome(ctx, slots[i], (id<=2) ? id+RF_NO_ACK : RF_DATA, rxTime);
+        robotSched = &ctx->sched[slots[i]];
+        if(packet->usbError == 0) {     // a usb failure (buffer left zeroed) is the base-station's, not the robots'
+            if(id<=2) {     // no data: not answered, transfer failed, or an ack without payload
+                robotFailed(robotSched, rxTime);
+            } else {
+                __atomic_store_n(&robotSched->failures, 0, __ATOMIC_RELAXED);
+                robotSched->probesFailed = 0;
+            }
+        }
+        if(id>=1 && id!=2 && robotSched->unackedSince!=0 && (int)(packet->seq-robotSched->unackedSeq)>=0) {
+            recordLatency(link->ackLatency, &link->ackLatencyMax, rxTime-robotSched->unackedSince);
+            robotSched->unackedSince = 0;
+        }
+        if(id<=2) { // if something goes wrong skip the data
+            robot->numOfErrors++;
+            robots[i] = NULL;
+            packetTypes[i] = -1;
+        } else {
+            if(fresh && robot->lastMessageSentFlag==2) {
+                robot->lastMessageSentFlag=3;
+                acked = 1;
+            }
+            markRxUpdate(ctx, slots[i], id, rxTime);
+            if(robot->dataEpoch == 0) {
+                robot->dataEpoch = ctx->rosterEpoch;
+            }
+            ctx->sched[slots[i]].lastRxTime = rxTime;
+            robots[i] = robot;
+            packetTypes[i] = (id<3+RX_PACKET_TYPES) ? id-3 : -1;
+        }
+    }
+
+    // extract the sensors data of the robots based on the packet id (first byte of each slot), see "packet-codec.c"
+    codecDecodeRx(rxBuf, robots, NUM_ROBOTS);
+
+    endRxUpdate(ctx, slots);
+    memset(link->rxSlots, NO_ROBOT, sizeof(link->rxSlots));
+    if(ctx->recorder != NULL) {
+        recorderAppend(ctx->recorder, link->device, packet->address, packet->tx, rxBuf, packet->txTime, rxTime, packet->usbError);
+    }
+    if(ctx->sharedExport != NULL) {
+        for(i=0; i<NUM_ROBOTS; i++) {
+            if(packet->address[i] == ctx->tx[slots[i]].robotAddress) {
+                exportRobotState(ctx, slots[i]);
+            }
+        }
+        exportLinkState(link, rxTime);
+    }
+    if(acked && ctx->rxWaiters>0) {     // wake up the threads in "waitMessageSent"
+        signalRxEvent(ctx);
+    }
+    freeMutexRx(ctx);
+
+    notifySubscribers(ctx, slots, packetTypes);
+
+}
+
+// Count a failed usb transfer of the link; the message is printed at most once per second since a base-station
+// unplugged fails every exchange.
+void linkUsbError(struct commLink *link, const char *message) {
+    unsigned long long now = getTimeUs();
+    link->usbErrors++;
+    if(link->usbErrorReportTime==0 || now-link->usbErrorReportTime>=1000000) {
+        link->usbErrorReportTime = now;
+        printf("%s\n", message);
+    }
+}
+
+void transferDataLink(struct commLink *link) {
+    elisa3_ctx *ctx = link->ctx;
+    struct packetInfo packet;
+    unsigned long long rxTime = 0;
+
+    int err=0;
+
+    prepareTxPacket(link, &packet, link->TX_buffer, link->payloadId);
+
+    // transfer the data to the base-station
+    packet.txTime = getTimeUs();
+    err = usb_send_dev(link->device, link->TX_buffer, PACKETS_SIZE-UNUSED_BYTES);
+    packet.usbError = (err < 0) ? err : 0;
+    if(err < 0) {
+        linkUsbError(link, "send error!");
+    } else {
+        txPacketSent(ctx, &packet);
+    }
+
+    link->RX_buffer[0] = 0;
+    link->RX_buffer[16] = 0;
+    link->RX_buffer[32] = 0;
+    link->RX_buffer[48] = 0;
+    err = usb_receive_dev(link->device, link->RX_buffer, 64);     // receive the ack payload for 4 robots at a time (16 bytes for each one)
+    rxTime = getTimeUs();
+    if(err < 0) {
+        linkUsbError(link, "receive error!");
+        packet.usbError = err;
+    } else {
+        recordLatency(link->usbLatency, &link->usbLatencyMax, rxTime-packet.txTime);
+    }
+
+    handleRxPacket(link, &packet, link->RX_buffer, rxTime);
+
+}
+
+void elisa3_transferData(elisa3_ctx *ctx) {
+    transferDataLink(&ctx->links[0]);
+}
+
+void completeExchangeAsync(struct commLink *link) {
+    int err=0, tag=-1;
+    unsigned long long rxTime = 0;
+
+    err = usb_exchange_wait(link->device, link->RX_buffer, 64, &tag);
+    rxTime = getTimeUs();
+    if(tag < 0) {  // nothing in flight
+        return;
+    }
+    link->inFlight[tag].usbError = err;
+    if(err == 0) {
+        recordLatency(link->usbLatency, &link->usbLatencyMax, rxTime-link->inFlight[tag].txTime);
+        handleRxPacket(link, &link->inFlight[tag], link->RX_buffer, rxTime);
+    } else {
+        linkUsbError(link, "receive error!");
+        link->RX_buffer[0] = 0;   // report a transfer failure for all the robots of the packet
+        link->RX_buffer[16] = 0;
+        link->RX_buffer[32] = 0;
+        link->RX_buffer[48] = 0;
+        handleRxPacket(link, &link->inFlight[tag], link->RX_buffer, rxTime);
+    }
+}
+
+void transferDataAsync(struct commLink *link) {
+    elisa3_ctx *ctx = link->ctx;
+
+    int err=0, tag=link->nextTag;
+
+    // the packet is built while the previous exchanges are still in flight, the robots of each exchange are kept
+    // until its answer is decoded (at most "USB_MAX_ASYNC_DEPTH" in flight plus the one being prepared)
+    prepareTxPacket(link, &link->inFlight[tag], link->TX_buffer, link->payloadId);
+    link->nextTag = (tag+1) % (USB_MAX_ASYNC_DEPTH+1);
+
+    while(usb_async_pending(link->device) >= usb_async_depth(link->device)) {
+        completeExchangeAsync(link);
+    }
+
+    link->inFlight[tag].txTime = getTimeUs();
+    err = usb_exchange_submit(link->device, link->TX_buffer, PACKETS_SIZE-UNUSED_BYTES, 64, tag);
+    if(err < 0) {
+        linkUsbError(link, "send error!");
+    } else {
+        txPacketSent(ctx, &link->inFlight[tag]);
+    }
+
+    // decode the exchanges already completed without waiting for the others
+    while(usb_async_pending(link->device) > 0 && usb_exchange_completed(link->device)) {
+        completeExchangeAsync(link);
+    }
+
+}
+
+// Adaptive pacing: the transfer functions block on the base-station (the whole exchange, or the oldest exchange in
+// flight when the pipeline is full), so the time spent in them is the time the base-station needs per packet. The
+// period is kept a margin above its average and reduced a little at each exchange to probe a faster rate; a failed
+// exchange (usb error, short transfer) doubles it.
+void adaptPeriod(struct commLink *link, unsigned long long transferUs, int failed) {
+    unsigned long long period = link->periodUs, floor = 0;
+
+    link->transferAvgUs = (link->transferAvgUs == 0) ? transferUs : (7*link->transferAvgUs + transferUs)/8;
+    floor = link->transferAvgUs + link->transferAvgUs/ADAPTIVE_MARGIN;
+    if(failed) {
+        period *= 2;
+    } else {
+        period -= period/ADAPTIVE_PROBE;
+    }
+    if(period < floor) {
+        period = floor;
+    }
+    if(period < ADAPTIVE_MIN_PERIOD_US) {
+        period = ADAPTIVE_MIN_PERIOD_US;
+    } else if(period > ADAPTIVE_MAX_PERIOD_US) {
+        period = ADAPTIVE_MAX_PERIOD_US;
+    }
+    __atomic_store_n(&link->periodUs, (unsigned long)period, __ATOMIC_RELAXED);
+}
+
+void commLoop(struct commLink *link) {
+    elisa3_ctx *ctx = link->ctx;
+    unsigned long errors = 0;
+    unsigned long long currTime = getTimeUs(), jitter = 0, nextTransferTime = currTime, transferTime = 0;
+
+    commThreadCtx = ctx;
+    link->periodUs = ctx->transferPeriodUs;
+    link->transferAvgUs = 0;
+
+    while(ctx->commThreadRunning) {
+
+        if(ctx->asyncDepthRequested != usb_async_depth(link->device)) {  // switch transfer mode, the exchanges in flight are completed first
+            while(usb_async_pending(link->device) > 0) {
+                completeExchangeAsync(link);
+            }
+            usb_stop_async(link->device);
+            if(ctx->asyncDepthRequested > 0 && usb_start_async(link->device, ctx->asyncDepthRequested) < 0) {
+                ctx->asyncDepthRequested = 0;
+            }
+        }
+
+        // nothing to do when stopped or when there are less groups of robots than base-stations
+        if(ctx->stopTransmissionFlag==1 || (link->index > 0 && (unsigned int)link->index*4 >= ctx->currNumRobots)) {
+            sleepUntilUs(getTimeUs()+ctx->transferPeriodUs);
+            nextTransferTime = getTimeUs();
+            continue;
+        }
+
+        errors = link->usbErrors;
+        transferTime = getTimeUs();
+        if(usb_async_depth(link->device) > 0) {
+            transferDataAsync(link);
+        } else {
+            transferDataLink(link);
+        }
+        if(ctx->adaptiveTransfer) {
+            adaptPeriod(link, getTimeUs()-transferTime, link->usbErrors!=errors);
+        } else if(link->periodUs != ctx->transferPeriodUs) {
+            __atomic_store_n(&link->periodUs, ctx->transferPeriodUs, __ATOMIC_RELAXED);
+            link->transferAvgUs = 0;
+        }
+
+        if(link->payloadId == 255) {
+            link->payloadId = 0;
+        } else {
+            link->payloadId++;
+        }
+
+        // Sleep until the next absolute deadline (4 ms => transfer @ 250 Hz by default); if the transfer took
+        // longer than a whole period (e.g. usb blocked) the schedule restart from now instead of sending a burst.
+        nextTransferTime += link->periodUs;
+        currTime = getTimeUs();
+        if(currTime > nextTransferTime+link->periodUs) {
+            nextTransferTime = currTime;
+        }
+        sleepUntilUs(nextTransferTime);
+        currTime = getTimeUs();
+
+        jitter = (currTime > nextTransferTime) ? (currTime-nextTransferTime) : 0;
+        setMutexThread(ctx);
+        ctx->jitterLastUs = (unsigned long)jitter;
+        if(ctx->jitterLastUs > ctx->jitterMaxUs) {
+            ctx->jitterMaxUs = ctx->jitterLastUs;
+        }
+        ctx->jitterSumUs += jitter;
+        ctx->jitterSamples++;
+        freeMutexThread(ctx);
+    }
+
+    while(usb_async_pending(link->device) > 0) {
+        completeExchangeAsync(link);
+    }
+    usb_stop_async(link->device);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+DWORD WINAPI CommThread( LPVOID lpParameter) {
+    commLoop((struct commLink*)lpParameter);
+    return 0;
+}
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+void *CommThread(void *arg) {
+    commLoop((struct commLink*)arg);
+    return NULL;
+}
+#endif
+
+// Original api: thin wrappers on the default context, for the applications driving a single swarm.
+
+void startCommunication(int *robotAddr, int numRobots) {
+    startContext(&defaultCtx, robotAddr, numRobots, 0, 0);
+}
+
+void stopCommunication() {
+    stopContext(&defaultCtx);
+}
+
+void setLeftSpeed(int robotAddr, char value) {
+    elisa3_setLeftSpeed(&defaultCtx, robotAddr, value);
+}
+
+void setRightSpeed(int robotAddr, char value) {
+    elisa3_setRightSpeed(&defaultCtx, robotAddr, value);
+}
+
+void setLeftSpeedForAll(char *value) {
+    elisa3_setLeftSpeedForAll(&defaultCtx, value);
+}
+
+void setRightSpeedForAll(char *value) {
+    elisa3_setRightSpeedForAll(&defaultCtx, value);
+}
+
+void setRed(int robotAddr, unsigned char value) {
+    elisa3_setRed(&defaultCtx, robotAddr, value);
+}
+
+void setGreen(int robotAddr, unsigned char value) {
+    elisa3_setGreen(&defaultCtx, robotAddr, value);
+}
+
+void setBlue(int robotAddr, unsigned char value) {
+    elisa3_setBlue(&defaultCtx, robotAddr, value);
+}
+
+void setRedForAll(unsigned char *value) {
+    elisa3_setRedForAll(&defaultCtx, value);
+}
+
+void setGreenForAll(unsigned char *value) {
+    elisa3_setGreenForAll(&defaultCtx, value);
+}
+
+void setBlueForAll(unsigned char *value) {
+    elisa3_setBlueForAll(&defaultCtx, value);
+}
+
+void turnOnFrontIRs(int robotAddr) {
+    elisa3_turnOnFrontIRs(&defaultCtx, robotAddr);
+}
+
+void turnOffFrontIRs(int robotAddr) {
+    elisa3_turnOffFrontIRs(&defaultCtx, robotAddr);
+}
+
+void turnOnBackIR(int robotAddr) {
+    elisa3_turnOnBackIR(&defaultCtx, robotAddr);
+}
+
+void turnOffBackIR(int robotAddr) {
+    elisa3_turnOffBackIR(&defaultCtx, robotAddr);
+}
+
+void turnOnAllIRs(int robotAddr) {
+    elisa3_turnOnAllIRs(&defaultCtx, robotAddr);
+}
+
+void turnOffAllIRs(int robotAddr) {
+    elisa3_turnOffAllIRs(&defaultCtx, robotAddr);
+}
+
+void enableTVRemote(int robotAddr) {
+    elisa3_enableTVRemote(&defaultCtx, robotAddr);
+}
+
+void disableTVRemote(int robotAddr) {
+    elisa3_disableTVRemote(&defaultCtx, robotAddr);
+}
+
+void enableSleep(int robotAddr) {
+    elisa3_enableSleep(&defaultCtx, robotAddr);
+}
+
+void disableSleep(int robotAddr) {
+    elisa3_disableSleep(&defaultCtx, robotAddr);
+}
+
+void calibrateSensors(int robotAddr) {
+    elisa3_calibrateSensors(&defaultCtx, robotAddr);
+}
+
+void calibrateSensorsForAll() {
+    elisa3_calibrateSensorsForAll(&defaultCtx);
+}
+
+void enableObstacleAvoidance(int robotAddr) {
+    elisa3_enableObstacleAvoidance(&defaultCtx, robotAddr);
+}
+
+void disableObstacleAvoidance(int robotAddr) {
+    elisa3_disableObstacleAvoidance(&defaultCtx, robotAddr);
+}
 
+void enableCliffAvoidance(int robotAddr) {
+    elisa3_enableCliffAvoidance(&defaultCtx, robotAddr);
+}
+
+void disableCliffAvoidance(int robotAddr) {
+    elisa3_disableCliffAvoidance(&defaultCtx, robotAddr);
+}
+
+void setRobotAddress(int robotIndex, int robotAddr) {
+    elisa3_setRobotAddress(&defaultCtx, robotIndex, robotAddr);
+}
+
+void setRobotAddresses(int *robotAddr, int numRobots) {
+    elisa3_setRobotAddresses(&defaultCtx, robotAddr, numRobots);
+}
+
+unsigned int getRosterEpoch() {
+    return elisa3_getRosterEpoch(&defaultCtx);
+}
+
+unsigned int getDataEpoch(int robotAddr) {
+    return elisa3_getDataEpoch(&defaultCtx, robotAddr);
+}
+
+unsigned int getProximity(int robotAddr, int proxId) {
+    return elisa3_getProximity(&defaultCtx, robotAddr, proxId);
+}
+
+unsigned int getProximityAmbient(int robotAddr, int proxId) {
+    return elisa3_getProximityAmbient(&defaultCtx, robotAddr, proxId);
+}
+
+unsigned int getGround(int robotAddr, int groundId) {
+    return elisa3_getGround(&defaultCtx, robotAddr, groundId);
+}
+
+unsigned int getGroundAmbient(int robotAddr, int groundId) {
+    return elisa3_getGroundAmbient(&defaultCtx, robotAddr, groundId);
+}
+
+void getAllProximity(int robotAddr, unsigned int* proxArr) {
+    elisa3_getAllProximity(&defaultCtx, robotAddr, proxArr);
+}
+
+void getAllProximityAmbient(int robotAddr, unsigned int* proxArr) {
+    elisa3_getAllProximityAmbient(&defaultCtx, robotAddr, proxArr);
+}
+
+void getAllGround(int robotAddr, unsigned int* groundArr) {
+    elisa3_getAllGround(&defaultCtx, robotAddr, groundArr);
+}
+
+void getAllGroundAmbient(int robotAddr, unsigned int* groundArr) {
+    elisa3_getAllGroundAmbient(&defaultCtx, robotAddr, groundArr);
+}
+
+void getAllProximityFromAll(unsigned int proxArr[][8]) {
+    elisa3_getAllProximityFromAll(&defaultCtx, proxArr);
+}
+
+void getAllProximityAmbientFromAll(unsigned int proxArr[][8]) {
+    elisa3_getAllProximityAmbientFromAll(&defaultCtx, proxArr);
+}
+
+void getAllGroundFromAll(unsigned int groundArr[][4]) {
+    elisa3_getAllGroundFromAll(&defaultCtx, groundArr);
+}
+
+void getAllGroundAmbientFromAll(unsigned int groundArr[][4]) {
+    elisa3_getAllGroundAmbientFromAll(&defaultCtx, groundArr);
+}
+
+void getSensors(int robotAddr, robotSensors *sensors) {
+    elisa3_getSensors(&defaultCtx, robotAddr, sensors);
+}
+
+void getSensorsFromAll(robotSensors *sensors) {
+    elisa3_getSensorsFromAll(&defaultCtx, sensors);
+}
+
+unsigned long long getUpdateTime(int robotAddr, int packetType) {
+    return elisa3_getUpdateTime(&defaultCtx, robotAddr, packetType);
+}
+
+unsigned int getUpdateCount(int robotAddr, int packetType) {
+    return elisa3_getUpdateCount(&defaultCtx, robotAddr, packetType);
+}
+
+unsigned long long getUpdateAge(int robotAddr, int packetType) {
+    return elisa3_getUpdateAge(&defaultCtx, robotAddr, packetType);
+}
+
+unsigned int getBatteryAdc(int robotAddr) {
+    return elisa3_getBatteryAdc(&defaultCtx, robotAddr);
+}
+
+unsigned int getBatteryPercent(int robotAddr) {
+    return elisa3_getBatteryPercent(&defaultCtx, robotAddr);
+}
+
+signed int getAccX(int robotAddr) {
+    return elisa3_getAccX(&defaultCtx, robotAddr);
+}
+
+signed int getAccY(int robotAddr) {
+    return elisa3_getAccY(&defaultCtx, robotAddr);
+}
+
+signed int getAccZ(int robotAddr) {
+    return elisa3_getAccZ(&defaultCtx, robotAddr);
+}
+
+unsigned char getSelector(int robotAddr) {
+    return elisa3_getSelector(&defaultCtx, robotAddr);
+}
+
+unsigned char getTVRemoteCommand(int robotAddr) {
+    return elisa3_getTVRemoteCommand(&defaultCtx, robotAddr);
+}
+
+void setSmallLed(int robotAddr, int ledId, int state) {
+    elisa3_setSmallLed(&defaultCtx, robotAddr, ledId, state);
+}
+
+void turnOffSmallLeds(int robotAddr) {
+    elisa3_turnOffSmallLeds(&defaultCtx, robotAddr);
+}
+
+void turnOnSmallLeds(int robotAddr) {
+    elisa3_turnOnSmallLeds(&defaultCtx, robotAddr);
+}
+
+signed int getOdomTheta(int robotAddr) {
+    return elisa3_getOdomTheta(&defaultCtx, robotAddr);
+}
+
+signed int getOdomXpos(int robotAddr) {
+    return elisa3_getOdomXpos(&defaultCtx, robotAddr);
+}
+
+signed int getOdomYpos(int robotAddr) {
+    return elisa3_getOdomYpos(&defaultCtx, robotAddr);
+}
+
+int getVerticalAngle(int robotAddr) {
+    return elisa3_getVerticalAngle(&defaultCtx, robotAddr);
+}
+
+void startOdometryCalibration(int robotAddr) {
+    elisa3_startOdometryCalibration(&defaultCtx, robotAddr);
+}
+
+void transferData() {
+    elisa3_transferData(&defaultCtx);
+}
+
+void stopTransferData() {
+    elisa3_stopTransferData(&defaultCtx);
+}
+
+void resumeTransferData() {
+    elisa3_resumeTransferData(&defaultCtx);
+}
+
+unsigned char robotIsCharging(int robotAddr) {
+    return elisa3_robotIsCharging(&defaultCtx, robotAddr);
+}
+
+unsigned char robotIsCharged(int robotAddr) {
+    return elisa3_robotIsCharged(&defaultCtx, robotAddr);
+}
+
+unsigned char buttonIsPressed(int robotAddr) {
+    return elisa3_buttonIsPressed(&defaultCtx, robotAddr);
+}
+
+void resetFlagTX(int robotAddr) {
+    elisa3_resetFlagTX(&defaultCtx, robotAddr);
+}
+
+unsigned char getFlagTX(int robotAddr, int flagInd) {
+    return elisa3_getFlagTX(&defaultCtx, robotAddr, flagInd);
+}
+
+unsigned char getFlagRX(int robotAddr) {
+    return elisa3_getFlagRX(&defaultCtx, robotAddr);
+}
+
+signed long int getLeftMotSteps(int robotAddr) {
+    return elisa3_getLeftMotSteps(&defaultCtx, robotAddr);
+}
+
+signed long int getRightMotSteps(int robotAddr) {
+    return elisa3_getRightMotSteps(&defaultCtx, robotAddr);
+}
+
+double getRFQuality(int robotAddr) {
+    return elisa3_getRFQuality(&defaultCtx, robotAddr);
+}
+
+void resetMessageIsSentFlag(int robotAddr) {
+    elisa3_resetMessageIsSentFlag(&defaultCtx, robotAddr);
+}
+
+unsigned char messageIsSent(int robotAddr) {
+    return elisa3_messageIsSent(&defaultCtx, robotAddr);
+}
+
+void setCompletePacket(int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds) {
+    elisa3_setCompletePacket(&defaultCtx, robotAddr, red, green, blue, flags, left, right, leds);
+}
+
+void setCompletePacketForAll(int *robotAddr, char *red, char *green, char *blue, char flags[][2], char *left, char *right, char *leds) {
+    elisa3_setCompletePacketForAll(&defaultCtx, robotAddr, red, green, blue, flags, left, right, leds);
+}
+
+unsigned char waitForUpdate(int robotAddr, unsigned long us) {
+    return elisa3_waitForUpdate(&defaultCtx, robotAddr, us);
+}
+
+unsigned char waitForMessageTransmission(int robotAddr, unsigned long us) {
+    return elisa3_waitForMessageTransmission(&defaultCtx, robotAddr, us);
+}
+
+int waitForUpdateGroup(int *robotAddr, int numRobots, unsigned long us, unsigned char *notUpdated) {
+    return elisa3_waitForUpdateGroup(&defaultCtx, robotAddr, numRobots, us, notUpdated);
+}
+
+robotCommand *getCommandFrame(int numRobots) {
+    return elisa3_getCommandFrame(&defaultCtx, numRobots);
+}
+
+int publishCommandFrame() {
+    return elisa3_publishCommandFrame(&defaultCtx);
+}
+
+int setCommandsForAll(const robotCommand *commands, int numRobots) {
+    return elisa3_setCommandsForAll(&defaultCtx, commands, numRobots);
+}
+
+unsigned char sendMessageToRobot(int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds, unsigned long us) {
+    return elisa3_sendMessageToRobot(&defaultCtx, robotAddr, red, green, blue, flags, left, right, leds, us);
+}
+
+signed int getGyroZ(int robotAddr) {
+    return elisa3_getGyroZ(&defaultCtx, robotAddr);
+}
+
+int getHeading(int robotAddr) {
+    return elisa3_getHeading(&defaultCtx, robotAddr);
+}
+
+void setTransferPeriod(unsigned long us) {
+    elisa3_setTransferPeriod(&defaultCtx, us);
+}
+
+unsigned long getTransferPeriod() {
+    return elisa3_getTransferPeriod(&defaultCtx);
+}
+
+void getTransferJitter(unsigned long *lastUs, unsigned long *meanUs, unsigned long *maxUs) {
+    elisa3_getTransferJitter(&defaultCtx, lastUs, meanUs, maxUs);
+}
+
+void resetTransferJitter() {
+    elisa3_resetTransferJitter(&defaultCtx);
+}
+
+void setAsyncTransfer(unsigned int depth) {
+    elisa3_setAsyncTransfer(&defaultCtx, depth);
+}
+
+unsigned int getAsyncTransfer() {
+    return elisa3_getAsyncTransfer(&defaultCtx);
+}
+
+int getNumBaseStations() {
+    return elisa3_getNumBaseStations(&defaultCtx);
+}
+
+void setAdaptiveTransfer(int enabled) {
+    elisa3_setAdaptiveTransfer(&defaultCtx, enabled);
+}
+
+unsigned long getAdaptivePeriod(int baseStation) {
+    return elisa3_getAdaptivePeriod(&defaultCtx, baseStation);
+}
+
+void setSlotScheduler(slotScheduler scheduler, void *userData) {
+    elisa3_setSlotScheduler(&defaultCtx, scheduler, userData);
+}
+
+void setUpdateRate(int robotAddr, double rateHz) {
+    elisa3_setUpdateRate(&defaultCtx, robotAddr, rateHz);
+}
+
+int subscribeSensors(int robotAddr, unsigned int packetTypes, sensorsCallback callback, void *userData) {
+    return elisa3_subscribeSensors(&defaultCtx, robotAddr, packetTypes, callback, userData);
+}
+
+void unsubscribeSensors(int subscription) {
+    elisa3_unsubscribeSensors(&defaultCtx, subscription);
+}
+
+sensorsRing* subscribeSensorsRing(int robotAddr, unsigned int packetTypes, unsigned int size) {
+    return elisa3_subscribeSensorsRing(&defaultCtx, robotAddr, packetTypes, size);
+}
+
+void unsubscribeSensorsRing(sensorsRing *ring) {
+    elisa3_unsubscribeSensorsRing(&defaultCtx, ring);
+}
+
+int scheduleCommands(int robotAddr, const timedCommand *commands, int numCommands) {
+    return elisa3_scheduleCommands(&defaultCtx, robotAddr, commands, numCommands);
+}
+
+void clearScheduledCommands(int robotAddr) {
+    elisa3_clearScheduledCommands(&defaultCtx, robotAddr);
+}
+
+int getScheduledCommands(int robotAddr) {
+    return elisa3_getScheduledCommands(&defaultCtx, robotAddr);
+}
+
+int getRFStats(int robotAddr, int window, unsigned int *counts) {
+    return elisa3_getRFStats(&defaultCtx, robotAddr, window, counts);
+}
+
+int getRobotLiveness(int robotAddr, unsigned int *failures) {
+    return elisa3_getRobotLiveness(&defaultCtx, robotAddr, failures);
+}
+
+void getLatencyStats(int baseStation, latencyHistogram *usb, latencyHistogram *ack) {
+    elisa3_getLatencyStats(&defaultCtx, baseStation, usb, ack);
+}
+
+int startRecorder(const char *path, unsigned int numRecords) {
+    return elisa3_startRecorder(&defaultCtx, path, numRecords);
+}
+
+void stopRecorder() {
+    elisa3_stopRecorder(&defaultCtx);
+}
+
+int startSharedExport(const char *name, unsigned int maxRobots) {
+    return elisa3_startSharedExport(&defaultCtx, name, maxRobots);
+}
+
+void stopSharedExport() {
+    elisa3_stopSharedExport(&defaultCtx);
+}
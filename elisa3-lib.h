@@ -3,6 +3,7 @@
 #include <math.h>
 #include <unistd.h>
 #include "usb-comm.h"
+#include "timing.h"
 
 #ifndef ELISA3_LIB_H_
 #define ELISA3_LIB_H_
@@ -11,11 +12,152 @@
 extern "C" {
 #endif
 
+// Types of the sensors packets sent by the robots (ack payload), each packet contains:
+#define RX_PACKET_PROX 0            // proximity 0..3 and 5..7, flags (charging, button)
+#define RX_PACKET_GROUND 1          // proximity 4, ground, accelerometer x and y, TV remote
+#define RX_PACKET_AMBIENT 2         // proximity ambient 0..3 and 5..7, selector
+#define RX_PACKET_GROUND_AMBIENT 3  // proximity ambient 4, ground ambient, accelerometer z, battery, heading
+#define RX_PACKET_ODOMETRY 4        // motors steps, odometry, gyroscope
+#define RX_PACKET_TYPES 5
+#define RX_PACKET_ALL ((1<<RX_PACKET_TYPES)-1)    // mask of all the packet types (see "subscribeSensors")
+
+#define ALL_ROBOTS -1   // subscription to the data of every robot
+
+// Outcomes of the exchanges with a robot (see "getRFStats"), from the code returned by the base-station
+#define RF_DATA 0       // ack received with sensors data
+#define RF_NO_ACK 1     // code 0: packet transmitted but no ack received
+#define RF_ACK 2        // code 1: ack received without data
+#define RF_FAILED 3     // code 2: transfer failed
+#define RF_OUTCOMES 4
+
+// Liveness of a robot (see "getRobotLiveness")
+#define ROBOT_ALIVE 0
+#define ROBOT_UNREACHABLE 1
+
+// Sliding windows of the RF statistics
+#define RF_WINDOW_1S 0
+#define RF_WINDOW_10S 1
+#define RF_WINDOW_60S 2
+
+#define LATENCY_BUCKETS 24  // latency histograms: bucket "k" counts the latencies from 2^k to 2^(k+1)-1 microseconds (bucket 0 from 0 to 1)
+
+// Parts of a timed command (see "scheduleCommands")
+#define COMMAND_SPEED 0x01  // left and right speed
+#define COMMAND_RGB 0x02    // red, green, blue
+#define COMMAND_FLAGS 0x04  // flags bytes
+#define COMMAND_LEDS 0x08   // small green leds
+#define COMMAND_ALL 0x0F
+
+/**
+ * \brief Sensors data of a robot, refer to the related "get" functions for the range of each value.
+ */
+typedef struct {
+    unsigned int proximity[8];
+    unsigned int proximityAmbient[8];
+    unsigned int ground[4];
+    unsigned int groundAmbient[4];
+    unsigned int batteryAdc;
+    signed int accX, accY, accZ;
+    signed int gyroZ;
+    unsigned char selector;
+    unsigned char tvRemoteCommand;
+    unsigned char flagRX;
+    signed long int leftMotSteps, rightMotSteps;
+    signed int odomTheta, odomXpos, odomYpos;
+    int heading;
+    unsigned long long updateTime[RX_PACKET_TYPES];  // time of the last update of each packet type (see "getUpdateTime")
+    unsigned int updateCount[RX_PACKET_TYPES];       // number of updates of each packet type (see "getUpdateCount")
+} robotSensors;
+
+/**
+ * \brief State of a robot given to the slots scheduler (see "setSlotScheduler"); times are monotonic microseconds as "getUpdateTime".
+ */
+typedef struct {
+    int robotAddr;
+    unsigned char txPending;            // 1 when the commands changed since the last packet sent to the robot
+    unsigned char padding;              // 1 for the entries that only complete the last packet (not part of the robots list)
+    unsigned char unreachable;          // 1 when the robot doesn't answer (see "getRobotLiveness"), to be sent only from "probeTime"
+    unsigned long long pendingSince;    // time the pending change was detected
+    unsigned long long lastTxTime;      // last packet sent to the robot, 0 if never
+    unsigned long long lastRxTime;      // last sensors data received from the robot, 0 if never
+    unsigned long updatePeriodUs;       // period set with "setUpdateRate", 0 if none
+    unsigned long long probeTime;       // unreachable robot: time of the next probe
+} slotCandidate;
+
+/**
+ * \brief Slots scheduler: choose the robots of the next packet among the candidates (the robots handled by the base-station).
+ * \param userData pointer given to "setSlotScheduler".
+ * \param candidates state of each candidate.
+ * \param numCandidates number of candidates, at least "numSlots".
+ * \param chosen destination for the indexes (in "candidates") of the robots chosen, all different.
+ * \param numSlots number of robots to choose (4).
+ * \param now current time.
+ * \return number of robots chosen; the slots left are filled by the library.
+ */
+typedef int (*slotScheduler)(void *userData, const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now);
+
+/**
+ * \brief Sensors data of a robot delivered to the subscribers (see "subscribeSensors") after the reception of a packet.
+ */
+typedef struct {
+    int robotAddr;
+    int packetType;         // packet received, from RX_PACKET_PROX to RX_PACKET_ODOMETRY
+    robotSensors sensors;   // all the sensors data of the robot once the packet is decoded
+} sensorsEvent;
+
+/**
+ * \brief Function called by the communication thread for each packet subscribed.
+ */
+typedef void (*sensorsCallback)(void *userData, const sensorsEvent *event);
+
+/**
+ * \brief Queue of sensors events filled by the communication threads and emptied by one consumer thread without locks (see "subscribeSensorsRing").
+ */
+typedef struct sensorsRing sensorsRing;
+
+/**
+ * \brief Command applied to a robot at a given time (see "scheduleCommands"); the values have the same meaning and range as in "setCompletePacket".
+ */
+typedef struct {
+    unsigned long long time;    // when to apply the command, monotonic time in microseconds (see "getTimeUs")
+    unsigned char fields;       // parts of the command to apply (COMMAND_SPEED, COMMAND_RGB, ...)
+    char left, right;
+    char red, green, blue;
+    char flags[2];
+    char leds;
+} timedCommand;
+
+/**
+ * \brief Commands of a robot in a frame of the whole swarm (see "getCommandFrame"), packed in 8 bytes; the values have the same
+ * meaning as in "setCompletePacket", they are saturated when the frame is published (speeds to -127..127, rgb to 0..100).
+ */
+typedef struct {
+    signed char left, right;
+    unsigned char red, green, blue;
+    unsigned char flags[2];
+    unsigned char leds;
+} robotCommand;
+
+/**
+ * \brief Latency histogram (see "getLatencyStats"), counted since the start of the communication.
+ */
+typedef struct {
+    unsigned long long count[LATENCY_BUCKETS];
+    unsigned long long samples;
+    unsigned long long maxUs;
+} latencyHistogram;
+
 /**
- * \brief To be called once at the beginning, it init the USB communication with the RF module that is responsible to send data to the robots and initialize the list of robots to be controlled; max number of simultaneous robots is 100.
+ * \brief Opaque handle of a swarm: robots table, base-stations, communication threads and statistics.
+ * Several contexts can be used in the same process, each one driving its own base-stations.
+ */
+typedef struct elisa3_ctx elisa3_ctx;
+
+/**
+ * \brief To be called once at the beginning, it init the USB communication with the RF module that is responsible to send data to the robots and initialize the list of robots to be controlled; the robots table is allocated for the number of robots given (max 65535).
  * \param robotAddr array list of robot addresses to be handled.
  * \param numRobots the array size (number of robots to handle).
- * \return none
+ * \return none; the communication isn't started when no base-station is available (a message is printed).
  */
 void startCommunication(int *robotAddr, int numRobots);
 
@@ -213,6 +355,8 @@ void disableCliffAvoidance(int robotAddr);
 
 /**
  * \brief Set the address of a robot related to a particular index, the index must be in the range of the robot list size.
+ * The function doesn't wait for the robot: the commands and the sensors of the new robot start cleared and its sensors are
+ * valid once "getDataEpoch" returns a value different from 0. It starts a new roster epoch (see "getRosterEpoch").
  * \param robotIndex from 0 to number of robots - 1 (set with "setRobotAddresses" function)
  * \param robotAddr the address of the robot
  * \return none
@@ -220,13 +364,30 @@ void disableCliffAvoidance(int robotAddr);
 void setRobotAddress(int robotIndex, int robotAddr);
 
 /**
- * \brief Set the addresses of the robots that need to be controlled; max number of simultaneous robots is 100.
+ * \brief Set the addresses of the robots that need to be controlled; the robots table grows if needed (max 65535 robots), the call is ignored if the number of robots is out of range.
+ * The function doesn't wait for the robots, the communication threads switch to the new list before their next packet; the robots
+ * kept at the same index keep their commands and sensors, the others start cleared and their sensors are valid once "getDataEpoch"
+ * returns a value different from 0. It starts a new roster epoch (see "getRosterEpoch").
  * \param robotAddr array list of robot addresses to be handled.
  * \param numRobots the array size (number of robots to handle).
  * \return none
  */
 void setRobotAddresses(int *robotAddr, int numRobots);
 
+/**
+ * \brief Request the roster epoch, incremented at each change of the robots list ("setRobotAddress(es)").
+ * \return current epoch (1 once the communication is started).
+ */
+unsigned int getRosterEpoch();
+
+/**
+ * \brief Request since when the sensors data of a robot are valid: the roster epoch at which the first packet of the robot was
+ * received since it is in the list, to be used instead of waiting after a change of the robots list.
+ * \param robotAddr address of the robot.
+ * \return roster epoch of the first data received, 0 if no data received yet (or the robot isn't in the list).
+ */
+unsigned int getDataEpoch(int robotAddr);
+
 /**
  * \brief Request one of the proximity sensors value of the robot.
  * \param robotAddr the address of the robot from which receive data.
@@ -319,6 +480,45 @@ void getAllGroundFromAll(unsigned int groundArr[][4]);
  */
 void getAllGroundAmbientFromAll(unsigned int groundArr[][4]);
 
+/**
+ * \brief Request all the sensors values of the robot at once; the values are consistent, that is they are never partially updated by the communication thread during the copy.
+ * \param robotAddr the address of the robot from which receive data.
+ * \param sensors destination for the sensors values.
+ * \return none
+ */
+void getSensors(int robotAddr, robotSensors *sensors);
+
+/**
+ * \brief Request all the sensors values of all the robots specified in the list at once; the values of the whole swarm are consistent (taken between two exchanges with the base-station).
+ * \param sensors destination array for the sensors values (size must be list_size).
+ * \return none
+ */
+void getSensorsFromAll(robotSensors *sensors);
+
+/**
+ * \brief Request when a sensors packet was last received from the robot.
+ * \param robotAddr the address of the robot from which receive data.
+ * \param packetType from RX_PACKET_PROX to RX_PACKET_ODOMETRY.
+ * \return reception time in microseconds, same monotonic clock as "getTimeUs"; 0 if never received.
+ */
+unsigned long long getUpdateTime(int robotAddr, int packetType);
+
+/**
+ * \brief Request how many sensors packets of a type were received from the robot; it can be used to detect new data.
+ * \param robotAddr the address of the robot from which receive data.
+ * \param packetType from RX_PACKET_PROX to RX_PACKET_ODOMETRY.
+ * \return number of packets received.
+ */
+unsigned int getUpdateCount(int robotAddr, int packetType);
+
+/**
+ * \brief Request how old are the data of a sensors packet received from the robot.
+ * \param robotAddr the address of the robot from which receive data.
+ * \param packetType from RX_PACKET_PROX to RX_PACKET_ODOMETRY.
+ * \return time elapsed since the reception in microseconds, the maximum value if never received.
+ */
+unsigned long long getUpdateAge(int robotAddr, int packetType);
+
 /**
  * \brief Request the raw battery value, it contains the sampled value of the battery.
  * \param robotAddr the address of the robot from which receive data.
@@ -502,9 +702,9 @@ signed long int getLeftMotSteps(int robotAddr);
 signed long int getRightMotSteps(int robotAddr);
 
 /**
- * \brief Request the current percentage of failed transfers in the last 5 seconds.
+ * \brief Request the percentage of the exchanges with the robot answered with sensors data in the last 10 complete seconds (see "getRFStats").
  * \param robotAddr the address of the robot from which receive data.
- * \return current quality, 0 to 100.
+ * \return current quality, 0 to 100 (0 if the robot wasn't heard in the window), -1 if the robot isn't in the list.
  */
 double getRFQuality(int robotAddr);
 
@@ -523,7 +723,7 @@ void resetMessageIsSentFlag(int robotAddr);
 unsigned char messageIsSent(int robotAddr);
 
 /**
- * \brief Wait for the message to be actually sent to the robot; if the robot isn't reachable (out of range, discharged, ...) then the function will exit after the amount of time specified as parameter even if the robot doesn't receive the data.
+ * \brief Wait for the message to be actually sent to the robot; if the robot isn't reachable (out of range, discharged, ...) then the function will exit after the amount of time specified as parameter even if the robot doesn't receive the data. The calling thread sleeps meanwhile and is woken up as soon as the robot acknowledges the message.
  * \param robotAddr the address of the robot for which to change data.
  * \param us function timeout given in microseconds
  * \return 0 if message sent, 1 otherwise.
@@ -581,13 +781,52 @@ void setCompletePacket(int robotAddr, char red, char green, char blue, char flag
 void setCompletePacketForAll(int *robotAddr, char *red, char *green, char *blue, char flags[][2], char *left, char *right, char *leds);
 
 /**
- * \brief Wait for updated data coming from the robot; if the robot isn't reachable (out of range, discharged, ...) then the function will exit after the amount of time specified as parameter even if no data are received. this function can be used also to check whether a message is successfully sent to a robot or not.
+ * \brief Get the frame to fill with the commands of the whole swarm, one record for each robot of the list (in the order of
+ * "setRobotAddresses"); the frame is owned by the caller until "publishCommandFrame", its initial content is undefined thus
+ * all the records must be filled. The frames are exchanged with the communication threads without locks, they must be
+ * filled and published by one thread at a time.
+ * \param numRobots number of records to fill (the robots beyond the list are ignored when the frame is applied).
+ * \return the records to fill, NULL if the frame cannot be allocated.
+ */
+robotCommand *getCommandFrame(int numRobots);
+
+/**
+ * \brief Publish the frame filled after "getCommandFrame": the values are saturated and the frame is handed over to the
+ * communication threads with a single pointer exchange; the next packet built applies the whole frame at once, thus the
+ * robots never get a mix of two frames. A frame not yet applied is replaced by the new one.
+ * \return 0 on success, -1 if no frame was taken with "getCommandFrame".
+ */
+int publishCommandFrame();
+
+/**
+ * \brief Copy the commands of the robots in a frame and publish it (see "publishCommandFrame"), the array isn't modified.
+ * \param commands the commands of each robot of the list.
+ * \param numRobots number of records.
+ * \return 0 on success, -1 if the frame cannot be allocated.
+ */
+int setCommandsForAll(const robotCommand *commands, int numRobots);
+
+/**
+ * \brief Wait for updated data coming from the robot; if the robot isn't reachable (out of range, discharged, ...) then the function will exit after the amount of time specified as parameter even if no data are received. this function can be used also to check whether a message is successfully sent to a robot or not. The calling thread sleeps meanwhile and is woken up as soon as the robot acknowledges the message.
  * \param robotAddr the address of the robot from which receive data.
  * \param us function timeout given in microseconds
  * \return 0 if updated data received, 1 otherwise.
  */
 unsigned char waitForUpdate(int robotAddr, unsigned long us);
 
+/**
+ * \brief Wait for updated data coming from a group of robots, e.g. to be sure that all of them received their new commands
+ * before starting an experiment; the function returns as soon as all the robots acknowledged or when the timeout elapsed,
+ * thus the total wait is at most the timeout whatever the number of robots. The robots not in the list are ignored.
+ * \param robotAddr addresses of the robots.
+ * \param numRobots number of addresses.
+ * \param us function timeout given in microseconds.
+ * \param notUpdated destination for the result of each robot (1 if no updated data received, 0 otherwise), NULL if not needed.
+ * \return number of robots from which no updated data were received, 0 if all of them are updated, -1 if called from a
+ * callback (see "subscribeSensors").
+ */
+int waitForUpdateGroup(int *robotAddr, int numRobots, unsigned long us, unsigned char *notUpdated);
+
 /**
  * \brief Send a message to a particular robot resetting the list of robots to a single one (all previous address set with "startCommunication" will be lost).
  * \param robotAddr the address of the robot for which to change data.
@@ -628,6 +867,399 @@ signed int getGyroZ(int robotAddr);
  */
 int getHeading(int robotAddr);
 
+/**
+ * \brief Set the period of the exchanges with the base-station; the communication thread sleeps until the next absolute deadline (no busy waiting). Default is 4000 us (250 Hz).
+ * \param us period given in microseconds (0 is ignored).
+ * \return none
+ */
+void setTransferPeriod(unsigned long us);
+
+/**
+ * \brief Request the current period of the exchanges with the base-station.
+ * \return current period in microseconds.
+ */
+unsigned long getTransferPeriod();
+
+/**
+ * \brief Request the scheduling jitter of the communication thread, that is how late it woke up with respect to the expected deadline; statistics are accumulated since the start or the last call to "resetTransferJitter".
+ * \param lastUs destination for the jitter of the last exchange (microseconds).
+ * \param meanUs destination for the mean jitter (microseconds).
+ * \param maxUs destination for the maximum jitter (microseconds).
+ * \return none
+ */
+void getTransferJitter(unsigned long *lastUs, unsigned long *meanUs, unsigned long *maxUs);
+
+/**
+ * \brief Reset the jitter statistics returned by "getTransferJitter".
+ * \return none
+ */
+void resetTransferJitter();
+
+/**
+ * \brief Select the usb transport: with "depth" greater than 0 up to "depth" exchanges with the base-station are queued at the same time (asynchronous transfers completed by a dedicated thread), thus the next packet is prepared while the previous ones are still in flight; with 0 each exchange is completed before starting the next one (default). The change is applied by the communication thread at the next exchange.
+ * \param depth number of exchanges in flight, from 0 to 8.
+ * \return none
+ */
+void setAsyncTransfer(unsigned int depth);
+
+/**
+ * \brief Request the number of exchanges in flight currently used by the usb transport (0 when the blocking transport is used).
+ * \return current depth.
+ */
+unsigned int getAsyncTransfer();
+
+/**
+ * \brief Enable the adaptive pacing of the exchanges: each base-station measures how long its exchanges take (the usb
+ * transfer blocks until the base-station has exchanged the packet with the robots) and runs as fast as it sustains,
+ * from 250 us to 50 ms between two packets; the period is reduced step by step while the exchanges succeed and doubled
+ * when one fails (usb error or short transfer). When disabled (default) the period given to "setTransferPeriod" is used.
+ * \param enabled 1 to enable, 0 to disable.
+ * \return none
+ */
+void setAdaptiveTransfer(int enabled);
+
+/**
+ * \brief Request the period currently used by a base-station, with the adaptive pacing the one it converged on.
+ * \param baseStation index of the base-station (see "getNumBaseStations").
+ * \return period in microseconds, 0 if the base-station isn't used.
+ */
+unsigned long getAdaptivePeriod(int baseStation);
+
+/**
+ * \brief Return the number of base-stations used for the communication; all the base-stations connected are opened by
+ * "startCommunication" and each one is handled by its own thread, the groups of 4 robots (in the order given to
+ * "startCommunication") are assigned to the base-stations in round-robin so that the refresh rate of each robot is
+ * multiplied by the number of base-stations. Each base-station should be configured (firmware) on a different radio channel.
+ * \return number of base-stations (at least 1 once the communication is started).
+ */
+int getNumBaseStations();
+
+/**
+ * \brief Set the function that chooses the 4 robots of each packet sent to a base-station; it is called by the
+ * communication threads, with the robots commands locked, thus it must be quick and must not call the library.
+ * The default is "schedulePriority".
+ * \param scheduler scheduler to use, NULL for the default one.
+ * \param userData pointer passed to the scheduler.
+ * \return none
+ */
+void setSlotScheduler(slotScheduler scheduler, void *userData);
+
+/**
+ * \brief Set the update rate wanted for a robot: the robot isn't sent a new packet before the period elapsed unless its
+ * commands change or there are free slots, and it gets priority over the others when it is late. Without a rate the
+ * robots are updated as often as possible. The rate of a robot is cleared when it is replaced in the robots list ("setRobotAddress(es)").
+ * \param robotAddr robot address.
+ * \param rateHz packets per second, 0 to remove the rate.
+ * \return none
+ */
+void setUpdateRate(int robotAddr, double rateHz);
+
+/**
+ * \brief Priority scheduler (default): first the robots late (not updated for twice their period, or one second when they
+ * have no rate), then the robots whose commands changed, the oldest change first, then the robots due by rate, the
+ * least recently updated first (a failed exchange counts as older), then the others. The idle robots thus give their
+ * slots to the robots being commanded.
+ */
+int schedulePriority(void *userData, const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now);
+
+/**
+ * \brief Round-robin scheduler: the least recently updated robots first, all the robots get the same update rate.
+ */
+int scheduleRoundRobin(void *userData, const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now);
+
+/**
+ * \brief Request the outcomes of the exchanges with a robot in a sliding window: the last complete second, the last 10
+ * complete seconds or the last 6 complete tens of seconds. The counters are updated at each packet and read without locks,
+ * e.g. to spot a failing robot while the experiment is running.
+ * \param robotAddr address of the robot.
+ * \param window RF_WINDOW_1S, RF_WINDOW_10S or RF_WINDOW_60S.
+ * \param counts destination for the number of exchanges of each outcome (RF_OUTCOMES values, indexed by RF_DATA, RF_NO_ACK, RF_ACK, RF_FAILED).
+ * \return 0 on success, -1 if the robot isn't in the list or the window is wrong.
+ */
+int getRFStats(int robotAddr, int window, unsigned int *counts);
+
+/**
+ * \brief Request the liveness of a robot: after 20 consecutive failed exchanges (code 0, 1 or 2 from the base-station, that
+ * is no data received; the usb errors of the base-station itself aren't counted) the robot is unreachable, e.g. switched
+ * off; its slot then goes to the robots that answer and it is only probed, first after 50 ms and then with an interval
+ * doubling at each probe failed (up to 2 s). The first ack received makes it alive again.
+ * \param robotAddr address of the robot.
+ * \param failures destination for the number of consecutive failed exchanges, NULL if not needed.
+ * \return ROBOT_ALIVE or ROBOT_UNREACHABLE, -1 if the robot isn't in the list.
+ */
+int getRobotLiveness(int robotAddr, unsigned int *failures);
+
+/**
+ * \brief Request the latency histograms, read without locks: the usb round-trip of the exchanges with the base-station and the
+ * end-to-end latency of the commands, from the change of the commands of a robot (setter or timed command) to the reception of
+ * the ack of a packet carrying them.
+ * \param baseStation index of the base-station (see "getNumBaseStations"), -1 for all of them.
+ * \param usb destination for the usb round-trip histogram, NULL if not needed.
+ * \param ack destination for the commands latency histogram, NULL if not needed.
+ * \return none
+ */
+void getLatencyStats(int baseStation, latencyHistogram *usb, latencyHistogram *ack);
+
+/**
+ * \brief Record every exchange with the base-stations (packet sent, packet received, robots addresses, usb error and
+ * times) in a file mapped in memory and used as a ring, thus the file holds the last "numRecords" exchanges; the format
+ * is described in "flight-recorder.h". The file is allocated at once, the recording costs a copy in memory for each
+ * exchange. A recording in progress is stopped first.
+ * \param path file to create (overwritten if it exists).
+ * \param numRecords number of exchanges kept (about 200 bytes each), e.g. 250 exchanges per second for each base-station.
+ * \return 0 on success, -1 if the file cannot be created.
+ */
+int startRecorder(const char *path, unsigned int numRecords);
+
+/**
+ * \brief Stop the recording and close the file.
+ * \return none
+ */
+void stopRecorder();
+
+/**
+ * \brief Publish the state of the swarm in a named shared-memory segment, so that other processes (visualizer, logger...)
+ * see it without going through this one: the sensors, the liveness and the roster epoch of each robot and the statistics
+ * of each base-station, updated at each exchange. The layout, versioned, and the functions to map and read the segment
+ * from another process ("exportAttach", "exportReadRobot"...) are in "shared-export.h"; each record is protected by a
+ * sequence counter, a reader copies it from the mapping without system calls. An export in progress is stopped first.
+ * \param name name of the segment, on Linux / Mac OS X it starts with "/" (e.g. "/elisa3"), on Windows it is the name of
+ * the file mapping (e.g. "Local\\elisa3"); a segment with the same name is replaced (on Windows it is an error while
+ * another process still has it open).
+ * \param maxRobots number of robot records, the robots of the list beyond them aren't exported.
+ * \return 0 on success, -1 if the segment cannot be created.
+ */
+int startSharedExport(const char *name, unsigned int maxRobots);
+
+/**
+ * \brief Stop the export and remove the segment name, the processes that mapped it keep their mapping (it is then marked
+ * inactive).
+ * \return none
+ */
+void stopSharedExport();
+
+/**
+ * \brief Queue commands to be applied to a robot in the future, e.g. a whole choreography: the communication thread
+ * applies each command once its time is reached, right before building the packet of the robot, thus the timing is
+ * as accurate as the transfers and the application doesn't need to wake up at each step. The commands are applied in
+ * the order they are queued (their times should be increasing), the setters can still be used meanwhile. The queue of
+ * a robot must be filled by one thread at a time; it holds 1024 commands and is emptied when the robots list changes.
+ * \param robotAddr address of the robot.
+ * \param commands commands to queue.
+ * \param numCommands number of commands.
+ * \return number of commands queued (less than "numCommands" when the queue is full), -1 if the robot isn't in the list.
+ */
+int scheduleCommands(int robotAddr, const timedCommand *commands, int numCommands);
+
+/**
+ * \brief Drop the commands of a robot not yet applied.
+ * \param robotAddr address of the robot.
+ * \return none
+ */
+void clearScheduledCommands(int robotAddr);
+
+/**
+ * \brief Request the number of commands of a robot not yet applied.
+ * \param robotAddr address of the robot.
+ * \return commands in the queue, -1 if the robot isn't in the list.
+ */
+int getScheduledCommands(int robotAddr);
+
+/**
+ * \brief Register a function called by the communication threads right after a packet of the robot is decoded, thus the
+ * application is notified of new data without polling the getters. The callbacks of a context are never called
+ * concurrently; they should be quick since the communication thread waits for them. They can call the setters, the getters
+ * and the subscription functions (including "unsubscribeSensors"), but not the functions waiting for the robots
+ * ("waitForUpdate", "waitForUpdateGroup", "waitForMessageTransmission": the acks are decoded by the thread running the
+ * callback, these functions return at once reporting the robots as not updated) nor "stopCommunication". To be used once the
+ * communication is started.
+ * \param robotAddr address of the robot, ALL_ROBOTS for every robot.
+ * \param packetTypes mask of the packets of interest: (1<<RX_PACKET_PROX), ..., RX_PACKET_ALL for all the packets.
+ * \param callback function to call.
+ * \param userData pointer passed to the callback.
+ * \return subscription id, -1 if no more subscriptions are available.
+ */
+int subscribeSensors(int robotAddr, unsigned int packetTypes, sensorsCallback callback, void *userData);
+
+/**
+ * \brief Remove a subscription; once the function returns the callback isn't called anymore.
+ * \param subscription id returned by "subscribeSensors".
+ * \return none
+ */
+void unsubscribeSensors(int subscription);
+
+/**
+ * \brief Create a queue that receives the sensors events of the robot, to be emptied with "popSensorsEvent" by a single
+ * thread: the communication threads never wait for the consumer, when the queue is full the new events are dropped
+ * (see "getSensorsEventsLost").
+ * \param robotAddr address of the robot, ALL_ROBOTS for every robot.
+ * \param packetTypes mask of the packets of interest (see "subscribeSensors").
+ * \param size number of events the queue can hold (rounded up to a power of 2).
+ * \return the queue, NULL if it cannot be allocated or no more subscriptions are available.
+ */
+sensorsRing* subscribeSensorsRing(int robotAddr, unsigned int packetTypes, unsigned int size);
+
+/**
+ * \brief Remove the subscription of a queue and free it.
+ * \param ring queue returned by "subscribeSensorsRing".
+ * \return none
+ */
+void unsubscribeSensorsRing(sensorsRing *ring);
+
+/**
+ * \brief Take the oldest event of a queue, without blocking.
+ * \param ring queue returned by "subscribeSensorsRing".
+ * \param event destination for the event.
+ * \return 1 if an event is returned, 0 if the queue is empty.
+ */
+int popSensorsEvent(sensorsRing *ring, sensorsEvent *event);
+
+/**
+ * \brief Number of events dropped because the queue was full.
+ * \param ring queue returned by "subscribeSensorsRing".
+ * \return events lost since the queue was created.
+ */
+unsigned long getSensorsEventsLost(sensorsRing *ring);
+
+/**
+ * \brief Open the communication with the robots through the base-stations given and start the communication threads of a new context.
+ * \param robotAddr pointer to the list of robots addresses.
+ * \param numRobots number of robots (max is 65535).
+ * \param firstBaseStation index of the first base-station to use (0 for the first one connected).
+ * \param numBaseStations number of base-stations to use starting from "firstBaseStation", 0 to use all the ones that aren't
+ * already used by another context. A base-station is driven by only one context at a time.
+ * \return the context to pass to the "elisa3_" functions, NULL if it cannot be allocated or if none of the base-stations requested is available.
+ */
+elisa3_ctx* elisa3_startCommunication(int *robotAddr, int numRobots, int firstBaseStation, int numBaseStations);
+
+/**
+ * \brief Stop the communication threads of the context, release its base-stations and free it.
+ * \param ctx context returned by "elisa3_startCommunication".
+ * \return none
+ */
+void elisa3_stopCommunication(elisa3_ctx *ctx);
+
+/**
+ * \name Context api
+ * Each function of the library is available with the "elisa3_" prefix and the context as first parameter; the
+ * behavior is the same as the function without prefix, which operates on the default context
+ * (the one started by "startCommunication").
+ * @{
+ */
+void elisa3_setLeftSpeed(elisa3_ctx *ctx, int robotAddr, char value);
+void elisa3_setRightSpeed(elisa3_ctx *ctx, int robotAddr, char value);
+void elisa3_setLeftSpeedForAll(elisa3_ctx *ctx, char *value);
+void elisa3_setRightSpeedForAll(elisa3_ctx *ctx, char *value);
+void elisa3_setRed(elisa3_ctx *ctx, int robotAddr, unsigned char value);
+void elisa3_setGreen(elisa3_ctx *ctx, int robotAddr, unsigned char value);
+void elisa3_setBlue(elisa3_ctx *ctx, int robotAddr, unsigned char value);
+void elisa3_setRedForAll(elisa3_ctx *ctx, unsigned char *value);
+void elisa3_setGreenForAll(elisa3_ctx *ctx, unsigned char *value);
+void elisa3_setBlueForAll(elisa3_ctx *ctx, unsigned char *value);
+void elisa3_turnOnFrontIRs(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOffFrontIRs(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOnBackIR(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOffBackIR(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOnAllIRs(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOffAllIRs(elisa3_ctx *ctx, int robotAddr);
+void elisa3_enableTVRemote(elisa3_ctx *ctx, int robotAddr);
+void elisa3_disableTVRemote(elisa3_ctx *ctx, int robotAddr);
+void elisa3_enableSleep(elisa3_ctx *ctx, int robotAddr);
+void elisa3_disableSleep(elisa3_ctx *ctx, int robotAddr);
+void elisa3_calibrateSensors(elisa3_ctx *ctx, int robotAddr);
+void elisa3_calibrateSensorsForAll(elisa3_ctx *ctx);
+void elisa3_enableObstacleAvoidance(elisa3_ctx *ctx, int robotAddr);
+void elisa3_disableObstacleAvoidance(elisa3_ctx *ctx, int robotAddr);
+void elisa3_enableCliffAvoidance(elisa3_ctx *ctx, int robotAddr);
+void elisa3_disableCliffAvoidance(elisa3_ctx *ctx, int robotAddr);
+void elisa3_setRobotAddress(elisa3_ctx *ctx, int robotIndex, int robotAddr);
+void elisa3_setRobotAddresses(elisa3_ctx *ctx, int *robotAddr, int numRobots);
+unsigned int elisa3_getRosterEpoch(elisa3_ctx *ctx);
+unsigned int elisa3_getDataEpoch(elisa3_ctx *ctx, int robotAddr);
+unsigned int elisa3_getProximity(elisa3_ctx *ctx, int robotAddr, int proxId);
+unsigned int elisa3_getProximityAmbient(elisa3_ctx *ctx, int robotAddr, int proxId);
+unsigned int elisa3_getGround(elisa3_ctx *ctx, int robotAddr, int groundId);
+unsigned int elisa3_getGroundAmbient(elisa3_ctx *ctx, int robotAddr, int groundId);
+void elisa3_getAllProximity(elisa3_ctx *ctx, int robotAddr, unsigned int* proxArr);
+void elisa3_getAllProximityAmbient(elisa3_ctx *ctx, int robotAddr, unsigned int* proxArr);
+void elisa3_getAllGround(elisa3_ctx *ctx, int robotAddr, unsigned int* groundArr);
+void elisa3_getAllGroundAmbient(elisa3_ctx *ctx, int robotAddr, unsigned int* groundArr);
+void elisa3_getAllProximityFromAll(elisa3_ctx *ctx, unsigned int proxArr[][8]);
+void elisa3_getAllProximityAmbientFromAll(elisa3_ctx *ctx, unsigned int proxArr[][8]);
+void elisa3_getAllGroundFromAll(elisa3_ctx *ctx, unsigned int groundArr[][4]);
+void elisa3_getAllGroundAmbientFromAll(elisa3_ctx *ctx, unsigned int groundArr[][4]);
+void elisa3_getSensors(elisa3_ctx *ctx, int robotAddr, robotSensors *sensors);
+void elisa3_getSensorsFromAll(elisa3_ctx *ctx, robotSensors *sensors);
+unsigned long long elisa3_getUpdateTime(elisa3_ctx *ctx, int robotAddr, int packetType);
+unsigned int elisa3_getUpdateCount(elisa3_ctx *ctx, int robotAddr, int packetType);
+unsigned long long elisa3_getUpdateAge(elisa3_ctx *ctx, int robotAddr, int packetType);
+unsigned int elisa3_getBatteryAdc(elisa3_ctx *ctx, int robotAddr);
+unsigned int elisa3_getBatteryPercent(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getAccX(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getAccY(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getAccZ(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_getSelector(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_getTVRemoteCommand(elisa3_ctx *ctx, int robotAddr);
+void elisa3_setSmallLed(elisa3_ctx *ctx, int robotAddr, int ledId, int state);
+void elisa3_turnOffSmallLeds(elisa3_ctx *ctx, int robotAddr);
+void elisa3_turnOnSmallLeds(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getOdomTheta(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getOdomXpos(elisa3_ctx *ctx, int robotAddr);
+signed int elisa3_getOdomYpos(elisa3_ctx *ctx, int robotAddr);
+int elisa3_getVerticalAngle(elisa3_ctx *ctx, int robotAddr);
+void elisa3_startOdometryCalibration(elisa3_ctx *ctx, int robotAddr);
+void elisa3_transferData(elisa3_ctx *ctx);
+void elisa3_stopTransferData(elisa3_ctx *ctx);
+void elisa3_resumeTransferData(elisa3_ctx *ctx);
+unsigned char elisa3_robotIsCharging(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_robotIsCharged(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_buttonIsPressed(elisa3_ctx *ctx, int robotAddr);
+void elisa3_resetFlagTX(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_getFlagTX(elisa3_ctx *ctx, int robotAddr, int flagInd);
+unsigned char elisa3_getFlagRX(elisa3_ctx *ctx, int robotAddr);
+signed long int elisa3_getLeftMotSteps(elisa3_ctx *ctx, int robotAddr);
+signed long int elisa3_getRightMotSteps(elisa3_ctx *ctx, int robotAddr);
+double elisa3_getRFQuality(elisa3_ctx *ctx, int robotAddr);
+void elisa3_resetMessageIsSentFlag(elisa3_ctx *ctx, int robotAddr);
+unsigned char elisa3_messageIsSent(elisa3_ctx *ctx, int robotAddr);
+void elisa3_setCompletePacket(elisa3_ctx *ctx, int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds);
+void elisa3_setCompletePacketForAll(elisa3_ctx *ctx, int *robotAddr, char *red, char *green, char *blue, char flags[][2], char *left, char *right, char *leds);
+robotCommand *elisa3_getCommandFrame(elisa3_ctx *ctx, int numRobots);
+int elisa3_publishCommandFrame(elisa3_ctx *ctx);
+int elisa3_setCommandsForAll(elisa3_ctx *ctx, const robotCommand *commands, int numRobots);
+unsigned char elisa3_waitForUpdate(elisa3_ctx *ctx, int robotAddr, unsigned long us);
+unsigned char elisa3_waitForMessageTransmission(elisa3_ctx *ctx, int robotAddr, unsigned long us);
+int elisa3_waitForUpdateGroup(elisa3_ctx *ctx, int *robotAddr, int numRobots, unsigned long us, unsigned char *notUpdated);
+unsigned char elisa3_sendMessageToRobot(elisa3_ctx *ctx, int robotAddr, char red, char green, char blue, char flags[2], char left, char right, char leds, unsigned long us);
+signed int elisa3_getGyroZ(elisa3_ctx *ctx, int robotAddr);
+int elisa3_getHeading(elisa3_ctx *ctx, int robotAddr);
+void elisa3_setTransferPeriod(elisa3_ctx *ctx, unsigned long us);
+unsigned long elisa3_getTransferPeriod(elisa3_ctx *ctx);
+void elisa3_getTransferJitter(elisa3_ctx *ctx, unsigned long *lastUs, unsigned long *meanUs, unsigned long *maxUs);
+void elisa3_resetTransferJitter(elisa3_ctx *ctx);
+void elisa3_setAsyncTransfer(elisa3_ctx *ctx, unsigned int depth);
+unsigned int elisa3_getAsyncTransfer(elisa3_ctx *ctx);
+void elisa3_setAdaptiveTransfer(elisa3_ctx *ctx, int enabled);
+unsigned long elisa3_getAdaptivePeriod(elisa3_ctx *ctx, int baseStation);
+int elisa3_getNumBaseStations(elisa3_ctx *ctx);
+void elisa3_setSlotScheduler(elisa3_ctx *ctx, slotScheduler scheduler, void *userData);
+void elisa3_setUpdateRate(elisa3_ctx *ctx, int robotAddr, double rateHz);
+int elisa3_getRFStats(elisa3_ctx *ctx, int robotAddr, int window, unsigned int *counts);
+int elisa3_getRobotLiveness(elisa3_ctx *ctx, int robotAddr, unsigned int *failures);
+void elisa3_getLatencyStats(elisa3_ctx *ctx, int baseStation, latencyHistogram *usb, latencyHistogram *ack);
+int elisa3_startRecorder(elisa3_ctx *ctx, const char *path, unsigned int numRecords);
+void elisa3_stopRecorder(elisa3_ctx *ctx);
+int elisa3_startSharedExport(elisa3_ctx *ctx, const char *name, unsigned int maxRobots);
+void elisa3_stopSharedExport(elisa3_ctx *ctx);
+int elisa3_scheduleCommands(elisa3_ctx *ctx, int robotAddr, const timedCommand *commands, int numCommands);
+void elisa3_clearScheduledCommands(elisa3_ctx *ctx, int robotAddr);
+int elisa3_getScheduledCommands(elisa3_ctx *ctx, int robotAddr);
+int elisa3_subscribeSensors(elisa3_ctx *ctx, int robotAddr, unsigned int packetTypes, sensorsCallback callback, void *userData);
+void elisa3_unsubscribeSensors(elisa3_ctx *ctx, int subscription);
+sensorsRing* elisa3_subscribeSensorsRing(elisa3_ctx *ctx, int robotAddr, unsigned int packetTypes, unsigned int size);
+void elisa3_unsubscribeSensorsRing(elisa3_ctx *ctx, sensorsRing *ring);
+/** @} */
+
 #ifdef __cplusplus
 }
 #endif
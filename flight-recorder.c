@@ -0,0 +1,125 @@
+
+#include "flight-recorder.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+struct flightRecorder {
+    struct recorderHeader *header;  // start of the mapping
+    struct recorderRecord *records;
+    unsigned long long size;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    int fd;
+#endif
+};
+
+struct flightRecorder *recorderOpen(const char *path, unsigned int numRecords) {
+    struct flightRecorder *rec = NULL;
+    void *map = NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER fileSize;
+#endif
+
+    if(path == NULL || numRecords == 0) {
+        return NULL;
+    }
+    rec = calloc(1, sizeof(struct flightRecorder));
+    if(rec == NULL) {
+        return NULL;
+    }
+    rec->size = sizeof(struct recorderHeader) + (unsigned long long)numRecords*sizeof(struct recorderRecord);
+
+#if defined(_WIN32) || defined(_WIN64)
+    rec->file = CreateFileA(path, GENERIC_READ|GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(rec->file == INVALID_HANDLE_VALUE) {
+        free(rec);
+        return NULL;
+    }
+    fileSize.QuadPart = (LONGLONG)rec->size;
+    rec->mapping = CreateFileMappingA(rec->file, NULL, PAGE_READWRITE, fileSize.HighPart, fileSize.LowPart, NULL);   // extends the file
+    if(rec->mapping != NULL) {
+        map = MapViewOfFile(rec->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)rec->size);
+    }
+    if(map == NULL) {
+        if(rec->mapping != NULL) {
+            CloseHandle(rec->mapping);
+        }
+        CloseHandle(rec->file);
+        free(rec);
+        return NULL;
+    }
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+    rec->fd = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+    if(rec->fd < 0) {
+        free(rec);
+        return NULL;
+    }
+    if(ftruncate(rec->fd, (off_t)rec->size) != 0 ||
+       (map = mmap(NULL, (size_t)rec->size, PROT_READ|PROT_WRITE, MAP_SHARED, rec->fd, 0)) == MAP_FAILED) {
+        close(rec->fd);
+        free(rec);
+        return NULL;
+    }
+#endif
+
+    // touch all the pages now, the appends never wait for the allocation of the file
+    memset(map, 0, (size_t)rec->size);
+    rec->header = (struct recorderHeader*)map;
+    rec->records = (struct recorderRecord*)((char*)map + sizeof(struct recorderHeader));
+    memcpy(rec->header->magic, RECORDER_MAGIC, sizeof(rec->header->magic));
+    rec->header->version = RECORDER_VERSION;
+    rec->header->headerSize = sizeof(struct recorderHeader);
+    rec->header->recordSize = sizeof(struct recorderRecord);
+    rec->header->numRecords = numRecords;
+    return rec;
+}
+
+void recorderClose(struct flightRecorder *rec) {
+    if(rec == NULL) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    FlushViewOfFile(rec->header, 0);
+    UnmapViewOfFile(rec->header);
+    CloseHandle(rec->mapping);
+    CloseHandle(rec->file);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    msync(rec->header, (size_t)rec->size, MS_SYNC);
+    munmap(rec->header, (size_t)rec->size);
+    close(rec->fd);
+#endif
+    free(rec);
+}
+
+// Each append reserves its record with an atomic increment of the write index. The sequence number of the record is
+// cleared while it is written and set last, so a reader of the file (even while recording) can tell a complete record.
+void recorderAppend(struct flightRecorder *rec, int device, const int *address, const char *tx, const char *rx,
+                    unsigned long long txTime, unsigned long long rxTime, int usbError) {
+    unsigned long long n = __atomic_fetch_add(&rec->header->writeIndex, 1, __ATOMIC_RELAXED);
+    struct recorderRecord *record = &rec->records[n % rec->header->numRecords];
+
+    __atomic_store_n(&record->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record->txTime = txTime;
+    record->rxTime = rxTime;
+    record->device = device;
+    record->usbError = usbError;
+    memcpy(record->address, address, sizeof(record->address));
+    memcpy(record->tx, tx, RECORDER_PACKET_SIZE);
+    memcpy(record->rx, rx, RECORDER_PACKET_SIZE);
+    __atomic_store_n(&record->seq, n+1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,54 @@
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Flight recorder: every exchange with the base-stations is appended to a file mapped in memory and used as a ring,
+// the file is allocated (and its pages touched) when the recorder is opened so that appending a record is a copy
+// of less than 200 bytes in memory. The file is the header followed by "numRecords" records; the record "n" (from the
+// start of the recording) is at index n % numRecords, thus the file holds the last "numRecords" exchanges.
+
+#define RECORDER_MAGIC "ELISA3FR"
+#define RECORDER_VERSION 1
+#define RECORDER_SLOTS 4
+#define RECORDER_PACKET_SIZE 64
+
+struct recorderHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int headerSize;        // offset of the first record in the file
+    unsigned int recordSize;
+    unsigned int numRecords;
+    unsigned long long writeIndex;  // records written since the start
+} __attribute__((aligned(64)));
+
+struct recorderRecord {
+    unsigned long long seq;         // number of the record + 1, 0 while it is written (or never written)
+    unsigned long long txTime;      // monotonic time (us) the packet was sent to the base-station (see "getTimeUs")
+    unsigned long long rxTime;      // monotonic time (us) the answer was received
+    int device;                     // base-station index
+    int usbError;                   // 0, or the usb error of the exchange (the RX data then report a failure for each slot)
+    int address[RECORDER_SLOTS];    // robot address of each slot
+    char tx[RECORDER_PACKET_SIZE];  // packet sent
+    char rx[RECORDER_PACKET_SIZE];  // packet received: for each slot the ack id (0..2 are error codes) and the data
+};
+
+struct flightRecorder;
+
+// Create (or overwrite) the file and map it, NULL on error.
+struct flightRecorder *recorderOpen(const char *path, unsigned int numRecords);
+
+// Flush and unmap the file, no append must be in progress.
+void recorderClose(struct flightRecorder *rec);
+
+// Append an exchange, it can be called by several threads at the same time.
+void recorderAppend(struct flightRecorder *rec, int device, const int *address, const char *tx, const char *rx,
+                    unsigned long long txTime, unsigned long long rxTime, int usbError);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLIGHT_RECORDER_H_
@@ -0,0 +1,442 @@
+
+#include "mock-basestation.h"
+#include "timing.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include "pthread.h"
+#endif
+
+#define PACKET_SIZE 64
+#define ROBOT_PACKET_SIZE 15    // see the packet format in "elisa3-lib.c"
+#define ROBOTS_PER_PACKET 4
+#define ACK_SIZE 16
+#define MAX_ADDRESS 0xFFFF
+#define STEPS_PER_PACKET 0.2    // motor steps for each 1% of speed between two packets
+#define MM_PER_STEP 0.13
+#define WHEEL_DISTANCE_MM 40.8
+
+struct mockRobot {
+    mockRobotState state;
+    unsigned char nextAck;      // next ack id (3..7)
+    unsigned int ticks;         // packets answered, used to animate the sensors
+    double leftSteps, rightSteps;
+    double theta, x, y;         // theta in radians, position in mm
+};
+
+struct mockExchange {
+    char rxData[PACKET_SIZE];
+    int tag;
+    unsigned long long readyTime;
+};
+
+struct mockDevice {
+    char reply[PACKET_SIZE];    // answer to the last packet sent with the blocking transport
+    int replyPending;
+    unsigned long long replyTime;
+    struct mockExchange exchanges[USB_MAX_ASYNC_DEPTH];
+    unsigned int asyncDepth;
+    unsigned int asyncHead;
+    unsigned int asyncCount;
+    unsigned int random;        // xorshift state
+    unsigned long exchangesCount;
+};
+
+static struct mockDevice devices[USB_MAX_DEVICES];
+static int numDevices = 0;
+static int numDevicesRequested = 1;
+static double lossProbability = 0;
+static unsigned long latencyUs = 0, jitterUs = 0;
+static unsigned int seed = 1;
+static struct mockRobot *robots[MAX_ADDRESS+1];    // allocated the first time a robot is addressed
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE robotsMutex;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static pthread_mutex_t robotsMutex;
+#endif
+
+static void lockRobots() {
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(robotsMutex, INFINITE);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&robotsMutex);
+#endif
+}
+
+static void unlockRobots() {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseMutex(robotsMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&robotsMutex);
+#endif
+}
+
+static unsigned int nextRandom(struct mockDevice *d) {
+    d->random ^= d->random << 13;
+    d->random ^= d->random >> 17;
+    d->random ^= d->random << 5;
+    return d->random;
+}
+
+static void put16(char *buf, int value) {
+    buf[0] = value&0xFF;
+    buf[1] = (value>>8)&0xFF;
+}
+
+static void put32(char *buf, long value) {
+    buf[0] = value&0xFF;
+    buf[1] = (value>>8)&0xFF;
+    buf[2] = (value>>16)&0xFF;
+    buf[3] = (value>>24)&0xFF;
+}
+
+static signed char decodeSpeed(unsigned char value) {
+    if(value & 0x80) {
+        return (signed char)(value&0x7F);
+    } else {
+        return -(signed char)(value&0x7F);
+    }
+}
+
+// Synthetic sensors values: they change slowly over time and differ from robot to robot.
+static int proximity(int address, struct mockRobot *r, int i) {
+    return (address*13 + i*97 + r->ticks) % 1024;
+}
+
+static int ground(int address, struct mockRobot *r, int i) {
+    return 500 + i*10 + address%100 + (r->ticks%16);
+}
+
+static void moveRobot(struct mockRobot *r) {
+    double left = r->state.leftSpeed*STEPS_PER_PACKET, right = r->state.rightSpeed*STEPS_PER_PACKET;
+    r->leftSteps += left;
+    r->rightSteps += right;
+    r->theta += (right-left)*MM_PER_STEP/WHEEL_DISTANCE_MM;
+    r->x += cos(r->theta)*(left+right)/2*MM_PER_STEP;
+    r->y += sin(r->theta)*(left+right)/2*MM_PER_STEP;
+}
+
+// Fill the 16 bytes answer of a robot based on the ack id (see the layout in "elisa3-lib.c").
+static void fillAck(int address, struct mockRobot *r, char *ack) {
+    int i = 0, theta = 0;
+    static const int proxOrder[7] = {0, 1, 2, 3, 5, 6, 7};
+
+    ack[0] = r->nextAck;
+    switch(r->nextAck) {
+        case 3:
+            for(i=0; i<7; i++) {
+                put16(&ack[1+i*2], proximity(address, r, proxOrder[i]));
+            }
+            ack[15] = 0;    // flags: not charging, button not pressed
+            break;
+
+        case 4:
+            put16(&ack[1], proximity(address, r, 4));
+            for(i=0; i<4; i++) {
+                put16(&ack[3+i*2], ground(address, r, i));
+            }
+            put16(&ack[11], 0);     // accX
+            put16(&ack[13], 0);     // accY
+            ack[15] = 0;            // tv remote
+            break;
+
+        case 5:
+            for(i=0; i<7; i++) {
+                put16(&ack[1+i*2], proximity(address, r, proxOrder[i])/2);
+            }
+            ack[15] = address&0x0F; // selector
+            break;
+
+        case 6:
+            put16(&ack[1], proximity(address, r, 4)/2);
+            for(i=0; i<4; i++) {
+                put16(&ack[3+i*2], ground(address, r, i)/2);
+            }
+            put16(&ack[11], 64);    // accZ (1g)
+            put16(&ack[13], 850);   // battery
+            ack[15] = 0;            // heading
+            break;
+
+        case 7:
+            theta = (int)(fmod(r->theta*57.2957796, 360.0)*10);
+            put32(&ack[1], (long)r->leftSteps);
+            put32(&ack[5], (long)r->rightSteps);
+            put16(&ack[9], theta);
+            put16(&ack[11], (int)r->x);
+            put16(&ack[13], (int)r->y);
+            ack[15] = 0;            // gyroZ
+            break;
+    }
+    r->nextAck = (r->nextAck==7) ? 3 : r->nextAck+1;
+}
+
+// Handle a packet sent to the base-station and build its answer: 16 bytes for each robot addressed.
+static void processPacket(struct mockDevice *d, char *txData, char *reply) {
+    int i = 0, address = 0;
+    const unsigned char *payload = NULL;
+    struct mockRobot *r = NULL;
+
+    memset(reply, 0, PACKET_SIZE);
+    d->exchangesCount++;
+    if((unsigned char)txData[0] != 0x27) {   // only the robots commands are answered
+        return;
+    }
+
+    lockRobots();
+    for(i=0; i<ROBOTS_PER_PACKET; i++) {
+        payload = (const unsigned char*)&txData[i*ROBOT_PACKET_SIZE];
+        address = (payload[14]<<8) | payload[15];
+        r = robots[address];
+        if(r == NULL) {
+            r = calloc(1, sizeof(struct mockRobot));
+            if(r == NULL) {
+                reply[i*ACK_SIZE] = 2;
+                continue;
+            }
+            r->nextAck = 3;
+            robots[address] = r;
+        }
+        r->state.red = payload[1];
+        r->state.blue = payload[2];
+        r->state.green = payload[3];
+        r->state.flags[0] = payload[4];
+        r->state.rightSpeed = decodeSpeed(payload[5]);
+        r->state.leftSpeed = decodeSpeed(payload[6]);
+        r->state.smallLeds = payload[7];
+        r->state.flags[1] = payload[8];
+        r->state.payloadId = payload[9];
+        r->state.packets++;
+        moveRobot(r);
+
+        if(lossProbability > 0 && (nextRandom(d)%1000000) < lossProbability*1000000) {
+            reply[i*ACK_SIZE] = 2;  // transfer failed
+            continue;
+        }
+        r->state.acks++;
+        r->ticks++;
+        fillAck(address, r, &reply[i*ACK_SIZE]);
+    }
+    unlockRobots();
+}
+
+static unsigned long long replyTime(struct mockDevice *d) {
+    unsigned long long delay = latencyUs;
+    if(jitterUs > 0) {
+        delay += nextRandom(d)%(jitterUs+1);
+    }
+    return getTimeUs() + delay;
+}
+
+static int mockOpen() {
+    int i = 0;
+    numDevices = numDevicesRequested;
+    for(i=0; i<numDevices; i++) {
+        memset(&devices[i], 0, sizeof(struct mockDevice));
+        devices[i].random = seed*2654435761u + i + 1;
+        if(devices[i].random == 0) {
+            devices[i].random = 1;
+        }
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    robotsMutex = CreateMutex(NULL, FALSE, NULL);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_init(&robotsMutex, NULL);
+#endif
+    return numDevices;
+}
+
+static void mockClose() {
+    int i = 0;
+    for(i=0; i<=MAX_ADDRESS; i++) {
+        free(robots[i]);
+        robots[i] = NULL;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    CloseHandle(robotsMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_destroy(&robotsMutex);
+#endif
+    numDevices = 0;
+}
+
+static int mockNumDevices() {
+    return numDevices;
+}
+
+static int mockSend(int dev, char* data, int nbytes) {
+    char txData[PACKET_SIZE] = {0};
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    memcpy(txData, data, (nbytes < PACKET_SIZE) ? nbytes : PACKET_SIZE);
+    processPacket(&devices[dev], txData, devices[dev].reply);
+    devices[dev].replyPending = 1;
+    devices[dev].replyTime = replyTime(&devices[dev]);
+    return 0;
+}
+
+static int mockReceive(int dev, char* data, int nbytes) {
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    if(!devices[dev].replyPending) {    // nothing sent, the real base-station would time out
+        return USB_ERROR_TIMEOUT;
+    }
+    sleepUntilUs(devices[dev].replyTime);
+    memcpy(data, devices[dev].reply, (nbytes < PACKET_SIZE) ? nbytes : PACKET_SIZE);
+    devices[dev].replyPending = 0;
+    return 0;
+}
+
+static int mockStartAsync(int dev, unsigned int depth) {
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    if(devices[dev].asyncDepth>0 || depth==0) {
+        return -1;
+    }
+    devices[dev].asyncDepth = (depth > USB_MAX_ASYNC_DEPTH) ? USB_MAX_ASYNC_DEPTH : depth;
+    devices[dev].asyncHead = 0;
+    devices[dev].asyncCount = 0;
+    return 0;
+}
+
+static void mockStopAsync(int dev) {
+    if(dev<0 || dev>=numDevices) {
+        return;
+    }
+    devices[dev].asyncDepth = 0;
+    devices[dev].asyncCount = 0;
+}
+
+static unsigned int mockAsyncDepth(int dev) {
+    return (dev<0 || dev>=numDevices) ? 0 : devices[dev].asyncDepth;
+}
+
+static unsigned int mockAsyncPending(int dev) {
+    return (dev<0 || dev>=numDevices) ? 0 : devices[dev].asyncCount;
+}
+
+static int mockExchangeCompleted(int dev) {
+    struct mockDevice *d = NULL;
+    if(dev<0 || dev>=numDevices) {
+        return 0;
+    }
+    d = &devices[dev];
+    return (d->asyncCount > 0 && getTimeUs() >= d->exchanges[d->asyncHead].readyTime);
+}
+
+static int mockExchangeSubmit(int dev, char* txData, int txBytes, int rxBytes, int tag) {
+    struct mockDevice *d = NULL;
+    struct mockExchange *ex = NULL;
+    char data[PACKET_SIZE] = {0};
+    (void)rxBytes;  // the answer is always a whole packet
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+    if(d->asyncCount >= d->asyncDepth) {
+        return USB_ERROR_BUSY;
+    }
+    ex = &d->exchanges[(d->asyncHead+d->asyncCount)%d->asyncDepth];
+    memcpy(data, txData, (txBytes < PACKET_SIZE) ? txBytes : PACKET_SIZE);
+    processPacket(d, data, ex->rxData);
+    ex->tag = tag;
+    ex->readyTime = replyTime(d);
+    d->asyncCount++;
+    return 0;
+}
+
+static int mockExchangeWait(int dev, char* rxData, int rxBytes, int *tag) {
+    struct mockDevice *d = NULL;
+    struct mockExchange *ex = NULL;
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0 || devices[dev].asyncCount==0) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+    ex = &d->exchanges[d->asyncHead];
+    sleepUntilUs(ex->readyTime);
+    if(rxData != NULL) {
+        memcpy(rxData, ex->rxData, (rxBytes < PACKET_SIZE) ? rxBytes : PACKET_SIZE);
+    }
+    if(tag != NULL) {
+        *tag = ex->tag;
+    }
+    d->asyncHead = (d->asyncHead+1)%d->asyncDepth;
+    d->asyncCount--;
+    return 0;
+}
+
+const struct usbTransport mockTransport = {
+    mockOpen,
+    mockClose,
+    mockNumDevices,
+    mockSend,
+    mockReceive,
+    mockStartAsync,
+    mockStopAsync,
+    mockAsyncDepth,
+    mockAsyncPending,
+    mockExchangeCompleted,
+    mockExchangeSubmit,
+    mockExchangeWait
+};
+
+void mock_set_base_stations(int num) {
+    if(num < 1) {
+        num = 1;
+    }
+    if(num > USB_MAX_DEVICES) {
+        num = USB_MAX_DEVICES;
+    }
+    numDevicesRequested = num;
+}
+
+void mock_set_loss(double probability) {
+    if(probability < 0) {
+        probability = 0;
+    }
+    if(probability > 1) {
+        probability = 1;
+    }
+    lossProbability = probability;
+}
+
+void mock_set_latency(unsigned long latency, unsigned long jitter) {
+    latencyUs = latency;
+    jitterUs = jitter;
+}
+
+void mock_set_seed(unsigned int value) {
+    seed = value;
+}
+
+int mock_get_robot(int address, mockRobotState *state) {
+    int found = 0;
+    if(address<0 || address>MAX_ADDRESS || numDevices==0) {
+        return 0;
+    }
+    lockRobots();
+    if(robots[address] != NULL) {
+        *state = robots[address]->state;
+        found = 1;
+    }
+    unlockRobots();
+    return found;
+}
+
+unsigned long mock_get_exchanges(int dev) {
+    if(dev<0 || dev>=numDevices) {
+        return 0;
+    }
+    return devices[dev].exchangesCount;
+}
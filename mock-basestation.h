@@ -0,0 +1,52 @@
+#ifndef MOCK_BASESTATION_H_
+#define MOCK_BASESTATION_H_
+
+#include "usb-comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Software emulation of the radio base-stations and of the robots, to run the library without any hardware:
+// call "usb_set_transport(&mockTransport)" before starting the communication.
+// The 0x27 packets are decoded and each robot addressed answers with its ack payload, cycling through the ids 3..7
+// as the real robots do; the sensors values are synthetic and the odometry follows the speeds received.
+// The loss of the exchanges and the latency of the base-station can be configured.
+
+extern const struct usbTransport mockTransport;
+
+// Last command received by an emulated robot and its counters.
+typedef struct {
+    unsigned char red, green, blue;
+    unsigned char flags[2];
+    signed char leftSpeed, rightSpeed;  // percentage, negative for backward
+    unsigned char smallLeds;
+    unsigned char payloadId;
+    unsigned long packets;  // packets addressed to the robot
+    unsigned long acks;     // packets answered (not lost)
+} mockRobotState;
+
+// Number of base-stations emulated (default 1), to be set before opening the communication.
+void mock_set_base_stations(int num);
+
+// Probability (0..1) that the exchange with a robot fails (the base-station reports a transfer error), default 0.
+void mock_set_loss(double probability);
+
+// Time between a packet sent to the base-station and its answer available, plus a random jitter (0..jitterUs);
+// default 0 (answer available immediately).
+void mock_set_latency(unsigned long latencyUs, unsigned long jitterUs);
+
+// Seed of the pseudo-random generator used for the loss and the jitter (the sequences are reproducible).
+void mock_set_seed(unsigned int seed);
+
+// Return 1 and fill "state" if the robot was addressed at least once, 0 otherwise.
+int mock_get_robot(int address, mockRobotState *state);
+
+// Number of packets exchanged with a base-station since the communication was opened.
+unsigned long mock_get_exchanges(int dev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MOCK_BASESTATION_H_
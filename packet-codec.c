@@ -0,0 +1,203 @@
+
+#include "packet-codec.h"
+#include <stddef.h>
+#include <string.h>
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+#endif
+
+// TX payload of a robot (offsets in the slot, the byte 0 of the packet is the command):
+// R | B | G | flags0 | right | left | leds | flags1 | payload id | ...unused... | address high | address low
+enum txOp {
+    TX_BYTE,
+    TX_SPEED    // percentage, MSBit indicates the direction: 1=forward, 0=backward
+};
+
+struct txField {
+    unsigned char op;
+    unsigned char keepOnSleep;  // when the robot is put to sleep only the flags (sleep bit) are sent
+    unsigned short src;         // offset in "struct robotTx"
+};
+
+// Bytes 1..8 of the slot, in order.
+#define TX_FIELDS 8
+static const struct txField txLayout[TX_FIELDS] = {
+    {TX_BYTE,  0, offsetof(struct robotTx, redLed)},
+    {TX_BYTE,  0, offsetof(struct robotTx, blueLed)},
+    {TX_BYTE,  0, offsetof(struct robotTx, greenLed)},
+    {TX_BYTE,  1, offsetof(struct robotTx, flagsTX[0])},
+    {TX_SPEED, 0, offsetof(struct robotTx, rightSpeed)},
+    {TX_SPEED, 0, offsetof(struct robotTx, leftSpeed)},
+    {TX_BYTE,  0, offsetof(struct robotTx, smallLeds)},
+    {TX_BYTE,  0, offsetof(struct robotTx, flagsTX[1])}
+};
+#define TX_PAYLOAD_FIRST 1
+#define TX_PAYLOAD_ID 9
+#define TX_ADDRESS_HIGH 14
+#define TX_ADDRESS_LOW 15
+
+// RX payload of a robot: the ack id followed by 7 little-endian 16 bits words and a last byte. The layout of the
+// words depends on the ack id:
+// id=3 | prox0         | prox1         | prox2         | prox3         | prox5         | prox6         | prox7         | flags
+// id=4 | prox4         | gound0        | ground1       | ground2       | ground3       | accX          | accY          | tv remote
+// id=5 | proxAmbient0  | proxAmbient1  | proxAmbient2  | proxAmbient3  | proxAmbient5  | proxAmbient6  | proxAmbient7  | selector
+// id=6 | proxAmbient4  | goundAmbient0 | goundAmbient1 | goundAmbient2 | goundAmbient3 | accZ          | battery       | heading
+// id=7 | left steps (32 bits)          | right steps (32 bits)         | theta (x10)   | xpos          | ypos          | gyroZ
+// The words of the sensors packets (ids 3..6) are stored as they are, each one to its own field of the record; the
+// odometry packet (id 7) combines and scales the words.
+#define RX_FIRST_ID 3
+#define RX_WORDS 7
+#define RX_DST(field) offsetof(struct robotRx, field)
+
+enum rxLastOp {
+    RX_LAST_UCHAR,      // stored as it is
+    RX_LAST_HEADING     // 2 degrees resolution
+};
+
+struct rxSensorsLayout {
+    unsigned short wordDst[RX_WORDS];   // offsets in "struct robotRx"
+    unsigned short lastDst;
+    unsigned char lastOp;
+};
+
+static const struct rxSensorsLayout rxLayout[RX_PACKET_ODOMETRY] = {
+    {{RX_DST(proxValue[0]), RX_DST(proxValue[1]), RX_DST(proxValue[2]), RX_DST(proxValue[3]), RX_DST(proxValue[5]),
+      RX_DST(proxValue[6]), RX_DST(proxValue[7])}, RX_DST(flagsRX), RX_LAST_UCHAR},
+    {{RX_DST(proxValue[4]), RX_DST(groundValue[0]), RX_DST(groundValue[1]), RX_DST(groundValue[2]),
+      RX_DST(groundValue[3]), RX_DST(accX), RX_DST(accY)}, RX_DST(tvRemote), RX_LAST_UCHAR},
+    {{RX_DST(proxAmbientValue[0]), RX_DST(proxAmbientValue[1]), RX_DST(proxAmbientValue[2]),
+      RX_DST(proxAmbientValue[3]), RX_DST(proxAmbientValue[5]), RX_DST(proxAmbientValue[6]),
+      RX_DST(proxAmbientValue[7])}, RX_DST(selector), RX_LAST_UCHAR},
+    {{RX_DST(proxAmbientValue[4]), RX_DST(groundAmbientValue[0]), RX_DST(groundAmbientValue[1]),
+      RX_DST(groundAmbientValue[2]), RX_DST(groundAmbientValue[3]), RX_DST(accZ), RX_DST(batteryAdc)},
+      RX_DST(heading), RX_LAST_HEADING}
+};
+
+static inline unsigned char encodeField(const struct txField *field, const unsigned char *robot, unsigned char sleepMask) {
+    unsigned char value = robot[field->src];
+    if(field->op == TX_SPEED) {
+        value = (value & 0x80) ? ((-value)&0x7F) : (value|0x80);
+    }
+    return field->keepOnSleep ? value : (value & sleepMask);
+}
+
+// The table has a fixed size, the fields are expanded so that the compiler resolves the offsets and the operations.
+#define TX_ENCODE_FIELD(k) slot[TX_PAYLOAD_FIRST+(k)] = encodeField(&txLayout[k], robot, sleepMask)
+
+void codecEncodeTx(char *txBuf, struct robotTx *const *robots, int numSlots, unsigned char payloadId) {
+    int i = 0, address = 0;
+    unsigned char sleepMask = 0;
+    const unsigned char *robot = NULL;
+    char *slot = NULL;
+
+    for(i=0; i<numSlots; i++) {
+        robot = (const unsigned char*)robots[i];
+        address = robots[i]->robotAddress;
+        sleepMask = (robots[i]->sleepEnabledFlag==1) ? 0x00 : 0xFF;
+        slot = &txBuf[i*CODEC_TX_SLOT_SIZE];
+        TX_ENCODE_FIELD(0);
+        TX_ENCODE_FIELD(1);
+        TX_ENCODE_FIELD(2);
+        TX_ENCODE_FIELD(3);
+        TX_ENCODE_FIELD(4);
+        TX_ENCODE_FIELD(5);
+        TX_ENCODE_FIELD(6);
+        TX_ENCODE_FIELD(7);
+        slot[TX_PAYLOAD_ID] = payloadId;
+        slot[TX_ADDRESS_HIGH] = (address>>8)&0xFF;
+        slot[TX_ADDRESS_LOW] = address&0xFF;
+    }
+}
+
+// Signed little-endian word "i" of the slot (the byte 0 is the ack id).
+#define RX_WORD(slot, i) ((short)((unsigned char)(slot)[1+(i)*2] | ((unsigned char)(slot)[2+(i)*2]<<8)))
+#define RX_LAST(slot) ((unsigned char)(slot)[15])
+
+// The table has a fixed size, the words are expanded so that the compiler keeps them in registers.
+#define RX_STORE_WORD(k) *(int*)(dst+layout->wordDst[k]) = RX_WORD(slot, k)
+
+void codecDecodeRx(const char *rxBuf, struct robotRx *const *robots, int numSlots) {
+    int i = 0;
+    unsigned int id = 0;
+    const struct rxSensorsLayout *layout = NULL;
+    const char *slot = NULL;
+    char *dst = NULL;
+    struct robotRx *robot = NULL;
+
+    for(i=0; i<numSlots; i++) {
+        slot = &rxBuf[i*CODEC_RX_SLOT_SIZE];
+        robot = robots[i];
+        id = (unsigned char)slot[0] - RX_FIRST_ID;
+        if(robot == NULL || id >= RX_PACKET_TYPES) {
+            continue;
+        }
+        if(id < RX_PACKET_ODOMETRY) {
+            layout = &rxLayout[id];
+            dst = (char*)robot;
+            RX_STORE_WORD(0);
+            RX_STORE_WORD(1);
+            RX_STORE_WORD(2);
+            RX_STORE_WORD(3);
+            RX_STORE_WORD(4);
+            RX_STORE_WORD(5);
+            RX_STORE_WORD(6);
+            if(layout->lastOp == RX_LAST_HEADING) {
+                *(unsigned int*)(dst+layout->lastDst) = (unsigned int)RX_LAST(slot)<<1;
+            } else {
+                *(unsigned char*)(dst+layout->lastDst) = RX_LAST(slot);
+            }
+        } else {
+            robot->leftMotSteps = (int)((unsigned int)(unsigned short)RX_WORD(slot, 0) | ((unsigned int)RX_WORD(slot, 1)<<16));
+            robot->rightMotSteps = (int)((unsigned int)(unsigned short)RX_WORD(slot, 2) | ((unsigned int)RX_WORD(slot, 3)<<16));
+            robot->robTheta = RX_WORD(slot, 4)/10;
+            robot->robXPos = RX_WORD(slot, 5);
+            robot->robYPos = RX_WORD(slot, 6);
+            robot->gyroZ = (signed char)RX_LAST(slot)*64;
+        }
+    }
+}
+
+// The commands records are 8 bytes: left | right | red | green | blue | flags0 | flags1 | leds. Each byte is limited by
+// an unsigned minimum (100 for the rgb lanes), then the speeds equal to -128 (0x80) are incremented to -127; a vector
+// holds two records.
+#define CMD_SPEED_MIN 0x80
+static const unsigned char cmdLimits[16] = {0xFF, 0xFF, 100, 100, 100, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 100, 100, 100, 0xFF, 0xFF, 0xFF};
+static const unsigned char cmdSpeedLanes[16] = {0xFF, 0xFF, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0};
+
+void codecClampCommands(robotCommand *commands, int numRobots) {
+    unsigned char *bytes = (unsigned char*)commands;
+    int i = 0, n = numRobots*(int)sizeof(robotCommand);
+
+#if defined(__SSE2__)
+    const __m128i limits = _mm_loadu_si128((const __m128i*)cmdLimits);
+    const __m128i speedLanes = _mm_loadu_si128((const __m128i*)cmdSpeedLanes);
+    const __m128i speedMin = _mm_set1_epi8((char)CMD_SPEED_MIN);
+    __m128i v;
+    for(; i+16<=n; i+=16) {
+        v = _mm_min_epu8(_mm_loadu_si128((const __m128i*)&bytes[i]), limits);
+        v = _mm_sub_epi8(v, _mm_and_si128(_mm_cmpeq_epi8(v, speedMin), speedLanes));    // the mask is -1
+        _mm_storeu_si128((__m128i*)&bytes[i], v);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t limits = vld1q_u8(cmdLimits);
+    const uint8x16_t speedLanes = vld1q_u8(cmdSpeedLanes);
+    const uint8x16_t speedMin = vdupq_n_u8(CMD_SPEED_MIN);
+    uint8x16_t v;
+    for(; i+16<=n; i+=16) {
+        v = vminq_u8(vld1q_u8(&bytes[i]), limits);
+        v = vsubq_u8(v, vandq_u8(vceqq_u8(v, speedMin), speedLanes));
+        vst1q_u8(&bytes[i], v);
+    }
+#endif
+    for(; i<n; i++) {
+        if(bytes[i] > cmdLimits[i&15]) {
+            bytes[i] = cmdLimits[i&15];
+        }
+        if(bytes[i] == CMD_SPEED_MIN && cmdSpeedLanes[i&15]) {
+            bytes[i]++;
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef PACKET_CODEC_H_
+#define PACKET_CODEC_H_
+
+#include "elisa3-lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Encoding of the packets exchanged with the base-station, see the packet format in "elisa3-lib.c".
+// The content of the TX payload and of the five RX payloads (ack ids 3..7) is described by tables,
+// the same code handles all the slots of a packet.
+
+#define CODEC_TX_CMD_ROBOTS 0x27    // command "change robot state"
+#define CODEC_TX_SLOT_SIZE 15       // payload (13 bytes) + address (2 bytes)
+#define CODEC_RX_SLOT_SIZE 16       // ack id + 15 bytes of data
+#define CODEC_SLOTS_PER_PACKET 4    // slots in the 64 bytes usb packet
+
+// Per-robot state, one record for each robot so that the exchange of a packet touches few cache lines. The TX records
+// are written by the user (and read by the communication thread), the RX records are written by the communication
+// thread: they are kept in two separate arrays aligned on cache lines so that the two sides never write the same line.
+// Four TX records fill exactly one cache line, that is the data of a whole packet.
+struct robotTx {
+    int robotAddress;
+    char leftSpeed;
+    char rightSpeed;
+    char redLed, greenLed, blueLed;
+    unsigned char flagsTX[2];
+    unsigned char smallLeds;
+    unsigned char sleepEnabledFlag;
+    unsigned char calibrationSent;
+    unsigned char calibrateOdomSent;
+} __attribute__((aligned(16)));
+
+struct robotRx {
+    unsigned int rxSeq;     // sequence counter of the sensors data (odd while the communication thread is updating them)
+    unsigned int proxValue[8];
+    unsigned int proxAmbientValue[8];
+    unsigned int groundValue[4];
+    unsigned int groundAmbientValue[4];
+    signed int accX, accY, accZ;
+    unsigned int batteryAdc;
+    unsigned char selector;
+    unsigned char tvRemote;
+    unsigned char flagsRX;
+    unsigned char lastMessageSentFlag;
+    unsigned int sentFlagSeq;       // first packet whose ack advances "lastMessageSentFlag" (see "resetSentFlag")
+    signed long int leftMotSteps, rightMotSteps;
+    signed int robTheta, robXPos, robYPos;
+    unsigned int heading;
+    signed int gyroZ;
+    unsigned long long rxUpdateTime[RX_PACKET_TYPES];  // monotonic time (us) of the last packet received for each type
+    unsigned int rxUpdateCount[RX_PACKET_TYPES];
+    unsigned int dataEpoch;         // roster epoch of the first data received since the robot is in the list, 0 if none
+    unsigned long long numOfErrors; // exchanges without data
+} __attribute__((aligned(64)));
+
+/**
+ * \brief Fill the slots of a TX packet (the command byte isn't touched).
+ * \param txBuf packet to fill, it must hold 1+numSlots*CODEC_TX_SLOT_SIZE bytes.
+ * \param robots the robot of each slot.
+ * \param numSlots number of slots.
+ * \param payloadId value that differentiates the packet from the previous one.
+ * \return none
+ */
+void codecEncodeTx(char *txBuf, struct robotTx *const *robots, int numSlots, unsigned char payloadId);
+
+/**
+ * \brief Decode the sensors data of the slots of a RX packet based on the ack id of each slot.
+ * \param rxBuf received packet, numSlots*CODEC_RX_SLOT_SIZE bytes.
+ * \param robots the robot of each slot, NULL to skip the slot (e.g. transfer failed).
+ * \param numSlots number of slots.
+ * \return none
+ */
+void codecDecodeRx(const char *rxBuf, struct robotRx *const *robots, int numSlots);
+
+/**
+ * \brief Saturate the commands records in place: speeds to -127..127 (-128 can't be encoded), rgb intensities to 0..100.
+ * \param commands records to saturate.
+ * \param numRobots number of records.
+ * \return none
+ */
+void codecClampCommands(robotCommand *commands, int numRobots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKET_CODEC_H_
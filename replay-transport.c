@@ -0,0 +1,399 @@
+
+#include "replay-transport.h"
+#include "flight-recorder.h"
+#include "timing.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include "pthread.h"
+#endif
+
+#define PACKET_SIZE 64
+#define ROBOT_PACKET_SIZE 15    // see the packet format in "elisa3-lib.c"
+#define ROBOTS_PER_PACKET 4
+#define ACK_SIZE 16
+#define MAX_ADDRESS 0xFFFF
+#define NO_ANSWER -1
+
+// Answer recorded for a robot, the answers of each address are linked in the order of the recording.
+struct replayAnswer {
+    char ack[ACK_SIZE];
+    unsigned long long offsetUs;    // time of the answer from the start of the recording
+    int usbError;
+    long next;
+};
+
+struct replayExchange {
+    char rxData[PACKET_SIZE];
+    int tag;
+    int usbError;
+    unsigned long long readyTime;
+};
+
+struct replayDevice {
+    struct replayExchange reply;    // answer to the last packet sent with the blocking transport
+    int replyPending;
+    struct replayExchange exchanges[USB_MAX_ASYNC_DEPTH];
+    unsigned int asyncDepth;
+    unsigned int asyncHead;
+    unsigned int asyncCount;
+};
+
+static struct replayDevice devices[USB_MAX_DEVICES];
+static int numDevices = 0;
+static struct replayAnswer *answers = NULL;
+static unsigned long numAnswers = 0, answersLeft = 0;
+static unsigned long numRecords = 0;
+static long *firstAnswer = NULL;    // first answer of each address (MAX_ADDRESS+1 entries)
+static long *nextAnswer = NULL;     // next answer to replay for each address
+static int *addresses = NULL;       // addresses in order of appearance
+static int numAddresses = 0;
+static int recordedDevices = 0;
+static double speed = 1.0;
+static unsigned long long startTime = 0;
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE answersMutex;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static pthread_mutex_t answersMutex;
+#endif
+
+static void lockAnswers() {
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(answersMutex, INFINITE);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&answersMutex);
+#endif
+}
+
+static void unlockAnswers() {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseMutex(answersMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&answersMutex);
+#endif
+}
+
+static void freeRecording() {
+    free(answers);
+    free(firstAnswer);
+    free(nextAnswer);
+    free(addresses);
+    answers = NULL;
+    firstAnswer = NULL;
+    nextAnswer = NULL;
+    addresses = NULL;
+    numAnswers = 0;
+    answersLeft = 0;
+    numRecords = 0;
+    numAddresses = 0;
+    recordedDevices = 0;
+}
+
+// Build the answers of a packet sent to the base-station: the next answer recorded for each robot addressed. With
+// a replay speed the answer is ready when the last of these answers was received during the recording.
+static void processPacket(char *txData, struct replayExchange *ex) {
+    int i = 0, address = 0;
+    long k = 0;
+    unsigned long long due = 0;
+    const unsigned char *payload = NULL;
+    struct replayAnswer *answer = NULL;
+
+    memset(ex->rxData, 0, PACKET_SIZE);
+    ex->usbError = 0;
+    ex->readyTime = 0;
+    if((unsigned char)txData[0] != 0x27) {   // only the robots commands are answered
+        return;
+    }
+
+    lockAnswers();
+    if(startTime == 0) {
+        startTime = getTimeUs();
+    }
+    for(i=0; i<ROBOTS_PER_PACKET; i++) {
+        payload = (const unsigned char*)&txData[i*ROBOT_PACKET_SIZE];
+        address = (payload[14]<<8) | payload[15];
+        k = nextAnswer[address];
+        if(k == NO_ANSWER) {
+            continue;   // "no ack"
+        }
+        answer = &answers[k];
+        memcpy(&ex->rxData[i*ACK_SIZE], answer->ack, ACK_SIZE);
+        if(answer->usbError != 0) {
+            ex->usbError = answer->usbError;
+        }
+        if(speed > 0) {
+            due = startTime + (unsigned long long)(answer->offsetUs/speed);
+            if(due > ex->readyTime) {
+                ex->readyTime = due;
+            }
+        }
+        nextAnswer[address] = answer->next;
+        answersLeft--;
+    }
+    unlockAnswers();
+}
+
+// The records are read in the order they were written: the file holds the last "numRecords" of "writeIndex" records.
+int replay_set_file(const char *path) {
+    FILE *file = NULL;
+    struct recorderHeader header;
+    struct recorderRecord *records = NULL;
+    struct recorderRecord *record = NULL;
+    long *lastAnswer = NULL;
+    unsigned long long n = 0, first = 0, count = 0, firstTime = 0;
+    int i = 0, address = 0;
+    long k = 0;
+
+    if(numDevices > 0) {    // communication open
+        return -1;
+    }
+    freeRecording();
+    file = fopen(path, "rb");
+    if(file == NULL) {
+        return -1;
+    }
+    if(fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, RECORDER_MAGIC, sizeof(header.magic)) != 0 ||
+       header.version != RECORDER_VERSION || header.recordSize != sizeof(struct recorderRecord) ||
+       header.headerSize < sizeof(header) || header.numRecords == 0) {
+        fclose(file);
+        return -1;
+    }
+    records = malloc((size_t)header.numRecords*sizeof(struct recorderRecord));
+    answers = malloc((size_t)header.numRecords*ROBOTS_PER_PACKET*sizeof(struct replayAnswer));
+    firstAnswer = malloc((MAX_ADDRESS+1)*sizeof(long));
+    nextAnswer = malloc((MAX_ADDRESS+1)*sizeof(long));
+    lastAnswer = malloc((MAX_ADDRESS+1)*sizeof(long));
+    addresses = malloc((MAX_ADDRESS+1)*sizeof(int));
+    if(records == NULL || answers == NULL || firstAnswer == NULL || nextAnswer == NULL || lastAnswer == NULL || addresses == NULL ||
+       fseek(file, header.headerSize, SEEK_SET) != 0 ||
+       fread(records, sizeof(struct recorderRecord), header.numRecords, file) != header.numRecords) {
+        fclose(file);
+        free(records);
+        free(lastAnswer);
+        freeRecording();
+        return -1;
+    }
+    fclose(file);
+
+    for(i=0; i<=MAX_ADDRESS; i++) {
+        firstAnswer[i] = NO_ANSWER;
+        lastAnswer[i] = NO_ANSWER;
+    }
+    count = (header.writeIndex < header.numRecords) ? header.writeIndex : header.numRecords;
+    first = header.writeIndex - count;
+    for(n=first; n<header.writeIndex; n++) {
+        record = &records[n % header.numRecords];
+        if(record->seq != n+1) {    // overwritten or not completed when the recording stopped
+            continue;
+        }
+        if(numRecords == 0) {
+            firstTime = record->txTime;
+        }
+        numRecords++;
+        if(record->device+1 > recordedDevices) {
+            recordedDevices = record->device+1;
+        }
+        for(i=0; i<ROBOTS_PER_PACKET; i++) {
+            address = record->address[i];
+            if(address<0 || address>MAX_ADDRESS) {
+                continue;
+            }
+            k = (long)numAnswers++;
+            memcpy(answers[k].ack, &record->rx[i*ACK_SIZE], ACK_SIZE);
+            answers[k].offsetUs = (record->rxTime > firstTime) ? (record->rxTime-firstTime) : 0;
+            answers[k].usbError = record->usbError;
+            answers[k].next = NO_ANSWER;
+            if(lastAnswer[address] == NO_ANSWER) {
+                firstAnswer[address] = k;
+                addresses[numAddresses++] = address;
+            } else {
+                answers[lastAnswer[address]].next = k;
+            }
+            lastAnswer[address] = k;
+        }
+    }
+    free(records);
+    free(lastAnswer);
+    return 0;
+}
+
+static int replayOpen() {
+    if(answers == NULL) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    numDevices = (recordedDevices < 1) ? 1 : (recordedDevices > USB_MAX_DEVICES) ? USB_MAX_DEVICES : recordedDevices;
+    memset(devices, 0, sizeof(devices));
+    memcpy(nextAnswer, firstAnswer, (MAX_ADDRESS+1)*sizeof(long));
+    answersLeft = numAnswers;
+    startTime = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    answersMutex = CreateMutex(NULL, FALSE, NULL);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_init(&answersMutex, NULL);
+#endif
+    return numDevices;
+}
+
+static void replayClose() {
+#if defined(_WIN32) || defined(_WIN64)
+    CloseHandle(answersMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_destroy(&answersMutex);
+#endif
+    numDevices = 0;
+}
+
+static int replayNumDevices() {
+    return numDevices;
+}
+
+static int replaySend(int dev, char* data, int nbytes) {
+    char txData[PACKET_SIZE] = {0};
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    memcpy(txData, data, (nbytes < PACKET_SIZE) ? nbytes : PACKET_SIZE);
+    processPacket(txData, &devices[dev].reply);
+    devices[dev].replyPending = 1;
+    return 0;
+}
+
+static int replayReceive(int dev, char* data, int nbytes) {
+    struct replayDevice *d = NULL;
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    d = &devices[dev];
+    if(!d->replyPending) {
+        return USB_ERROR_TIMEOUT;
+    }
+    d->replyPending = 0;
+    sleepUntilUs(d->reply.readyTime);
+    if(d->reply.usbError != 0) {
+        return d->reply.usbError;
+    }
+    memcpy(data, d->reply.rxData, (nbytes < PACKET_SIZE) ? nbytes : PACKET_SIZE);
+    return 0;
+}
+
+static int replayStartAsync(int dev, unsigned int depth) {
+    if(dev<0 || dev>=numDevices) {
+        return USB_ERROR_NO_DEVICE;
+    }
+    if(devices[dev].asyncDepth>0 || depth==0) {
+        return -1;
+    }
+    devices[dev].asyncDepth = (depth > USB_MAX_ASYNC_DEPTH) ? USB_MAX_ASYNC_DEPTH : depth;
+    devices[dev].asyncHead = 0;
+    devices[dev].asyncCount = 0;
+    return 0;
+}
+
+static void replayStopAsync(int dev) {
+    if(dev<0 || dev>=numDevices) {
+        return;
+    }
+    devices[dev].asyncDepth = 0;
+    devices[dev].asyncCount = 0;
+}
+
+static unsigned int replayAsyncDepth(int dev) {
+    return (dev<0 || dev>=numDevices) ? 0 : devices[dev].asyncDepth;
+}
+
+static unsigned int replayAsyncPending(int dev) {
+    return (dev<0 || dev>=numDevices) ? 0 : devices[dev].asyncCount;
+}
+
+static int replayExchangeCompleted(int dev) {
+    struct replayDevice *d = NULL;
+    if(dev<0 || dev>=numDevices) {
+        return 0;
+    }
+    d = &devices[dev];
+    return (d->asyncCount > 0 && getTimeUs() >= d->exchanges[d->asyncHead].readyTime);
+}
+
+static int replayExchangeSubmit(int dev, char* txData, int txBytes, int rxBytes, int tag) {
+    struct replayDevice *d = NULL;
+    struct replayExchange *ex = NULL;
+    char data[PACKET_SIZE] = {0};
+    (void)rxBytes;  // the recorded answer is always a whole packet
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+    if(d->asyncCount >= d->asyncDepth) {
+        return USB_ERROR_BUSY;
+    }
+    ex = &d->exchanges[(d->asyncHead+d->asyncCount)%d->asyncDepth];
+    memcpy(data, txData, (txBytes < PACKET_SIZE) ? txBytes : PACKET_SIZE);
+    processPacket(data, ex);
+    ex->tag = tag;
+    d->asyncCount++;
+    return 0;
+}
+
+static int replayExchangeWait(int dev, char* rxData, int rxBytes, int *tag) {
+    struct replayDevice *d = NULL;
+    struct replayExchange *ex = NULL;
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0 || devices[dev].asyncCount==0) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+    ex = &d->exchanges[d->asyncHead];
+    sleepUntilUs(ex->readyTime);
+    if(rxData != NULL && ex->usbError == 0) {
+        memcpy(rxData, ex->rxData, (rxBytes < PACKET_SIZE) ? rxBytes : PACKET_SIZE);
+    }
+    if(tag != NULL) {
+        *tag = ex->tag;
+    }
+    d->asyncHead = (d->asyncHead+1)%d->asyncDepth;
+    d->asyncCount--;
+    return ex->usbError;
+}
+
+const struct usbTransport replayTransport = {
+    replayOpen,
+    replayClose,
+    replayNumDevices,
+    replaySend,
+    replayReceive,
+    replayStartAsync,
+    replayStopAsync,
+    replayAsyncDepth,
+    replayAsyncPending,
+    replayExchangeCompleted,
+    replayExchangeSubmit,
+    replayExchangeWait
+};
+
+void replay_set_speed(double value) {
+    speed = (value > 0) ? value : 0;
+}
+
+unsigned long replay_get_records() {
+    return numRecords;
+}
+
+int replay_get_addresses(int *addr, int maxAddr) {
+    int i = 0;
+    for(i=0; i<numAddresses && i<maxAddr; i++) {
+        addr[i] = addresses[i];
+    }
+    return numAddresses;
+}
+
+int replay_finished() {
+    return (numAnswers > 0 && answersLeft == 0);
+}
@@ -0,0 +1,43 @@
+#ifndef REPLAY_TRANSPORT_H_
+#define REPLAY_TRANSPORT_H_
+
+#include "usb-comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Replay of a recording of the flight recorder (see "flight-recorder.h") in place of the base-stations: call
+// "replay_set_file" and "usb_set_transport(&replayTransport)" before starting the communication.
+// The packets sent by the library aren't required to match the recorded ones (the slots scheduling depends on the
+// time): each robot addressed gets the answers recorded for its address, in order, so the sensors decoded and thus
+// all the getters follow exactly what the application saw during the recording. An exchange failed with a usb error
+// is replayed with the same error. Once all the answers of a robot are replayed (or for a robot never recorded) the
+// base-station reports "no ack" for it, the last sensors values are kept.
+
+extern const struct usbTransport replayTransport;
+
+// Load the recording to replay, to be called while the communication is closed; return 0 on success, -1 if the file
+// can't be read or isn't a recording. Each opening of the communication replays the recording from the start.
+int replay_set_file(const char *path);
+
+// Replay speed: 1 (default) replays the answers with the time they had during the recording (relative to the first
+// exchange), 2 twice as fast and so on; 0 answers immediately, then the rate is given by the library
+// (e.g. "setTransferPeriod(1)" to decode as fast as possible).
+void replay_set_speed(double speed);
+
+// Number of exchanges in the recording loaded.
+unsigned long replay_get_records();
+
+// Robots addresses found in the recording, in order of appearance; return the number of addresses (it can be more
+// than "maxAddr", only the first "maxAddr" are copied).
+int replay_get_addresses(int *addr, int maxAddr);
+
+// Return 1 when all the answers recorded are replayed, 0 otherwise.
+int replay_finished();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REPLAY_TRANSPORT_H_
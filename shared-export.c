@@ -0,0 +1,280 @@
+
+#include "shared-export.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+struct sharedExport {
+    struct exportHeader *header;    // start of the mapping
+    struct exportLink *links;
+    struct exportRobot *robots;
+    unsigned long long size;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE mapping;
+#endif
+    char name[];
+};
+
+static unsigned long long segmentSize(unsigned int maxRobots) {
+    return sizeof(struct exportHeader) + EXPORT_MAX_LINKS*sizeof(struct exportLink) + (unsigned long long)maxRobots*sizeof(struct exportRobot);
+}
+
+struct sharedExport *exportOpen(const char *name, unsigned int maxRobots) {
+    struct sharedExport *exp = NULL;
+    void *map = NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER mapSize;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    int fd = -1;
+#endif
+
+    if(name == NULL || maxRobots == 0) {
+        return NULL;
+    }
+    exp = calloc(1, sizeof(struct sharedExport) + strlen(name) + 1);
+    if(exp == NULL) {
+        return NULL;
+    }
+    strcpy(exp->name, name);
+    exp->size = segmentSize(maxRobots);
+
+#if defined(_WIN32) || defined(_WIN64)
+    mapSize.QuadPart = (LONGLONG)exp->size;
+    exp->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, mapSize.HighPart, mapSize.LowPart, name);
+    if(exp->mapping != NULL && GetLastError() == ERROR_ALREADY_EXISTS) {    // still mapped by another process, maybe smaller
+        CloseHandle(exp->mapping);
+        exp->mapping = NULL;
+    }
+    if(exp->mapping != NULL) {
+        map = MapViewOfFile(exp->mapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)exp->size);
+    }
+    if(map == NULL) {
+        if(exp->mapping != NULL) {
+            CloseHandle(exp->mapping);
+        }
+        free(exp);
+        return NULL;
+    }
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+    shm_unlink(name);   // a segment left by a previous run can have another size
+    fd = shm_open(name, O_RDWR|O_CREAT|O_EXCL, 0644);
+    if(fd < 0) {
+        free(exp);
+        return NULL;
+    }
+    if(ftruncate(fd, (off_t)exp->size) != 0 ||
+       (map = mmap(NULL, (size_t)exp->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        shm_unlink(name);
+        free(exp);
+        return NULL;
+    }
+    close(fd);  // the mapping keeps the segment
+#endif
+
+    // touch all the pages now, the updates never wait for the allocation of the segment
+    memset(map, 0, (size_t)exp->size);
+    exp->header = (struct exportHeader*)map;
+    exp->links = (struct exportLink*)((char*)map + sizeof(struct exportHeader));
+    exp->robots = (struct exportRobot*)((char*)exp->links + EXPORT_MAX_LINKS*sizeof(struct exportLink));
+    exp->header->version = EXPORT_VERSION;
+    exp->header->headerSize = sizeof(struct exportHeader);
+    exp->header->linkSize = sizeof(struct exportLink);
+    exp->header->robotSize = sizeof(struct exportRobot);
+    exp->header->maxLinks = EXPORT_MAX_LINKS;
+    exp->header->maxRobots = maxRobots;
+    exp->header->active = 1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(exp->header->magic, EXPORT_MAGIC, sizeof(exp->header->magic));
+    return exp;
+}
+
+void exportClose(struct sharedExport *exp) {
+    if(exp == NULL) {
+        return;
+    }
+    __atomic_store_n(&exp->header->active, 0, __ATOMIC_RELEASE);
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(exp->header);
+    CloseHandle(exp->mapping);  // the segment is destroyed with the last mapping
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    munmap(exp->header, (size_t)exp->size);
+    shm_unlink(exp->name);
+#endif
+    free(exp);
+}
+
+// Sequence lock of the shared records: the counter is odd while the rest of the record is written, the readers retry
+// when they see it odd or changed after their copy. The counter is the first field of each record.
+static void writeRecord(unsigned int *seq, const void *data, size_t size) {
+    __atomic_store_n(seq, *seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char*)seq+sizeof(*seq), (const char*)data+sizeof(*seq), size-sizeof(*seq));
+    __atomic_store_n(seq, *seq+1, __ATOMIC_RELEASE);
+}
+
+static void readRecord(const unsigned int *seq, void *data, size_t size) {
+    unsigned int begin = 0;
+    do {
+        begin = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+        memcpy(data, seq, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((begin & 1) || __atomic_load_n(seq, __ATOMIC_RELAXED) != begin);
+}
+
+void exportWriteRoster(struct sharedExport *exp, unsigned int listRobots, unsigned int rosterEpoch, unsigned int numLinks) {
+    struct exportHeader *header = exp->header;
+    __atomic_store_n(&header->seq, header->seq+1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    header->numRobots = (listRobots < header->maxRobots) ? listRobots : header->maxRobots;
+    header->listRobots = listRobots;
+    header->rosterEpoch = rosterEpoch;
+    header->numLinks = (numLinks < EXPORT_MAX_LINKS) ? numLinks : EXPORT_MAX_LINKS;
+    __atomic_store_n(&header->seq, header->seq+1, __ATOMIC_RELEASE);
+}
+
+void exportWriteLink(struct sharedExport *exp, unsigned int index, const struct exportLink *link) {
+    if(index < EXPORT_MAX_LINKS) {
+        writeRecord(&exp->links[index].seq, link, sizeof(struct exportLink));
+    }
+}
+
+void exportWriteRobot(struct sharedExport *exp, unsigned int index, const struct exportRobot *robot) {
+    if(index < exp->header->maxRobots) {
+        writeRecord(&exp->robots[index].seq, robot, sizeof(struct exportRobot));
+    }
+}
+
+// The layout must be the one of this header. On Linux / Mac OS X the segment has exactly the size of its records (see
+// "exportOpen"), thus "exportDetach" unmaps the size given by the header; on Windows the view is page rounded.
+static int validSegment(const struct exportHeader *header, unsigned long long size) {
+    if(size < sizeof(struct exportHeader) || memcmp(header->magic, EXPORT_MAGIC, sizeof(header->magic)) != 0 ||
+       header->version != EXPORT_VERSION || header->headerSize != sizeof(struct exportHeader) ||
+       header->linkSize != sizeof(struct exportLink) || header->robotSize != sizeof(struct exportRobot) ||
+       header->maxLinks != EXPORT_MAX_LINKS || header->maxRobots == 0) {
+        return 0;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    return size >= segmentSize(header->maxRobots);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    return size == segmentSize(header->maxRobots);
+#endif
+}
+
+const struct exportHeader *exportAttach(const char *name) {
+    const struct exportHeader *header = NULL;
+    void *map = NULL;
+    unsigned long long size = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE mapping = NULL;
+    MEMORY_BASIC_INFORMATION info;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    struct stat st;
+    int fd = -1;
+#endif
+
+    if(name == NULL) {
+        return NULL;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name);
+    if(mapping == NULL) {
+        return NULL;
+    }
+    map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);   // the view keeps the segment
+    if(map == NULL) {
+        return NULL;
+    }
+    VirtualQuery(map, &info, sizeof(info));
+    size = info.RegionSize;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) {
+        return NULL;
+    }
+    if(fstat(fd, &st) != 0 || (unsigned long long)st.st_size < sizeof(struct exportHeader) ||
+       (map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    size = (unsigned long long)st.st_size;
+#endif
+
+    header = (const struct exportHeader*)map;
+    if(!validSegment(header, size)) {    // unmap what was mapped, the header can't be trusted
+#if defined(_WIN32) || defined(_WIN64)
+        UnmapViewOfFile(map);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        munmap(map, (size_t)size);
+#endif
+        return NULL;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return header;
+}
+
+void exportDetach(const struct exportHeader *header) {
+    if(header == NULL) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    UnmapViewOfFile(header);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    munmap((void*)header, (size_t)segmentSize(header->maxRobots));
+#endif
+}
+
+int exportReadRobot(const struct exportHeader *header, unsigned int index, struct exportRobot *robot) {
+    const struct exportRobot *robots = (const struct exportRobot*)((const char*)header + header->headerSize + header->maxLinks*header->linkSize);
+    if(index >= header->maxRobots) {
+        return -1;
+    }
+    readRecord(&robots[index].seq, robot, sizeof(struct exportRobot));
+    return 0;
+}
+
+int exportReadLink(const struct exportHeader *header, unsigned int index, struct exportLink *link) {
+    const struct exportLink *links = (const struct exportLink*)((const char*)header + header->headerSize);
+    if(index >= header->maxLinks) {
+        return -1;
+    }
+    readRecord(&links[index].seq, link, sizeof(struct exportLink));
+    return 0;
+}
+
+unsigned int exportReadRoster(const struct exportHeader *header, unsigned int *rosterEpoch, unsigned int *numLinks) {
+    unsigned int begin = 0, numRobots = 0, epoch = 0, links = 0;
+    do {
+        begin = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        numRobots = header->numRobots;
+        epoch = header->rosterEpoch;
+        links = header->numLinks;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((begin & 1) || __atomic_load_n(&header->seq, __ATOMIC_RELAXED) != begin);
+    if(rosterEpoch != NULL) {
+        *rosterEpoch = epoch;
+    }
+    if(numLinks != NULL) {
+        *numLinks = links;
+    }
+    return numRobots;
+}
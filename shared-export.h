@@ -0,0 +1,110 @@
+#ifndef SHARED_EXPORT_H_
+#define SHARED_EXPORT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Shared-memory export of the swarm state: the library (see "startSharedExport") publishes the sensors and the
+// liveness of each robot and the statistics of each base-station link in a named shared-memory segment (POSIX
+// "shm_open", a named file mapping on Windows), updated at each exchange. Other processes map it read-only with
+// "exportAttach" and read it without copies through the library nor system calls.
+// The segment is the header, then "maxLinks" link records, then "maxRobots" robot records (at the offsets given by
+// the sizes in the header). Each record, and the roster fields of the header, are protected by a sequence counter:
+// odd while the writer updates them, a reader copies the record and retries if the counter changed meanwhile
+// ("exportReadRobot", "exportReadLink" and "exportReadRoster" do it). The 64 bits fields come first in the records so
+// that the layout is the same for 32 and 64 bits processes.
+
+#define EXPORT_MAGIC "ELISA3SM"
+#define EXPORT_VERSION 1
+#define EXPORT_MAX_LINKS 8          // same as USB_MAX_DEVICES
+#define EXPORT_PACKET_TYPES 5       // same as RX_PACKET_TYPES
+#define EXPORT_LATENCY_BUCKETS 24   // same as LATENCY_BUCKETS
+
+struct exportHeader {
+    char magic[8];                  // written last when the segment is created
+    unsigned int version;
+    unsigned int headerSize;        // offset of the first link record
+    unsigned int linkSize;
+    unsigned int robotSize;
+    unsigned int maxLinks;
+    unsigned int maxRobots;         // robot records, the robots of the list beyond them aren't exported
+    unsigned int active;            // 1 while the library publishes, 0 once the export is stopped
+    unsigned int seq;               // sequence counter of the following fields
+    unsigned int numRobots;         // robot records in use (robots of the list, at most "maxRobots")
+    unsigned int listRobots;        // robots in the list
+    unsigned int rosterEpoch;       // see "getRosterEpoch"
+    unsigned int numLinks;          // link records in use
+} __attribute__((aligned(64)));
+
+struct exportLink {
+    unsigned int seq;               // sequence counter of the record
+    int device;                     // base-station index
+    unsigned long long exchanges;   // packets exchanged with the base-station
+    unsigned long long usbErrors;   // exchanges failed
+    unsigned long long periodUs;    // current period of the exchanges
+    unsigned long long transferAvgUs;   // average time spent in the transfer functions
+    unsigned long long usbLatencyMax, ackLatencyMax;
+    unsigned long long lastExchangeTime;    // monotonic time (us) of the last answer received (see "getTimeUs")
+    unsigned int usbLatency[EXPORT_LATENCY_BUCKETS];    // histograms, see "getLatencyStats"
+    unsigned int ackLatency[EXPORT_LATENCY_BUCKETS];
+} __attribute__((aligned(64)));
+
+// Sensors with the same meaning as the getters of "elisa3-lib.h".
+struct exportRobot {
+    unsigned int seq;               // sequence counter of the record
+    int address;                    // robot address, the record is in use if its index is below "numRobots"
+    long long leftMotSteps, rightMotSteps;
+    unsigned long long rxUpdateTime[EXPORT_PACKET_TYPES];
+    unsigned long long numOfErrors; // exchanges without data
+    unsigned int rxUpdateCount[EXPORT_PACKET_TYPES];
+    unsigned int dataEpoch;         // see "getDataEpoch"
+    unsigned int failures;          // consecutive exchanges without answer, see "getRobotLiveness"
+    unsigned int unreachable;       // ROBOT_UNREACHABLE or ROBOT_ALIVE
+    unsigned int proxValue[8];
+    unsigned int proxAmbientValue[8];
+    unsigned int groundValue[4];
+    unsigned int groundAmbientValue[4];
+    int accX, accY, accZ;
+    unsigned int batteryAdc;
+    int robTheta, robXPos, robYPos;
+    unsigned int heading;
+    int gyroZ;
+    unsigned char selector, tvRemote, flagsRX, lastMessageSentFlag;
+} __attribute__((aligned(64)));
+
+struct sharedExport;
+
+// Writer side, used by the library: the writes of a record must be serialized by the caller.
+
+// Create (or replace) the segment and map it, NULL on error. On Windows a mapping with the same name still open (by
+// a reader or another writer) isn't replaced, it is an error.
+struct sharedExport *exportOpen(const char *name, unsigned int maxRobots);
+
+// Mark the segment inactive, unmap it and remove its name (the processes that mapped it keep their mapping).
+void exportClose(struct sharedExport *exp);
+
+void exportWriteRoster(struct sharedExport *exp, unsigned int listRobots, unsigned int rosterEpoch, unsigned int numLinks);
+void exportWriteLink(struct sharedExport *exp, unsigned int index, const struct exportLink *link);
+void exportWriteRobot(struct sharedExport *exp, unsigned int index, const struct exportRobot *robot);
+
+// Reader side, for the other processes.
+
+// Map the segment read-only; NULL if it doesn't exist or its version/layout isn't the one of this header.
+const struct exportHeader *exportAttach(const char *name);
+
+// Unmap a segment mapped with "exportAttach".
+void exportDetach(const struct exportHeader *header);
+
+// Consistent copy of a robot record (of a link record); return 0, -1 if the index is beyond the records.
+int exportReadRobot(const struct exportHeader *header, unsigned int index, struct exportRobot *robot);
+int exportReadLink(const struct exportHeader *header, unsigned int index, struct exportLink *link);
+
+// Consistent copy of the roster fields: return the robot records in use, "rosterEpoch" and "numLinks" can be NULL.
+unsigned int exportReadRoster(const struct exportHeader *header, unsigned int *rosterEpoch, unsigned int *numLinks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHARED_EXPORT_H_
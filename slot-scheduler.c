@@ -0,0 +1,92 @@
+
+#include "elisa3-lib.h"
+
+// Built-in slots schedulers (see "setSlotScheduler"). Each candidate gets a key, the candidates with the highest keys
+// fill the slots: the class of the candidate is in the top bits, the time it has been waiting in the others so that
+// within a class the oldest candidate wins.
+#define CLASS_PADDING 0     // entries that only complete a packet (or unreachable robots), used when there aren't enough robots
+#define CLASS_FILL 1        // not yet due (update rate), sent only in the slots left free
+#define CLASS_DUE 2
+#define CLASS_PENDING 3     // commands changed since the last packet sent to the robot
+#define CLASS_LATE 4        // waited more than twice its period (or SCHED_MAX_WAIT_US), nothing can delay it further
+#define CLASS_SHIFT 58
+#define KEY(cls, age) (((unsigned long long)(cls)<<CLASS_SHIFT) | ((age) < (1ULL<<CLASS_SHIFT) ? (age) : (1ULL<<CLASS_SHIFT)-1))
+
+#define SCHED_MAX_WAIT_US 1000000   // robots without an update rate are refreshed at least once per second
+
+static unsigned long long elapsedUs(unsigned long long now, unsigned long long t) {
+    return (now > t) ? (now-t) : 0;
+}
+
+// Keep the "numSlots" candidates with the highest keys, "chosen" is sorted by key (highest first). The robots of a
+// packet share the same times thus often the same key: the scan starts from a candidate that changes with the time
+// so that the ties (e.g. a slot left by an unreachable robot) aren't always won by the same robot.
+static int chooseHighest(const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now,
+                         unsigned long long (*keyOf)(const slotCandidate*, unsigned long long)) {
+    unsigned long long keys[16];
+    unsigned long long key = 0;
+    int i = 0, j = 0, n = 0, start = 0, count = 0;
+
+    if(numSlots > 16) {
+        numSlots = 16;
+    }
+    if(numCandidates > 0) {
+        start = (int)(now % (unsigned long long)numCandidates);
+    }
+    for(n=0; n<numCandidates; n++) {
+        i = (start+n < numCandidates) ? start+n : start+n-numCandidates;
+        key = keyOf(&candidates[i], now);
+        if(count < numSlots) {
+            j = count++;
+        } else if(key > keys[numSlots-1]) {
+            j = numSlots-1;
+        } else {
+            continue;
+        }
+        for(; j>0 && keys[j-1]<key; j--) {
+            keys[j] = keys[j-1];
+            chosen[j] = chosen[j-1];
+        }
+        keys[j] = key;
+        chosen[j] = i;
+    }
+    return count;
+}
+
+static unsigned long long priorityKey(const slotCandidate *c, unsigned long long now) {
+    unsigned long long sinceTx = elapsedUs(now, c->lastTxTime);
+    unsigned long long maxWait = (c->updatePeriodUs > 0) ? 2*(unsigned long long)c->updatePeriodUs : SCHED_MAX_WAIT_US;
+
+    if(c->padding || (c->unreachable && now < c->probeTime)) {
+        return KEY(CLASS_PADDING, sinceTx);
+    }
+    if(c->unreachable) {
+        return KEY(CLASS_DUE, sinceTx);
+    }
+    if(sinceTx > maxWait) {
+        return KEY(CLASS_LATE, sinceTx);
+    }
+    if(c->txPending) {
+        return KEY(CLASS_PENDING, elapsedUs(now, c->pendingSince));
+    }
+    if(sinceTx >= c->updatePeriodUs) {
+        // a robot whose last exchange failed (no sensors received since the last packet) counts twice as late; the
+        // boost is bounded by "maxWait" (a robot waiting longer is late) thus it only reorders the robots due
+        return KEY(CLASS_DUE, sinceTx + ((c->lastRxTime < c->lastTxTime) ? sinceTx : 0));
+    }
+    return KEY(CLASS_FILL, sinceTx);
+}
+
+static unsigned long long roundRobinKey(const slotCandidate *c, unsigned long long now) {
+    return KEY((c->padding || (c->unreachable && now < c->probeTime)) ? CLASS_PADDING : CLASS_DUE, elapsedUs(now, c->lastTxTime));
+}
+
+int schedulePriority(void *userData, const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now) {
+    (void)userData;
+    return chooseHighest(candidates, numCandidates, chosen, numSlots, now, priorityKey);
+}
+
+int scheduleRoundRobin(void *userData, const slotCandidate *candidates, int numCandidates, int *chosen, int numSlots, unsigned long long now) {
+    (void)userData;
+    return chooseHighest(candidates, numCandidates, chosen, numSlots, now, roundRobinKey);
+}
@@ -0,0 +1,75 @@
+// Tests of the built-in slots scheduler ("schedulePriority"), called directly with hand-made candidates.
+// Build and run: "make test" under the "linux" folder; the exit code is 0 when all the tests pass.
+
+#include "../elisa3-lib.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NOW 10000000ULL
+#define PERIOD_US 20000     // update rate of the robots, 50 Hz
+#define LATENCY_US 1000     // time between a packet and the sensors it brings back
+
+static int failures = 0;
+
+static void check(int condition, const char *what, unsigned long long now) {
+    printf("%s %s (now %llu)\n", condition ? "PASS" : "FAIL", what, now);
+    if(!condition) {
+        failures++;
+    }
+}
+
+static void dueRobot(slotCandidate *c, int address, unsigned long long sinceTx, int answered) {
+    memset(c, 0, sizeof(slotCandidate));
+    c->robotAddr = address;
+    c->lastTxTime = NOW-sinceTx;
+    c->lastRxTime = answered ? c->lastTxTime+LATENCY_US : c->lastTxTime-PERIOD_US;
+    c->updatePeriodUs = PERIOD_US;
+}
+
+// A robot whose last exchange failed goes before a healthy robot due as much, even a little more, whatever the
+// position of the candidates (the scan starts from a position that changes with the time).
+static void testFailedFirst() {
+    slotCandidate candidates[2];
+    int chosen[1] = {-1}, n = 0, i = 0;
+    unsigned long long now = 0;
+
+    for(i=0; i<4; i++) {
+        now = NOW+i;
+        dueRobot(&candidates[i&1], 3000, PERIOD_US+2000, 1);       // healthy, sent 1 ms earlier
+        dueRobot(&candidates[(i&1)^1], 3001, PERIOD_US+1000, 0);   // failed
+        n = schedulePriority(NULL, candidates, 2, chosen, 1, now);
+        check(n == 1 && candidates[chosen[0]].robotAddr == 3001, "failed robot before an equally due healthy robot", now);
+    }
+}
+
+// Between two healthy robots the one waiting longer wins.
+static void testHealthyOldestFirst() {
+    slotCandidate candidates[2];
+    int chosen[1] = {-1}, n = 0;
+
+    dueRobot(&candidates[0], 3000, PERIOD_US+1000, 1);
+    dueRobot(&candidates[1], 3001, PERIOD_US+2000, 1);
+    n = schedulePriority(NULL, candidates, 2, chosen, 1, NOW);
+    check(n == 1 && candidates[chosen[0]].robotAddr == 3001, "oldest healthy robot first", NOW);
+}
+
+// A pending command still goes before a failed robot that is only due.
+static void testPendingFirst() {
+    slotCandidate candidates[2];
+    int chosen[1] = {-1}, n = 0;
+
+    dueRobot(&candidates[0], 3000, PERIOD_US+1000, 0);
+    dueRobot(&candidates[1], 3001, 1000, 1);
+    candidates[1].txPending = 1;
+    candidates[1].pendingSince = NOW-500;
+    n = schedulePriority(NULL, candidates, 2, chosen, 1, NOW);
+    check(n == 1 && candidates[chosen[0]].robotAddr == 3001, "pending command before a failed robot", NOW);
+}
+
+int main() {
+    testFailedFirst();
+    testHealthyOldestFirst();
+    testPendingFirst();
+    printf("%s\n", (failures == 0) ? "all tests passed" : "some tests failed");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+// Tests of the waits for the acknowledge of the robots with the pipelined transport, run against the emulated
+// base-station ("mock-basestation.h"): with up to 8 exchanges in flight the acks of the packets built before the
+// commands changed must not complete the waits, a wait returns only once a packet carrying the new commands made
+// the whole round trip (thus never before the latency of the base-station).
+// Build and run: "make test" under the "linux" folder; the exit code is 0 when all the tests pass.
+
+#include "../elisa3-lib.h"
+#include "../mock-basestation.h"
+#include "../timing.h"
+#include <stdio.h>
+
+#define LATENCY_US 40000    // answer time of the base-station, the pipeline holds 8 packets of 1 ms period
+#define TIMEOUT_US 1000000
+#define TRIALS 5
+#define NUM_TEST_ROBOTS 4   // one packet: all the robots are in every packet
+
+static int failures = 0;
+
+static void check(int condition, const char *what, int trial, unsigned long long elapsedUs) {
+    printf("%s %s (trial %d, %llu us)\n", condition ? "PASS" : "FAIL", what, trial, elapsedUs);
+    if(!condition) {
+        failures++;
+    }
+}
+
+// The speed received by the emulated robot, the one the robot runs with.
+static int robotSpeed(int address) {
+    mockRobotState state;
+    if(!mock_get_robot(address, &state)) {
+        return -1;
+    }
+    return state.leftSpeed;
+}
+
+static void testWaitForUpdate(int *address) {
+    unsigned long long start = 0, elapsed = 0;
+    unsigned char notUpdated = 0;
+    int trial = 0;
+
+    for(trial=0; trial<TRIALS; trial++) {
+        setLeftSpeed(address[0], 10+trial);
+        start = getTimeUs();
+        notUpdated = waitForUpdate(address[0], TIMEOUT_US);
+        elapsed = getTimeUs()-start;
+        check(notUpdated == 0, "waitForUpdate acknowledged", trial, elapsed);
+        check(elapsed >= LATENCY_US, "waitForUpdate not before a round trip", trial, elapsed);
+        check(robotSpeed(address[0]) == 10+trial, "waitForUpdate new speed received", trial, elapsed);
+    }
+}
+
+static void testWaitForUpdateGroup(int *address) {
+    unsigned long long start = 0, elapsed = 0;
+    int notUpdated = 0, trial = 0, i = 0, received = 0;
+
+    for(trial=0; trial<TRIALS; trial++) {
+        for(i=0; i<NUM_TEST_ROBOTS; i++) {
+            setLeftSpeed(address[i], 20+trial+i);
+        }
+        start = getTimeUs();
+        notUpdated = waitForUpdateGroup(address, NUM_TEST_ROBOTS, TIMEOUT_US, NULL);
+        elapsed = getTimeUs()-start;
+        for(i=0, received=0; i<NUM_TEST_ROBOTS; i++) {
+            received += (robotSpeed(address[i]) == 20+trial+i);
+        }
+        check(notUpdated == 0, "waitForUpdateGroup acknowledged", trial, elapsed);
+        check(elapsed >= LATENCY_US, "waitForUpdateGroup not before a round trip", trial, elapsed);
+        check(received == NUM_TEST_ROBOTS, "waitForUpdateGroup new speeds received", trial, elapsed);
+    }
+}
+
+int main() {
+    int address[NUM_TEST_ROBOTS] = {3000, 3001, 3002, 3003};
+
+    mock_set_latency(LATENCY_US, 0);
+    usb_set_transport(&mockTransport);
+    setAsyncTransfer(8);
+    setTransferPeriod(1000);
+    startCommunication(address, NUM_TEST_ROBOTS);
+    sleepUntilUs(getTimeUs()+2*LATENCY_US);    // the pipeline is full
+    check(getAsyncTransfer() == 8, "pipelined transport", 0, 0);
+
+    testWaitForUpdate(address);
+    testWaitForUpdateGroup(address);
+
+    stopCommunication();
+    printf("%s\n", (failures == 0) ? "all tests passed" : "some tests failed");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+
+#include "timing.h"
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+	#include <time.h>
+	#include <errno.h>
+#endif
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+#endif
+
+#if defined(_WIN32) || defined(_WIN64)
+static LARGE_INTEGER perfFreq;
+static __thread HANDLE sleepTimer = NULL;     // one timer per thread (each communication thread sleeps on its own)
+#endif
+#if defined(__APPLE__)
+static mach_timebase_info_data_t timebase;
+#endif
+
+unsigned long long getTimeUs() {
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER now;
+    if(perfFreq.QuadPart == 0) {
+        QueryPerformanceFrequency(&perfFreq);
+    }
+    QueryPerformanceCounter(&now);
+    return (unsigned long long)((now.QuadPart/perfFreq.QuadPart)*1000000 + ((now.QuadPart%perfFreq.QuadPart)*1000000)/perfFreq.QuadPart);
+#endif
+
+#if defined(__linux__)
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec*1000000 + now.tv_nsec/1000;
+#endif
+
+#if defined(__APPLE__)
+    if(timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    return (mach_absolute_time()*timebase.numer/timebase.denom)/1000;
+#endif
+}
+
+void sleepUntilUs(unsigned long long deadline) {
+#if defined(_WIN32) || defined(_WIN64)
+    // The waitable timer resolution depends on the system timer period, thus "timeBeginPeriod(1)"
+    // is requested once in order to get a wake up granularity of about 1 ms instead of 15.6 ms.
+    LARGE_INTEGER dueTime;
+    unsigned long long now = getTimeUs();
+    if(now >= deadline) {
+        return;
+    }
+    if(sleepTimer == NULL) {
+        timeBeginPeriod(1);
+        sleepTimer = CreateWaitableTimer(NULL, TRUE, NULL);
+    }
+    dueTime.QuadPart = -(LONGLONG)((deadline-now)*10);  // relative time in 100 ns units
+    SetWaitableTimer(sleepTimer, &dueTime, 0, NULL, NULL, FALSE);
+    WaitForSingleObject(sleepTimer, INFINITE);
+#endif
+
+#if defined(__linux__)
+    // Absolute deadline: a late wake up doesn't accumulate on the next period.
+    struct timespec ts;
+    ts.tv_sec = deadline/1000000;
+    ts.tv_nsec = (deadline%1000000)*1000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#endif
+
+#if defined(__APPLE__)
+    // No "clock_nanosleep" available, sleep for the remaining time.
+    struct timespec ts;
+    unsigned long long now = getTimeUs();
+    while(now < deadline) {
+        ts.tv_sec = (deadline-now)/1000000;
+        ts.tv_nsec = ((deadline-now)%1000000)*1000;
+        nanosleep(&ts, NULL);
+        now = getTimeUs();
+    }
+#endif
+}
@@ -0,0 +1,25 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Monotonic clock, not affected by changes of the system date/time.
+ * \return current time in microseconds from an arbitrary starting point.
+ */
+unsigned long long getTimeUs();
+
+/**
+ * \brief Put the calling thread to sleep until the absolute (monotonic) time given; return immediately if the time is already elapsed.
+ * \param deadline absolute time in microseconds (same base as "getTimeUs").
+ * \return none
+ */
+void sleepUntilUs(unsigned long long deadline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMING_H_
@@ -8,8 +8,72 @@
 #if defined(__linux__)
     #include <libusb-1.0/libusb.h>
 #endif
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+    #include "windows.h"
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    #include "pthread.h"
+#endif
+
+#define USB_TIMEOUT_MS 5000
+#define USB_PACKET_SIZE 64
+#define NRF_VENDOR_ID 0x1915
+#define NRF_PRODUCT_ID 0x0101
+
+// Pipelined (asynchronous) transport: each exchange is made of an OUT transfer followed by an IN transfer,
+// both submitted at once. The transfers of the same endpoint are completed in order by the device, thus
+// the exchanges are kept in a circular queue and consumed from the oldest one.
+struct asyncExchange {
+    struct libusb_transfer *outTransfer;
+    struct libusb_transfer *inTransfer;
+    unsigned char txData[USB_PACKET_SIZE];
+    unsigned char rxData[USB_PACKET_SIZE];
+    int txBytes;
+    int rxBytes;
+    int tag;
+    int dev;
+    int pending;    // transfers of the exchange still in flight
+    int status;     // 0 if succeeded, libusb error code otherwise
+};
 
-static struct libusb_device_handle *devh = NULL;
+// One entry for each base-station found.
+struct usbDevice {
+    struct libusb_device_handle *devh;
+    struct asyncExchange exchanges[USB_MAX_ASYNC_DEPTH];
+    unsigned int asyncDepth;    // 0 when the blocking transport is used
+    unsigned int asyncHead;     // oldest exchange in flight
+    unsigned int asyncCount;    // number of exchanges in flight
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE asyncEvent;
+#endif
+};
+
+static struct usbDevice devices[USB_MAX_DEVICES];
+static int numDevices = 0;
+
+// A single thread handles the libusb events of all the devices using the pipelined transport.
+static unsigned int asyncDevices = 0;
+static volatile int asyncRunning = 0;
+#if defined(_WIN32) || defined(_WIN64)
+static HANDLE asyncThread;
+static HANDLE asyncMutex;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static pthread_t asyncThread;
+static pthread_mutex_t asyncMutex;
+static pthread_cond_t asyncCond;
+#endif
+
+static int libusbSend(int dev, char* data, int nbytes);
+static int libusbReceive(int dev, char* data, int nbytes);
+static int libusbStartAsync(int dev, unsigned int depth);
+static void libusbStopAsync(int dev);
+static unsigned int libusbAsyncDepth(int dev);
+static unsigned int libusbAsyncPending(int dev);
+static int libusbExchangeCompleted(int dev);
+static int libusbExchangeSubmit(int dev, char* txData, int txBytes, int rxBytes, int tag);
+static int libusbExchangeWait(int dev, char* rxData, int rxBytes, int *tag);
 
 void get_device_list(void) {
     libusb_device **devs;
@@ -23,17 +87,49 @@ void get_device_list(void) {
    }
 }
 
-static int find_nrf_device(void) {
-	devh = (libusb_device_handle*)libusb_open_device_with_vid_pid(NULL, 0x1915, 0x0101);
-	return devh ? 0 : -1;
+static int find_nrf_devices(void) {
+    libusb_device **devs;
+    ssize_t count = libusb_get_device_list(NULL, &devs);
+    ssize_t idx = 0;
+    struct libusb_device_descriptor desc = {0};
+    libusb_device_handle *handle = NULL;
+
+    numDevices = 0;
+    for (idx=0; idx<count && numDevices<USB_MAX_DEVICES; ++idx) {
+        if(libusb_get_device_descriptor(devs[idx], &desc) < 0) {
+            continue;
+        }
+        if(desc.idVendor!=NRF_VENDOR_ID || desc.idProduct!=NRF_PRODUCT_ID) {
+            continue;
+        }
+        if(libusb_open(devs[idx], &handle) < 0) {
+            continue;
+        }
+        memset(&devices[numDevices], 0, sizeof(struct usbDevice));
+        devices[numDevices].devh = handle;
+        numDevices++;
+    }
+    if(count >= 0) {
+        libusb_free_device_list(devs, 1);
+    }
+
+	return (numDevices > 0) ? 0 : -1;
 }
 
-int usb_send(char* data, int nbytes) {
+static int libusbNumDevices() {
+    return numDevices;
+}
+
+static int libusbSend(int dev, char* data, int nbytes) {
 
 	int transferred = 0;
 	int r = 0;
 
-	r = libusb_bulk_transfer(devh, 0x01, (unsigned char*)data, 64, &transferred, 5000); // address 0x01
+	if(dev<0 || dev>=numDevices) {
+	    return LIBUSB_ERROR_NO_DEVICE;
+	}
+
+	r = libusb_bulk_transfer(devices[dev].devh, 0x01, (unsigned char*)data, USB_PACKET_SIZE, &transferred, USB_TIMEOUT_MS); // address 0x01
 	if (r < 0) {
 		fprintf(stderr, "bulk write error %d\n", r);
 		return r;
@@ -47,12 +143,16 @@ int usb_send(char* data, int nbytes) {
 
 }
 
-int usb_receive(char* data, int nbytes) {
+static int libusbReceive(int dev, char* data, int nbytes) {
 
 	int received = 0;
 	int r = 0;
 
-	r = libusb_bulk_transfer(devh, 0x81, (unsigned char*)data, nbytes, &received, 5000);
+	if(dev<0 || dev>=numDevices) {
+	    return LIBUSB_ERROR_NO_DEVICE;
+	}
+
+	r = libusb_bulk_transfer(devices[dev].devh, 0x81, (unsigned char*)data, nbytes, &received, USB_TIMEOUT_MS);
 	if (r < 0) {
 		fprintf(stderr, "bulk read error %d\n", r);
 		return r;
@@ -66,8 +166,8 @@ int usb_receive(char* data, int nbytes) {
 
 }
 
-int openCommunication() {
-    int error=0;
+static int libusbOpen() {
+    int error=0, i=0;
 
 	error = libusb_init(NULL);
 	if (error < 0) {
@@ -79,22 +179,465 @@ int openCommunication() {
 
 	//get_device_list();
 
-	error = find_nrf_device();
+	error = find_nrf_devices();
 	if (error < 0) {
 		fprintf(stderr, "Could not find/open device\n");
 	}
 
-	error = libusb_claim_interface(devh, 0);
-	if (error < 0) {
-		fprintf(stderr, "usb_claim_interface error %d\n", error);
+	for(i=0; i<numDevices; i++) {
+        error = libusb_claim_interface(devices[i].devh, 0);
+        if (error < 0) {
+            fprintf(stderr, "usb_claim_interface error %d\n", error);
+        }
 	}
 
-	return 0;
+#if defined(_WIN32) || defined(_WIN64)
+    asyncMutex = CreateMutex(NULL, FALSE, NULL);
+    for(i=0; i<numDevices; i++) {
+        devices[i].asyncEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    }
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_init(&asyncMutex, NULL);
+    pthread_cond_init(&asyncCond, NULL);
+#endif
+
+	return numDevices;
 }
 
-void closeCommunication() {
-	libusb_release_interface(devh, 0);
-	libusb_close(devh);
+static void libusbClose() {
+    int i=0;
+
+    for(i=0; i<numDevices; i++) {
+        libusbStopAsync(i);
+        libusb_release_interface(devices[i].devh, 0);
+        libusb_close(devices[i].devh);
+        devices[i].devh = NULL;
+#if defined(_WIN32) || defined(_WIN64)
+        CloseHandle(devices[i].asyncEvent);
+#endif
+    }
+    numDevices = 0;
 	libusb_exit(NULL);
+
+#if defined(_WIN32) || defined(_WIN64)
+    CloseHandle(asyncMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_destroy(&asyncMutex);
+    pthread_cond_destroy(&asyncCond);
+#endif
+}
+
+static void lockAsync() {
+#if defined(_WIN32) || defined(_WIN64)
+    WaitForSingleObject(asyncMutex, INFINITE);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&asyncMutex);
+#endif
+}
+
+static void unlockAsync() {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseMutex(asyncMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&asyncMutex);
+#endif
+}
+
+static void LIBUSB_CALL exchangeCallback(struct libusb_transfer *transfer) {
+    struct asyncExchange *ex = (struct asyncExchange*)transfer->user_data;
+    int isOut = (transfer == ex->outTransfer);
+
+    lockAsync();
+    if(transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        if(ex->status == 0) {
+            ex->status = (transfer->status==LIBUSB_TRANSFER_TIMED_OUT) ? LIBUSB_ERROR_TIMEOUT : LIBUSB_ERROR_IO;
+        }
+        fprintf(stderr, "bulk %s error %d\n", isOut?"write":"read", transfer->status);
+    } else if(transfer->actual_length < (isOut?ex->txBytes:ex->rxBytes)) {
+        if(ex->status == 0) {
+            ex->status = -1;
+        }
+        fprintf(stderr, "short %s (%d)\n", isOut?"write":"read", transfer->actual_length);
+    }
+    ex->pending--;
+#if defined(_WIN32) || defined(_WIN64)
+    SetEvent(devices[ex->dev].asyncEvent);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_cond_broadcast(&asyncCond);
+#endif
+    unlockAsync();
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+static DWORD WINAPI asyncEventThread(LPVOID lpParameter) {
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static void *asyncEventThread(void *arg) {
+#endif
+    struct timeval tv;
+    while(asyncRunning) {
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        libusb_handle_events_timeout_completed(NULL, &tv, NULL);
+    }
+    return 0;
+}
+
+static int libusbStartAsync(int dev, unsigned int depth) {
+    unsigned int i = 0;
+    struct usbDevice *d = NULL;
+
+    if(dev<0 || dev>=numDevices) {
+        return LIBUSB_ERROR_NO_DEVICE;
+    }
+    d = &devices[dev];
+    if(d->asyncDepth>0 || depth==0) {
+        return -1;
+    }
+    if(depth > USB_MAX_ASYNC_DEPTH) {
+        depth = USB_MAX_ASYNC_DEPTH;
+    }
+
+    for(i=0; i<depth; i++) {
+        d->exchanges[i].outTransfer = libusb_alloc_transfer(0);
+        d->exchanges[i].inTransfer = libusb_alloc_transfer(0);
+        if(d->exchanges[i].outTransfer==NULL || d->exchanges[i].inTransfer==NULL) {
+            fprintf(stderr, "usb transfer allocation error\n");
+            for(i=0; i<depth; i++) {
+                libusb_free_transfer(d->exchanges[i].outTransfer);
+                libusb_free_transfer(d->exchanges[i].inTransfer);
+                d->exchanges[i].outTransfer = NULL;
+                d->exchanges[i].inTransfer = NULL;
+            }
+            return LIBUSB_ERROR_NO_MEM;
+        }
+    }
+
+    lockAsync();
+    d->asyncHead = 0;
+    d->asyncCount = 0;
+    d->asyncDepth = depth;
+    asyncDevices++;
+    if(!asyncRunning) {
+        asyncRunning = 1;
+#if defined(_WIN32) || defined(_WIN64)
+        asyncThread = CreateThread(NULL, 0, asyncEventThread, NULL, 0, NULL);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        if(pthread_create(&asyncThread, NULL, asyncEventThread, NULL)) {
+            fprintf(stderr, "Error creating usb events thread\n");
+        }
+#endif
+    }
+    unlockAsync();
+
+    return 0;
+}
+
+static void libusbStopAsync(int dev) {
+    unsigned int i = 0;
+    struct usbDevice *d = NULL;
+    int stopThread = 0;
+
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return;
+    }
+    d = &devices[dev];
+
+    // the exchanges still in flight are cancelled, their callbacks are served by the events thread
+    lockAsync();
+    for(i=0; i<d->asyncCount; i++) {
+        libusb_cancel_transfer(d->exchanges[(d->asyncHead+i)%d->asyncDepth].outTransfer);
+        libusb_cancel_transfer(d->exchanges[(d->asyncHead+i)%d->asyncDepth].inTransfer);
+    }
+    unlockAsync();
+    while(libusbAsyncPending(dev) > 0) {
+        libusbExchangeWait(dev, NULL, 0, NULL);
+    }
+
+    lockAsync();
+    for(i=0; i<d->asyncDepth; i++) {
+        libusb_free_transfer(d->exchanges[i].outTransfer);
+        libusb_free_transfer(d->exchanges[i].inTransfer);
+        d->exchanges[i].outTransfer = NULL;
+        d->exchanges[i].inTransfer = NULL;
+    }
+    d->asyncDepth = 0;
+    asyncDevices--;
+    if(asyncDevices == 0) {
+        asyncRunning = 0;
+        stopThread = 1;
+    }
+    unlockAsync();
+
+    if(stopThread) {
+        libusb_interrupt_event_handler(NULL);
+#if defined(_WIN32) || defined(_WIN64)
+        WaitForSingleObject(asyncThread, INFINITE);
+        CloseHandle(asyncThread);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        pthread_join(asyncThread, NULL);
+#endif
+    }
+}
+
+static unsigned int libusbAsyncDepth(int dev) {
+    if(dev<0 || dev>=numDevices) {
+        return 0;
+    }
+    return devices[dev].asyncDepth;
+}
+
+static unsigned int libusbAsyncPending(int dev) {
+    unsigned int count = 0;
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return 0;
+    }
+    lockAsync();
+    count = devices[dev].asyncCount;
+    unlockAsync();
+    return count;
+}
+
+static int libusbExchangeCompleted(int dev) {
+    int completed = 0;
+    struct usbDevice *d = NULL;
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return 0;
+    }
+    d = &devices[dev];
+    lockAsync();
+    completed = (d->asyncCount > 0 && d->exchanges[d->asyncHead].pending == 0);
+    unlockAsync();
+    return completed;
+}
+
+static int libusbExchangeSubmit(int dev, char* txData, int txBytes, int rxBytes, int tag) {
+    struct asyncExchange *ex = NULL;
+    struct usbDevice *d = NULL;
+    int r = 0;
+
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return LIBUSB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+
+    lockAsync();
+    if(d->asyncCount >= d->asyncDepth) {
+        unlockAsync();
+        return LIBUSB_ERROR_BUSY;
+    }
+    ex = &d->exchanges[(d->asyncHead+d->asyncCount)%d->asyncDepth];
+    unlockAsync();
+
+    memcpy(ex->txData, txData, USB_PACKET_SIZE);
+    ex->txBytes = txBytes;
+    ex->rxBytes = rxBytes;
+    ex->tag = tag;
+    ex->dev = dev;
+    ex->status = 0;
+    ex->pending = 2;
+    libusb_fill_bulk_transfer(ex->outTransfer, d->devh, 0x01, ex->txData, USB_PACKET_SIZE, exchangeCallback, ex, USB_TIMEOUT_MS);
+    libusb_fill_bulk_transfer(ex->inTransfer, d->devh, 0x81, ex->rxData, rxBytes, exchangeCallback, ex, USB_TIMEOUT_MS);
+
+    r = libusb_submit_transfer(ex->outTransfer);
+    if(r < 0) {
+        fprintf(stderr, "bulk write submit error %d\n", r);
+        return r;
+    }
+    r = libusb_submit_transfer(ex->inTransfer);
+    lockAsync();
+    if(r < 0) {
+        // the write is already in flight: the exchange is queued anyway and reported as failed when consumed
+        fprintf(stderr, "bulk read submit error %d\n", r);
+        ex->pending--;
+        ex->status = r;
+    }
+    d->asyncCount++;
+    unlockAsync();
+
+    return 0;
+}
+
+static int libusbExchangeWait(int dev, char* rxData, int rxBytes, int *tag) {
+    struct asyncExchange *ex = NULL;
+    struct usbDevice *d = NULL;
+    int status = 0;
+
+    if(dev<0 || dev>=numDevices || devices[dev].asyncDepth==0) {
+        return LIBUSB_ERROR_NOT_FOUND;
+    }
+    d = &devices[dev];
+
+    lockAsync();
+    while(d->asyncCount > 0 && d->exchanges[d->asyncHead].pending > 0) {    // every transfer has a timeout thus the exchange completes in any case
+#if defined(_WIN32) || defined(_WIN64)
+        unlockAsync();
+        WaitForSingleObject(d->asyncEvent, INFINITE);
+        lockAsync();
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+        pthread_cond_wait(&asyncCond, &asyncMutex);
+#endif
+    }
+    if(d->asyncCount == 0) {
+        unlockAsync();
+        return LIBUSB_ERROR_NOT_FOUND;
+    }
+    ex = &d->exchanges[d->asyncHead];
+    if(rxData != NULL) {
+        memcpy(rxData, ex->rxData, (rxBytes < ex->rxBytes) ? rxBytes : ex->rxBytes);
+    }
+    if(tag != NULL) {
+        *tag = ex->tag;
+    }
+    status = ex->status;
+    d->asyncHead = (d->asyncHead+1)%d->asyncDepth;
+    d->asyncCount--;
+    unlockAsync();
+
+    return status;
+}
+
+const struct usbTransport libusbTransport = {
+    libusbOpen,
+    libusbClose,
+    libusbNumDevices,
+    libusbSend,
+    libusbReceive,
+    libusbStartAsync,
+    libusbStopAsync,
+    libusbAsyncDepth,
+    libusbAsyncPending,
+    libusbExchangeCompleted,
+    libusbExchangeSubmit,
+    libusbExchangeWait
+};
+
+// Transport in use, the functions below only dispatch to it.
+static const struct usbTransport *transport = &libusbTransport;
+static int openCount = 0;        // number of users (library contexts) of the devices, closed by the last one
+// Protects "openCount" and "transport" against the contexts started and stopped from different threads.
+#if defined(_WIN32) || defined(_WIN64)
+static SRWLOCK openMutex = SRWLOCK_INIT;
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+static pthread_mutex_t openMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void setOpenMutex() {
+#if defined(_WIN32) || defined(_WIN64)
+    AcquireSRWLockExclusive(&openMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_lock(&openMutex);
+#endif
 }
 
+static void freeOpenMutex() {
+#if defined(_WIN32) || defined(_WIN64)
+    ReleaseSRWLockExclusive(&openMutex);
+#endif
+#if defined(__linux__) || defined(__APPLE__)
+    pthread_mutex_unlock(&openMutex);
+#endif
+}
+
+int usb_set_transport(const struct usbTransport *newTransport) {
+    int ret = 0;
+    setOpenMutex();
+    if(openCount > 0) {
+        ret = USB_ERROR_BUSY;
+    } else {
+        transport = (newTransport != NULL) ? newTransport : &libusbTransport;
+    }
+    freeOpenMutex();
+    return ret;
+}
+
+int openCommunication() {
+    int ret = 0;
+    setOpenMutex();
+    if(openCount++ == 0) {
+        ret = (transport->open() < 0) ? -1 : 0;
+    }
+    freeOpenMutex();
+    return ret;
+}
+
+void closeCommunication() {
+    setOpenMutex();
+    if(openCount > 0 && --openCount == 0) {
+        transport->close();
+    }
+    freeOpenMutex();
+}
+
+int usb_num_devices() {
+    int num = 0;
+    setOpenMutex();
+    num = (openCount > 0) ? transport->numDevices() : 0;
+    freeOpenMutex();
+    return num;
+}
+
+int usb_send_dev(int dev, char* data, int nbytes) {
+    return transport->send(dev, data, nbytes);
+}
+
+int usb_receive_dev(int dev, char* data, int nbytes) {
+    return transport->receive(dev, data, nbytes);
+}
+
+int usb_send(char* data, int nbytes) {
+    return transport->send(0, data, nbytes);
+}
+
+int usb_receive(char* data, int nbytes) {
+    return transport->receive(0, data, nbytes);
+}
+
+int usb_start_async(int dev, unsigned int depth) {
+    if(transport->startAsync == NULL) {
+        return USB_ERROR_NOT_SUPPORTED;
+    }
+    return transport->startAsync(dev, depth);
+}
+
+void usb_stop_async(int dev) {
+    if(transport->stopAsync != NULL) {
+        transport->stopAsync(dev);
+    }
+}
+
+unsigned int usb_async_depth(int dev) {
+    return (transport->asyncDepth != NULL) ? transport->asyncDepth(dev) : 0;
+}
+
+unsigned int usb_async_pending(int dev) {
+    return (transport->asyncPending != NULL) ? transport->asyncPending(dev) : 0;
+}
+
+int usb_exchange_completed(int dev) {
+    return (transport->exchangeCompleted != NULL) ? transport->exchangeCompleted(dev) : 0;
+}
+
+int usb_exchange_submit(int dev, char* txData, int txBytes, int rxBytes, int tag) {
+    if(transport->exchangeSubmit == NULL) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    return transport->exchangeSubmit(dev, txData, txBytes, rxBytes, tag);
+}
+
+int usb_exchange_wait(int dev, char* rxData, int rxBytes, int *tag) {
+    if(transport->exchangeWait == NULL) {
+        return USB_ERROR_NOT_FOUND;
+    }
+    return transport->exchangeWait(dev, rxData, rxBytes, tag);
+}
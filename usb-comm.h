@@ -1,11 +1,78 @@
+#ifndef USB_COMM_H_
+#define USB_COMM_H_
+
 #include <stdio.h>
 
+#define USB_MAX_DEVICES 8
+#define USB_MAX_ASYNC_DEPTH 8
+
+// Error codes returned by the transports (same values as libusb).
+#define USB_ERROR_IO -1
+#define USB_ERROR_NO_DEVICE -4
+#define USB_ERROR_NOT_FOUND -5
+#define USB_ERROR_BUSY -6
+#define USB_ERROR_TIMEOUT -7
+#define USB_ERROR_NOT_SUPPORTED -12
+
+// Transport used to exchange the packets with the base-stations: the functions below dispatch to the transport selected,
+// by default the usb one (libusb). The pipelined exchanges functions can be NULL if the transport doesn't support them.
+struct usbTransport {
+    int (*open)(void);      // open all the base-stations, return their number or a negative error code
+    void (*close)(void);
+    int (*numDevices)(void);
+    int (*send)(int dev, char* data, int nbytes);
+    int (*receive)(int dev, char* data, int nbytes);
+    int (*startAsync)(int dev, unsigned int depth);
+    void (*stopAsync)(int dev);
+    unsigned int (*asyncDepth)(int dev);
+    unsigned int (*asyncPending)(int dev);
+    int (*exchangeCompleted)(int dev);
+    int (*exchangeSubmit)(int dev, char* txData, int txBytes, int rxBytes, int tag);
+    int (*exchangeWait)(int dev, char* rxData, int rxBytes, int *tag);
+};
+
+extern const struct usbTransport libusbTransport;
+
+// Select the transport (NULL for the usb one); it can be changed only while the communication is closed.
+int usb_set_transport(const struct usbTransport *newTransport);
+
+// All the base-stations connected are opened, "dev" is the index of a base-station, from 0 to "usb_num_devices()"-1.
+int usb_num_devices();
+
+int usb_send_dev(int dev, char* data, int nbytes);
+
+int usb_receive_dev(int dev, char* data, int nbytes);
+
+// Same as "usb_send_dev" and "usb_receive_dev" with the first base-station.
 int usb_send(char* data, int nbytes);
 
 int usb_receive(char* data, int nbytes);
 
+// Reference counted: the devices are opened by the first call and closed by the last "closeCommunication".
 int openCommunication();
 
 void closeCommunication();
 
+// Pipelined transport: up to "depth" exchanges (64 bytes write followed by a read) in flight at the same time,
+// completed by a dedicated usb events thread shared by all the base-stations.
+int usb_start_async(int dev, unsigned int depth);
+
+void usb_stop_async(int dev);
+
+unsigned int usb_async_depth(int dev);
+
+unsigned int usb_async_pending(int dev);
+
+// Return 1 if the oldest exchange in flight is completed (thus "usb_exchange_wait" won't block), 0 otherwise.
+int usb_exchange_completed(int dev);
+
+// Queue an exchange, the data are copied thus the buffer can be reused immediately;
+// return 0 if queued, USB_ERROR_BUSY if "depth" exchanges are already in flight.
+int usb_exchange_submit(int dev, char* txData, int txBytes, int rxBytes, int tag);
+
+// Wait for the oldest exchange in flight to complete and copy the received data;
+// return 0 on success, a negative error code otherwise (the exchange is consumed anyway and "tag" is valid),
+// USB_ERROR_NOT_FOUND if there is no exchange in flight.
+int usb_exchange_wait(int dev, char* rxData, int rxBytes, int *tag);
 
+#endif // USB_COMM_H_